@@ -0,0 +1,396 @@
+#include "allocation_counter_operators.h"
+#include "arbitrage_monitor.h"
+#include "black_scholes.h"
+#include "liquidity_analyzer.h"
+#include "output_sink.h"
+#include "synthetic_market.h"
+#include "trade_monitor.h"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ccapi {
+Logger *Logger::logger = nullptr; // This line is needed.
+} // namespace ccapi
+
+// Microbenchmarks of the per-update hot paths, driven by SyntheticMarket
+// so every run sees the same data. Output goes to /dev/null through the
+// normal sink, so formatting and queueing are measured but not the
+// terminal. Every benchmark also reports its heap allocations per
+// iteration (allocs), which is 0 for the steady-state hot paths. Run with
+// --benchmark_filter=<regex> to pick benchmarks.
+
+namespace {
+
+SyntheticMarketOptions marketOptions(size_t venues = 1) {
+  SyntheticMarketOptions options;
+  options.seed = 42;
+  options.venues = venues;
+  return options;
+}
+
+void configureOutput(OutputLevel verbosity) {
+  OutputSink::Options options;
+  options.target = "file:/dev/null";
+  options.verbosity = verbosity;
+  OutputSink::instance().configure(options);
+}
+
+// Trades first, so the analyzers start from a full history
+std::vector<TradeEvent> generateTrades(size_t count, std::vector<int64_t> &times) {
+  SyntheticMarket market(marketOptions());
+  std::vector<TradeEvent> trades;
+  while (trades.size() < count) {
+    size_t venue;
+    const MarketEvent &ev = market.next(venue);
+    if (ev.type != MarketEvent::Type::TRADE) continue;
+    trades.push_back(ev.trade);
+    times.push_back(ev.exchange_time_ns);
+  }
+  return trades;
+}
+
+std::vector<BookEvent> generateBooks(size_t count, size_t depth) {
+  SyntheticMarketOptions options = marketOptions();
+  options.depth_levels = depth;
+  SyntheticMarket market(options);
+  std::vector<BookEvent> books;
+  while (books.size() < count) {
+    size_t venue;
+    const MarketEvent &ev = market.next(venue);
+    if (ev.type == MarketEvent::Type::BOOK) books.push_back(ev.book);
+  }
+  return books;
+}
+
+LiquidityAnalyzer &warmAnalyzer() {
+  static LiquidityAnalyzer analyzer;
+  static bool warmed = false;
+  if (!warmed) {
+    analyzer.setEventTimeMode(true);
+    std::vector<int64_t> times;
+    auto trades = generateTrades(20000, times);
+    for (size_t i = 0; i < trades.size(); ++i) {
+      analyzer.addTrade(times[i] / 1000000, trades[i].price, trades[i].amount,
+                        trades[i].side);
+    }
+    analyzer.updateOrderBook(generateBooks(1, MAX_BOOK_DEPTH)[0]);
+    warmed = true;
+  }
+  return analyzer;
+}
+
+// Heap allocations per iteration made by this thread since scope opened
+void reportAllocations(benchmark::State &state, const AllocationScope &scope) {
+  state.counters["allocs"] = benchmark::Counter(
+      static_cast<double>(scope.allocations()) /
+      static_cast<double>(std::max<benchmark::IterationCount>(1, state.iterations())));
+}
+
+} // namespace
+
+static void BM_SyntheticMarket(benchmark::State &state) {
+  SyntheticMarket market(marketOptions(static_cast<size_t>(state.range(0))));
+  size_t venue;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(&market.next(venue));
+  }
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SyntheticMarket)->Arg(1)->Arg(4);
+
+// Steady state: the history is full, so every trade also evicts one
+static void BM_LiquidityAddTrade(benchmark::State &state) {
+  LiquidityAnalyzer analyzer;
+  analyzer.setEventTimeMode(true);
+  std::vector<int64_t> times;
+  auto trades = generateTrades(40000, times);
+  size_t i = 0;
+  for (; i < 20000; ++i) {
+    analyzer.addTrade(times[i] / 1000000, trades[i].price, trades[i].amount,
+                      trades[i].side);
+  }
+  int64_t offset_ms = 0;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    if (i == trades.size()) {
+      // Wrap around later in time so timestamps keep increasing
+      offset_ms += (times.back() - times.front()) / 1000000 + 1;
+      i = 0;
+    }
+    benchmark::DoNotOptimize(analyzer.addTrade(times[i] / 1000000 + offset_ms,
+                                               trades[i].price,
+                                               trades[i].amount,
+                                               trades[i].side));
+    ++i;
+  }
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LiquidityAddTrade);
+
+// Full snapshots of range(0) levels per side
+static void BM_LiquidityUpdateOrderBook(benchmark::State &state) {
+  LiquidityAnalyzer analyzer;
+  auto books = generateBooks(1024, static_cast<size_t>(state.range(0)));
+  size_t i = 0;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    analyzer.updateOrderBook(books[i]);
+    i = (i + 1) % books.size();
+  }
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LiquidityUpdateOrderBook)->Arg(5)->Arg(20);
+
+// Two-level deltas on a 20-level book, applied in batches of range(0)
+// events: the prefix sums are rebuilt once per batch
+static void BM_LiquidityApplyEvents(benchmark::State &state) {
+  size_t batch = static_cast<size_t>(state.range(0));
+  LiquidityAnalyzer analyzer;
+  analyzer.updateOrderBook(generateBooks(1, MAX_BOOK_DEPTH)[0]);
+  std::vector<MarketEvent> events(1024);
+  auto deltas = generateBooks(events.size(), 2);
+  for (size_t k = 0; k < events.size(); ++k) {
+    events[k].type = MarketEvent::Type::BOOK;
+    events[k].book = deltas[k];
+    events[k].book.snapshot = false;
+  }
+  size_t i = 0;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    analyzer.applyEvents(&events[i], batch, [](const MarketEvent &) {});
+    i = (i + batch) % events.size();
+  }
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_LiquidityApplyEvents)->Arg(1)->Arg(64);
+
+// The two halves of a comprehensive analysis: the ingest thread's
+// snapshot and the report thread's metrics
+static void BM_LiquidityTakeSnapshot(benchmark::State &state) {
+  LiquidityAnalyzer &analyzer = warmAnalyzer();
+  LiquidityAnalyzer::Snapshot snapshot;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    analyzer.takeSnapshot(snapshot, 0);
+    benchmark::DoNotOptimize(snapshot);
+  }
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LiquidityTakeSnapshot);
+
+static void BM_LiquidityAnalyze(benchmark::State &state) {
+  LiquidityAnalyzer::Snapshot snapshot;
+  warmAnalyzer().takeSnapshot(snapshot, 0);
+  AllocationScope allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LiquidityAnalyzer::analyze(snapshot));
+  }
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LiquidityAnalyze);
+
+// A two-level delta, then a snapshot and a cached analysis, as when every
+// book update is published: only the groups of the bands it touched are
+// copied and recomputed
+static void BM_LiquidityCachedAnalysis(benchmark::State &state) {
+  LiquidityAnalyzer analyzer;
+  analyzer.updateOrderBook(generateBooks(1, MAX_BOOK_DEPTH)[0]);
+  auto deltas = generateBooks(1024, 2);
+  for (auto &delta : deltas) delta.snapshot = false;
+  LiquidityAnalyzer::Snapshot snapshot;
+  LiquidityAnalyzer::MetricCache cache;
+  size_t i = 0;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    analyzer.updateOrderBook(deltas[i]);
+    analyzer.takeSnapshot(snapshot, 0);
+    benchmark::DoNotOptimize(&LiquidityAnalyzer::analyze(snapshot, cache));
+    i = (i + 1) % deltas.size();
+  }
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LiquidityCachedAnalysis);
+
+// A trade followed by a snapshot and analysis, as when every trade is
+// published, for the metric groups in range(0): all, spread and depth
+// only (no trade state), and risk only (no book copy)
+static void BM_LiquidityMetricSet(benchmark::State &state) {
+  LiquidityAnalyzer analyzer;
+  analyzer.setMetrics(MetricSet{static_cast<uint32_t>(state.range(0))});
+  analyzer.setEventTimeMode(true);
+  analyzer.updateOrderBook(generateBooks(1, MAX_BOOK_DEPTH)[0]);
+  std::vector<int64_t> times;
+  auto trades = generateTrades(40000, times);
+  size_t i = 0;
+  for (; i < 20000; ++i) {
+    analyzer.addTrade(times[i] / 1000000, trades[i].price, trades[i].amount,
+                      trades[i].side);
+  }
+  LiquidityAnalyzer::Snapshot snapshot;
+  int64_t offset_ms = 0;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    if (i == trades.size()) {
+      offset_ms += (times.back() - times.front()) / 1000000 + 1;
+      i = 0;
+    }
+    analyzer.addTrade(times[i] / 1000000 + offset_ms, trades[i].price,
+                      trades[i].amount, trades[i].side);
+    analyzer.takeSnapshot(snapshot, 0);
+    benchmark::DoNotOptimize(LiquidityAnalyzer::analyze(snapshot));
+    ++i;
+  }
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LiquidityMetricSet)
+    ->Arg(MetricSet::ALL)
+    ->Arg(MetricSet::SPREAD | MetricSet::DEPTH)
+    ->Arg(MetricSet::RISK);
+
+// A Kyle's lambda window without an accumulator, rescanning the history
+// with arena scratch
+static void BM_LiquidityScanKylesLambda(benchmark::State &state) {
+  LiquidityAnalyzer &analyzer = warmAnalyzer();
+  AllocationScope allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(analyzer.calculateKylesLambda(15 * 60 * 1000));
+  }
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LiquidityScanKylesLambda);
+
+// One option across a strike ladder, including the implied volatility
+// solve from the option price
+static void BM_CalculateGreeks(benchmark::State &state) {
+  std::vector<BlackScholesCalculator::OptionData> options;
+  for (int k = 0; k < 64; ++k) {
+    BlackScholesCalculator::OptionData data{};
+    data.spot_price = 50000.0;
+    data.strike_price = 40000.0 + 312.5 * k;
+    data.time_to_expiry = 30.0 / 365.0;
+    data.risk_free_rate = 0.05;
+    data.volatility = 0.6;
+    data.is_call = k % 2 == 0;
+    data.option_price = std::max(
+        1.0, (data.is_call ? 1.0 : -1.0) * (data.spot_price - data.strike_price)) +
+        2500.0;
+    options.push_back(data);
+  }
+  size_t i = 0;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(BlackScholesCalculator::calculateGreeks(options[i]));
+    i = (i + 1) % options.size();
+  }
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CalculateGreeks);
+
+// Anomaly detection per trade, with the report line suppressed (0) or
+// formatted and queued (1)
+static void BM_TradeMonitorOnTrade(benchmark::State &state) {
+  configureOutput(state.range(0) ? OutputLevel::INFO : OutputLevel::ERROR);
+  ccapi::TradeMonitor monitor;
+  std::vector<int64_t> times;
+  auto trades = generateTrades(4096, times);
+  size_t i = 0;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    monitor.onTrade(trades[i].price, trades[i].amount,
+                    ccapi::TimePoint(std::chrono::nanoseconds(times[i])));
+    i = (i + 1) % trades.size();
+  }
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+  configureOutput(OutputLevel::INFO);
+}
+BENCHMARK(BM_TradeMonitorOnTrade)->Arg(0)->Arg(1);
+
+// Decode, matrix update and cross-venue search per depth message, over
+// range(0) venues of one symbol
+static void BM_ArbitrageOnMessage(benchmark::State &state) {
+  size_t venues = static_cast<size_t>(state.range(0));
+  SyntheticMarketOptions options = marketOptions(venues);
+  options.depth_levels = 1;
+  SyntheticMarket market(options);
+  std::vector<std::string> names;
+  for (size_t v = 0; v < venues; ++v) names.push_back("venue" + std::to_string(v));
+  std::vector<ccapi::Message> messages;
+  std::vector<bool> booked(venues, false);
+  while (messages.size() < 4096) {
+    size_t venue;
+    const MarketEvent &ev = market.next(venue);
+    if (ev.type != MarketEvent::Type::BOOK) continue;
+    messages.emplace_back();
+    market.toMessage(ev, names[venue], !booked[venue], messages.back());
+    booked[venue] = true;
+  }
+  ccapi::ArbitrageMonitor monitor(names, {"BTCUSDT"});
+  size_t i = 0;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    monitor.onMessage(messages[i]);
+    i = (i + 1) % messages.size();
+  }
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ArbitrageOnMessage)->Arg(2)->Arg(8);
+
+// Depth messages of 4 venues arriving range(0) per ccapi event: each
+// updated quote is evaluated and reported once per event
+static void BM_ArbitrageOnMessages(benchmark::State &state) {
+  size_t batch = static_cast<size_t>(state.range(0));
+  SyntheticMarketOptions options = marketOptions(4);
+  options.depth_levels = 1;
+  SyntheticMarket market(options);
+  std::vector<std::string> names;
+  for (size_t v = 0; v < options.venues; ++v) {
+    names.push_back("venue" + std::to_string(v));
+  }
+  std::vector<std::vector<ccapi::Message>> events(4096 / batch);
+  std::vector<bool> booked(options.venues, false);
+  for (auto &messages : events) {
+    while (messages.size() < batch) {
+      size_t venue;
+      const MarketEvent &ev = market.next(venue);
+      if (ev.type != MarketEvent::Type::BOOK) continue;
+      messages.emplace_back();
+      market.toMessage(ev, names[venue], !booked[venue], messages.back());
+      booked[venue] = true;
+    }
+  }
+  ccapi::ArbitrageMonitor monitor(names, {"BTCUSDT"});
+  size_t i = 0;
+  AllocationScope allocations;
+  for (auto _ : state) {
+    monitor.onMessages(events[i]);
+    i = (i + 1) % events.size();
+  }
+  reportAllocations(state, allocations);
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_ArbitrageOnMessages)->Arg(1)->Arg(16);
+
+int main(int argc, char **argv) {
+  configureOutput(OutputLevel::INFO);
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
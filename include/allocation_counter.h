@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Heap allocation counts, for checking that hot paths stay off the
+// allocator. The counts only move in programs that include
+// allocation_counter_operators.h, which replaces the global operator new;
+// elsewhere installed() is false and everything reads zero.
+//
+// Each thread counts its own allocations with plain thread-local adds, so
+// a scope can measure exactly what it allocated. The process-wide total
+// behind the latency report costs one relaxed atomic add per allocation
+// and is only kept while latency instrumentation is on.
+namespace AllocationCounter {
+
+struct Counts {
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+};
+
+inline std::atomic<bool> &installedFlag() {
+  static std::atomic<bool> installed{false};
+  return installed;
+}
+
+inline std::atomic<bool> &processCountingFlag() {
+  static std::atomic<bool> counting{false};
+  return counting;
+}
+
+inline std::atomic<uint64_t> &processAllocations() {
+  static std::atomic<uint64_t> allocations{0};
+  return allocations;
+}
+
+// Whether the counting operators are linked into this program
+inline bool installed() {
+  return installedFlag().load(std::memory_order_relaxed);
+}
+
+// Turns the process-wide total on or off (LatencyMonitor::configure)
+inline void setProcessCounting(bool enabled) {
+  processCountingFlag().store(enabled, std::memory_order_relaxed);
+}
+
+inline uint64_t processTotal() {
+  return processAllocations().load(std::memory_order_relaxed);
+}
+
+inline Counts &thisThread() {
+  thread_local Counts counts;
+  return counts;
+}
+
+// Called by the counting operator new; must not allocate
+inline void note(size_t bytes) {
+  Counts &counts = thisThread();
+  ++counts.allocations;
+  counts.bytes += bytes;
+  if (processCountingFlag().load(std::memory_order_relaxed)) {
+    processAllocations().fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+} // namespace AllocationCounter
+
+// Allocations made by the current thread since construction
+class AllocationScope {
+ public:
+  AllocationScope() : start_(AllocationCounter::thisThread()) {}
+
+  uint64_t allocations() const {
+    return AllocationCounter::thisThread().allocations - start_.allocations;
+  }
+  uint64_t bytes() const {
+    return AllocationCounter::thisThread().bytes - start_.bytes;
+  }
+
+ private:
+  AllocationCounter::Counts start_;
+};
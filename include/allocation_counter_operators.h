@@ -0,0 +1,93 @@
+#pragma once
+#include "allocation_counter.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+// Counting replacements of the global allocation functions. Include in
+// exactly one translation unit of a program, its main source; every heap
+// allocation then goes through AllocationCounter::note() on its way to
+// malloc.
+
+namespace AllocationCounter {
+namespace detail {
+inline void *allocate(std::size_t size) {
+  note(size);
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+inline void *allocateAligned(std::size_t size, std::align_val_t alignment) {
+  note(size);
+  std::size_t align = std::max(static_cast<std::size_t>(alignment), sizeof(void *));
+  void *p = nullptr;
+  return ::posix_memalign(&p, align, size == 0 ? 1 : size) == 0 ? p : nullptr;
+}
+
+struct Installer {
+  Installer() { installedFlag().store(true, std::memory_order_relaxed); }
+};
+static Installer installer;
+} // namespace detail
+} // namespace AllocationCounter
+
+void *operator new(std::size_t size) {
+  if (void *p = AllocationCounter::detail::allocate(size)) return p;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) {
+  if (void *p = AllocationCounter::detail::allocate(size)) return p;
+  throw std::bad_alloc();
+}
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return AllocationCounter::detail::allocate(size);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return AllocationCounter::detail::allocate(size);
+}
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  if (void *p = AllocationCounter::detail::allocateAligned(size, alignment)) return p;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  if (void *p = AllocationCounter::detail::allocateAligned(size, alignment)) return p;
+  throw std::bad_alloc();
+}
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  return AllocationCounter::detail::allocateAligned(size, alignment);
+}
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  return AllocationCounter::detail::allocateAligned(size, alignment);
+}
+
+// GCC flags free() of operator new's result once these inline into callers,
+// though both sides are replaced here
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
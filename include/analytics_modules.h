@@ -0,0 +1,287 @@
+#pragma once
+#include "arbitrage_monitor.h"
+#include "liquidity_handler.h"
+#include "live_config.h"
+#include "market_data_bus.h"
+#include "options_handler.h"
+#include "simple_config.h"
+#include "trade_monitor.h"
+#include "trades_handler.h"
+#include <algorithm>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ccapi {
+
+// The four analyzers as MarketDataBus modules. Each reads the same config
+// keys as its standalone program and produces the same reports; only the
+// session and the decoding are shared.
+
+class LiquidityModule : public MarketDataModule {
+ public:
+  LiquidityModule(const SimpleConfig &cfg, bool replaying)
+      : exchange_(cfg.getString("liq_exchange", "binance")),
+        symbol_(cfg.getString("liq_symbol", "BTCUSDT")),
+        subscribe_trade_(cfg.getInt("liq_sub_trade", 1) != 0),
+        subscribe_orderbook_(cfg.getInt("liq_sub_orderbook", 1) != 0) {
+    long queue_capacity = cfg.getLong("liq_queue_capacity", 65536);
+    auto policy = cfg.getString("liq_queue_policy", "drop") == "block" || replaying
+                      ? LiquidityEventHandler::IngestQueue::OverflowPolicy::BLOCK
+                      : LiquidityEventHandler::IngestQueue::OverflowPolicy::DROP;
+    handler_ = std::make_unique<LiquidityEventHandler>(
+        static_cast<size_t>(std::max(2L, queue_capacity)), policy,
+        cfg.getInt("liq_analysis_interval", 100));
+    handler_->setExchange(exchange_);
+    handler_->setMetrics(MetricSet::fromConfig(cfg));
+    handler_->setFixedPointDecimals(cfg.getInt("liq_price_decimals", 8),
+                                    cfg.getInt("liq_size_decimals", 8));
+    handler_->setEventTimeMode(replaying);
+    std::string record_path = cfg.getString("liq_metrics_record", "");
+    if (!record_path.empty()) handler_->setRecordFile(record_path);
+    std::string shm_name = cfg.getString("liq_shm_name", "");
+    if (!shm_name.empty()) handler_->setSharedMemory(shm_name);
+
+    int depth_levels = cfg.getInt("liq_depth_levels", 0);
+    if (depth_levels > 0) {
+      depth_options_ = "MARKET_DEPTH_MAX=" + std::to_string(depth_levels);
+    }
+    if (cfg.getString("liq_depth_mode", "snapshot") == "diff") {
+      depth_options_ += (depth_options_.empty() ? "" : "&") +
+                        std::string("MARKET_DEPTH_RETURN_UPDATE=1");
+    }
+  }
+
+  const char *name() const override { return "liquidity"; }
+
+  std::vector<StreamSpec> streams() const override {
+    std::vector<StreamSpec> out;
+    if (subscribe_trade_) out.push_back({exchange_, symbol_, "TRADE", ""});
+    if (subscribe_orderbook_) {
+      out.push_back({exchange_, symbol_, "MARKET_DEPTH", depth_options_});
+    }
+    return out;
+  }
+
+  void onMarketEvent(size_t, const MarketEvent &ev) override {
+    handler_->onMarketEvent(ev);
+  }
+
+  void stop() override { handler_->stop(); }
+
+  void printSummary(std::ostream &out) override {
+    auto stats = handler_->getIngestStats();
+    out << "liquidity: " << exchange_ << ":" << symbol_ << ", ingest pushed "
+        << stats.pushed << ", dropped " << stats.dropped << ", high watermark "
+        << stats.high_watermark << "\n";
+  }
+
+ private:
+  std::string exchange_;
+  std::string symbol_;
+  bool subscribe_trade_;
+  bool subscribe_orderbook_;
+  std::string depth_options_;
+  std::unique_ptr<LiquidityEventHandler> handler_;
+};
+
+class TradesModule : public MarketDataModule {
+ public:
+  TradesModule(const SimpleConfig &cfg, bool replaying)
+      : channel_(cfg.getString("trades_channel", "TRADE")),
+        live_params_(TradeMonitor::Params::fromConfig(cfg)) {
+    std::string exchange = cfg.getString("trades_exchange", "binance");
+    for (const auto &entry : cfg.getStringList("trades_symbols")) {
+      auto colon = entry.find(':');
+      if (colon == std::string::npos) {
+        instruments_.push_back({exchange, entry});
+      } else {
+        instruments_.push_back({entry.substr(0, colon), entry.substr(colon + 1)});
+      }
+    }
+    if (instruments_.empty()) {
+      instruments_.push_back({exchange, cfg.getString("trades_symbol", "BTCUSDT")});
+    }
+
+    long window = cfg.getLong("trades_window_size", 50);
+    if (window < 2 || window > static_cast<long>(TradeMonitor::MAX_AVERAGE_WINDOW_SIZE)) {
+      throw std::invalid_argument(
+          "trades_window_size must be between 2 and " +
+          std::to_string(TradeMonitor::MAX_AVERAGE_WINDOW_SIZE));
+    }
+    long workers = cfg.getLong("trades_workers", 1);
+    if (workers <= 0) workers = std::max(1u, std::thread::hardware_concurrency());
+    long queue_capacity = cfg.getLong("trades_queue_capacity", 65536);
+    auto policy = cfg.getString("trades_queue_policy", "drop") == "block" || replaying
+                      ? TradesEventHandler::TradeQueue::OverflowPolicy::BLOCK
+                      : TradesEventHandler::TradeQueue::OverflowPolicy::DROP;
+    handler_ = std::make_unique<TradesEventHandler>(
+        instruments_, static_cast<size_t>(window), live_params_.load(),
+        static_cast<size_t>(workers),
+        static_cast<size_t>(std::max(2L, queue_capacity)), policy);
+    handler_->setLiveParams(&live_params_);
+    std::string shm_name = cfg.getString("trades_shm_name", "");
+    if (!shm_name.empty()) handler_->setSharedMemory(shm_name);
+  }
+
+  const char *name() const override { return "trades"; }
+
+  // One stream per instrument, in shard order
+  std::vector<StreamSpec> streams() const override {
+    std::vector<StreamSpec> out;
+    for (const auto &instrument : instruments_) {
+      out.push_back({instrument.exchange, instrument.symbol, channel_, ""});
+    }
+    return out;
+  }
+
+  void watchConfig(ConfigWatcher &watcher) override {
+    watcher.onReload([this](const SimpleConfig &reloaded) {
+      live_params_.publish(TradeMonitor::Params::fromConfig(reloaded));
+    });
+  }
+
+  void onMarketEvent(size_t stream, const MarketEvent &ev) override {
+    handler_->onTrade(stream, ev);
+  }
+
+  void stop() override { handler_->stop(); }
+
+  void printSummary(std::ostream &out) override {
+    auto stats = handler_->getWorkerStats();
+    for (size_t w = 0; w < stats.size(); ++w) {
+      out << "trades: worker " << w << ": " << stats[w].trades
+          << " trades over " << stats[w].shards
+          << " instruments, queue high watermark "
+          << stats[w].queue.high_watermark << "\n";
+    }
+  }
+
+ private:
+  std::string channel_;
+  std::vector<TradesEventHandler::Instrument> instruments_;
+  LiveValue<TradeMonitor::Params> live_params_; // outlives the handler
+  std::unique_ptr<TradesEventHandler> handler_;
+};
+
+class ArbitrageModule : public MarketDataModule {
+ public:
+  explicit ArbitrageModule(const SimpleConfig &cfg)
+      : live_thresholds_(ArbitrageThresholds::fromConfig(cfg)),
+        monitor_(venueList(cfg), symbolList(cfg)) {
+    auto thresholds = live_thresholds_.load();
+    monitor_.setConfig(thresholds.min_price_diff, thresholds.profit_threshold);
+    monitor_.setLiveThresholds(&live_thresholds_);
+    double default_fee = cfg.getDouble("arb_taker_fee", 0.0);
+    for (size_t v = 0; v < monitor_.venueCount(); ++v) {
+      monitor_.setTakerFee(
+          v, cfg.getDouble("arb_taker_fee_" + monitor_.venueName(v), default_fee));
+    }
+    int depth_levels = std::min(cfg.getInt("arb_depth_levels", 5),
+                                static_cast<int>(ArbitrageMatrix::Book::CAPACITY));
+    if (depth_levels > 1) {
+      depth_options_ = "MARKET_DEPTH_MAX=" + std::to_string(depth_levels);
+    }
+    std::string shm_name = cfg.getString("arb_shm_name", "");
+    if (!shm_name.empty()) monitor_.setSharedMemory(shm_name);
+  }
+
+  const char *name() const override { return "arbitrage"; }
+
+  // One depth stream per matrix slot, symbol-major like the correlation ids
+  std::vector<StreamSpec> streams() const override {
+    std::vector<StreamSpec> out;
+    for (size_t s = 0; s < monitor_.symbolCount(); ++s) {
+      for (size_t v = 0; v < monitor_.venueCount(); ++v) {
+        out.push_back({monitor_.venueName(v), monitor_.symbolName(s),
+                       "MARKET_DEPTH", depth_options_});
+      }
+    }
+    return out;
+  }
+
+  void watchConfig(ConfigWatcher &watcher) override {
+    watcher.onReload([this](const SimpleConfig &reloaded) {
+      live_thresholds_.publish(ArbitrageThresholds::fromConfig(reloaded));
+    });
+  }
+
+  void start() override { monitor_.printHeader(); }
+
+  // Quotes are evaluated once per ccapi event, after all of its updates
+  void onMarketEvent(size_t stream, const MarketEvent &ev) override {
+    monitor_.stageBook(stream % monitor_.venueCount(),
+                       stream / monitor_.venueCount(), ev);
+  }
+
+  void onBatchEnd() override { monitor_.reportStaged(); }
+
+ private:
+  static std::vector<std::string> venueList(const SimpleConfig &cfg) {
+    auto venues = cfg.getStringList("arb_venues", {"binance", "bybit"});
+    if (venues.size() < 2) {
+      throw std::invalid_argument("arb_venues needs at least two venues");
+    }
+    return venues;
+  }
+
+  static std::vector<std::string> symbolList(const SimpleConfig &cfg) {
+    auto symbols = cfg.getStringList("arb_symbols");
+    if (symbols.empty()) symbols.push_back(cfg.requireString("arb_symbol"));
+    return symbols;
+  }
+
+  LiveValue<ArbitrageThresholds> live_thresholds_;
+  ArbitrageMonitor monitor_;
+  std::string depth_options_;
+};
+
+class OptionsModule : public MarketDataModule {
+ public:
+  explicit OptionsModule(const SimpleConfig &cfg)
+      : handler_(cfg.requireDouble("risk_free_rate"),
+                 cfg.requireDouble("default_days_to_expiry")) {
+    handler_.configureChain(
+        cfg.getDoubleList("opt_chain_expiries_days", {7, 30, 90}),
+        cfg.getInt("opt_chain_strikes_per_side", 0),
+        cfg.getDouble("opt_chain_strike_step", 0.01),
+        cfg.getDouble("opt_chain_volatility", 0.80),
+        cfg.getDouble("opt_cdf_tolerance", 1e-7));
+    handler_.configureThrottle(cfg.getLong("opt_reprice_interval_ms", 1000),
+                               cfg.getDouble("opt_reprice_move", 0.001),
+                               cfg.getInt("opt_taylor_updates", 1) != 0);
+  }
+
+  const char *name() const override { return "options"; }
+
+  // BTC spot, as the options calculator subscribes it
+  std::vector<StreamSpec> streams() const override {
+    return {{"binance", "BTCUSDT", "TRADE", ""}};
+  }
+
+  void onMarketEvent(size_t, const MarketEvent &ev) override {
+    handler_.onMarketEvent(ev);
+  }
+
+  void onBatchEnd() override { handler_.endBatch(); }
+
+ private:
+  OptionsEventHandler handler_;
+};
+
+// Module for a host_modules entry. Throws std::invalid_argument on unknown
+// names or invalid settings, and std::runtime_error on missing required keys.
+inline std::unique_ptr<MarketDataModule>
+makeAnalyticsModule(const std::string &name, const SimpleConfig &cfg,
+                    bool replaying) {
+  if (name == "liquidity") return std::make_unique<LiquidityModule>(cfg, replaying);
+  if (name == "trades") return std::make_unique<TradesModule>(cfg, replaying);
+  if (name == "arbitrage") return std::make_unique<ArbitrageModule>(cfg);
+  if (name == "options") return std::make_unique<OptionsModule>(cfg);
+  throw std::invalid_argument("Unknown analytics module: " + name);
+}
+
+} // namespace ccapi
@@ -0,0 +1,156 @@
+#pragma once
+#include "order_book.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Books for every venue x symbol in one contiguous array.
+//
+// Quotes are stored symbol-major, so all venues quoting a symbol sit next to
+// each other and a tick is evaluated against one short, contiguous row.
+// When venue v updates symbol s only the pairs involving v can have changed,
+// so bestAgainst() scans the row once: O(venues) per tick rather than
+// re-evaluating all venue pairs.
+//
+// Each venue keeps its best Depth levels per side. A cross is sized by
+// walking the buy venue's asks against the sell venue's bids net of both
+// taker fees, reading fill notionals from the books' prefix sums; nothing
+// on the tick path allocates.
+template <size_t Depth>
+class BasicArbitrageMatrix {
+ public:
+  using Book = BasicOrderBook<Depth>;
+
+  struct Quote {
+    Book book;
+    int64_t update_ns = 0; // receive time of the last update
+    bool has_data = false;
+
+    double bid() const { return book.bids().best(); }
+    double ask() const { return book.asks().best(); }
+    double bidSize() const { return book.bids().depth(1); }
+    double askSize() const { return book.asks().depth(1); }
+  };
+
+  // Profit-maximizing fill of buying at one book's asks and selling into
+  // another's bids.
+  struct Sizing {
+    double quantity = 0.0;
+    double buy_vwap = 0.0;
+    double sell_vwap = 0.0;
+    double profit = 0.0; // sell proceeds - buy cost, after taker fees
+  };
+
+  // Buy on buy_venue at its asks, sell on sell_venue into its bids.
+  struct Opportunity {
+    bool valid = false;
+    size_t buy_venue = 0;
+    size_t sell_venue = 0;
+    double spread = 0.0; // top of book: sell bid - buy ask, before fees
+    Sizing sizing;       // quantity 0 when no size is profitable
+    // Newest update in the row and the age of its stalest quote
+    int64_t now_ns = 0;
+    int64_t max_age_ns = 0;
+  };
+
+  BasicArbitrageMatrix(size_t venues, size_t symbols)
+      : venues_(venues), symbols_(symbols), quotes_(venues * symbols),
+        taker_fee_(venues, 0.0) {}
+
+  size_t venues() const { return venues_; }
+  size_t symbols() const { return symbols_; }
+
+  // Taker fee of venue as a fraction of notional, e.g. 0.001 for 10 bps
+  void setTakerFee(size_t venue, double fee) { taker_fee_[venue] = fee; }
+  double takerFee(size_t venue) const { return taker_fee_[venue]; }
+
+  Quote &at(size_t venue, size_t symbol) {
+    return quotes_[symbol * venues_ + venue];
+  }
+  const Quote &at(size_t venue, size_t symbol) const {
+    return quotes_[symbol * venues_ + venue];
+  }
+
+  // Largest quantity for which every extra unit still earns more than it
+  // costs, found by merging the two sides' level boundaries. The marginal
+  // margin only falls as the walk goes deeper, so the first unprofitable
+  // pair of levels ends it. Notionals come from the prefix sums.
+  static Sizing size(const typename Book::Side &asks, double buy_fee,
+                     const typename Book::Side &bids, double sell_fee) {
+    Sizing out;
+    size_t i = 0, j = 0;
+    double quantity = 0.0;
+    while (i < asks.levels() && j < bids.levels()) {
+      double margin = bids.price(j) * (1.0 - sell_fee) -
+                      asks.price(i) * (1.0 + buy_fee);
+      if (!(margin > 0.0)) break;
+      double ask_cum = asks.depth(i + 1);
+      double bid_cum = bids.depth(j + 1);
+      quantity = std::min(ask_cum, bid_cum);
+      if (ask_cum <= quantity) ++i;
+      if (bid_cum <= quantity) ++j;
+    }
+    if (quantity <= 0.0) return out;
+    out.quantity = quantity;
+    out.buy_vwap = asks.vwap(quantity);
+    out.sell_vwap = bids.vwap(quantity);
+    out.profit = quantity * (out.sell_vwap * (1.0 - sell_fee) -
+                             out.buy_vwap * (1.0 + buy_fee));
+    return out;
+  }
+
+  // Most profitable cross between venue and any other venue quoting symbol,
+  // in either direction. Without a profitable size it is the widest top of
+  // book spread. valid is false until a second venue has data.
+  Opportunity bestAgainst(size_t venue, size_t symbol) const {
+    Opportunity best;
+    const Quote *row = &quotes_[symbol * venues_];
+    const Quote &self = row[venue];
+    if (!self.has_data) return best;
+    int64_t now = self.update_ns, oldest = self.update_ns;
+    for (size_t other = 0; other < venues_; ++other) {
+      const Quote &q = row[other];
+      if (other == venue || !q.has_data) continue;
+      if (q.update_ns > now) now = q.update_ns;
+      if (q.update_ns < oldest) oldest = q.update_ns;
+      // Buy here and sell there, or buy there and sell here
+      consider(best, venue, self, other, q);
+      consider(best, other, q, venue, self);
+    }
+    best.now_ns = now;
+    best.max_age_ns = now - oldest;
+    return best;
+  }
+
+ private:
+  void consider(Opportunity &best, size_t buy_venue, const Quote &buy,
+                size_t sell_venue, const Quote &sell) const {
+    if (buy.book.asks().empty() || sell.book.bids().empty()) return;
+    double spread = sell.bid() - buy.ask();
+    Sizing sizing;
+    // Only a top of book that beats both fees can size to anything
+    if (sell.bid() * (1.0 - taker_fee_[sell_venue]) >
+        buy.ask() * (1.0 + taker_fee_[buy_venue])) {
+      sizing = size(buy.book.asks(), taker_fee_[buy_venue], sell.book.bids(),
+                    taker_fee_[sell_venue]);
+    }
+    bool better = !best.valid ||
+                  (sizing.profit > 0.0 || best.sizing.profit > 0.0
+                       ? sizing.profit > best.sizing.profit
+                       : spread > best.spread);
+    if (!better) return;
+    best.valid = true;
+    best.buy_venue = buy_venue;
+    best.sell_venue = sell_venue;
+    best.spread = spread;
+    best.sizing = sizing;
+  }
+
+  size_t venues_;
+  size_t symbols_;
+  std::vector<Quote> quotes_;
+  std::vector<double> taker_fee_;
+};
+
+using ArbitrageMatrix = BasicArbitrageMatrix<10>;
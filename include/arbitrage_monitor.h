@@ -0,0 +1,432 @@
+#pragma once
+#include "arbitrage_matrix.h"
+#include "event_log.h"
+#include "latency_monitor.h"
+#include "live_config.h"
+#include "market_data_parser.h"
+#include "output_sink.h"
+#include "published_metrics.h"
+#include "simple_config.h"
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ccapi {
+
+// Filter an opportunity must pass to be reported as actionable
+struct ArbitrageThresholds {
+  double min_price_diff = 1.0;   // Minimum $1 difference
+  double profit_threshold = 0.5; // Minimum $0.5 profit threshold
+
+  bool accepts(double spread, double profit) const {
+    return spread >= min_price_diff && profit > profit_threshold;
+  }
+
+  // arb_min_price_diff, arb_profit_threshold (both required)
+  static ArbitrageThresholds fromConfig(const SimpleConfig &cfg) {
+    ArbitrageThresholds t;
+    t.min_price_diff = cfg.requireDouble("arb_min_price_diff");
+    t.profit_threshold = cfg.requireDouble("arb_profit_threshold");
+    return t;
+  }
+};
+
+// Cross-venue monitor over any number of venues and symbols. Each
+// subscription's correlation id is its integer slot in the matrix, so a
+// message is routed without string compares or map lookups, and a tick is
+// only compared against the other venues quoting the same symbol. Depth
+// messages are decoded into a scratch event and applied to the venue's
+// book, then each cross is sized through both books net of taker fees.
+// Updates arriving together (one ccapi event, one bus batch) are applied
+// first and each quote they touched is evaluated once.
+class ArbitrageMonitor {
+private:
+  std::vector<std::string> venues;
+  std::vector<std::string> symbols;
+  ArbitrageMatrix matrix;
+  MarketDataParser<Message> parser;
+  MarketEvent scratch; // decode target for depth messages
+  // Venue name -> slot for logs recorded when the correlation id was
+  // the venue name (single symbol only)
+  std::unordered_map<std::string, size_t> legacy_ids;
+  std::unique_ptr<ShmMetricsPublisher<ArbitrageSnapshot>> shm_publisher;
+  PipelineLatency latency = PipelineLatency::get();
+  std::vector<LatencyHistogram *> skew_latency; // per venue
+
+  // Slots updated since the last reportStaged(), in first-update order,
+  // with the stamps their rows are timed from
+  struct Staged {
+    int64_t received_ns = 0; // first update's
+    int64_t parsed_ns = 0;   // last update's
+    bool pending = false;
+  };
+  std::vector<Staged> staged; // per slot
+  std::vector<size_t> staged_slots;
+
+  // Configuration (loaded from config.txt if present), refreshed from
+  // live_thresholds if set
+  ArbitrageThresholds thresholds;
+  const LiveValue<ArbitrageThresholds> *live_thresholds = nullptr;
+  uint64_t thresholds_version = 0;
+
+public:
+  ArbitrageMonitor(std::vector<std::string> venue_names,
+                   std::vector<std::string> symbol_names)
+      : venues(std::move(venue_names)), symbols(std::move(symbol_names)),
+        matrix(venues.size(), symbols.size()),
+        staged(venues.size() * symbols.size()) {
+    staged_slots.reserve(staged.size());
+    for (const auto &venue : venues) {
+      skew_latency.push_back(&LatencyMonitor::instance().skew(venue));
+    }
+    if (symbols.size() == 1) {
+      for (size_t v = 0; v < venues.size(); ++v) legacy_ids[venues[v]] = v;
+    }
+  }
+
+  void setConfig(double minDiff, double profitThres) {
+    thresholds.min_price_diff = minDiff;
+    thresholds.profit_threshold = profitThres;
+  }
+
+  // Follow thresholds republished by a ConfigWatcher, checked on every
+  // update. live must outlive the monitor.
+  void setLiveThresholds(const LiveValue<ArbitrageThresholds> *live) {
+    live_thresholds = live;
+    thresholds_version = 0;
+  }
+
+  void setTakerFee(size_t venue, double fee) { matrix.setTakerFee(venue, fee); }
+
+  // Publish every venue's quote and best cross into the shared-memory
+  // segment name, one slot per "venue:symbol" in matrix slot order
+  void setSharedMemory(const std::string &name) {
+    std::vector<std::string> slots;
+    for (const auto &symbol : symbols) {
+      for (const auto &venue : venues) slots.push_back(venue + ":" + symbol);
+    }
+    shm_publisher = std::make_unique<ShmMetricsPublisher<ArbitrageSnapshot>>(
+        name, ShmMetricsFormat::Tag::ARBITRAGE, slots);
+  }
+
+  size_t venueCount() const { return venues.size(); }
+  size_t symbolCount() const { return symbols.size(); }
+  const std::string &venueName(size_t venue) const { return venues[venue]; }
+  const std::string &symbolName(size_t symbol) const { return symbols[symbol]; }
+
+  // Correlation id of the subscription for venue/symbol
+  std::string correlationId(size_t venue, size_t symbol) const {
+    return std::to_string(symbol * venues.size() + venue);
+  }
+
+  void printHeader() {
+    std::cout << std::left;
+    std::cout << std::setw(12) << "Time" << " | ";
+    std::cout << std::setw(10) << "Symbol" << " | ";
+    std::cout << std::setw(10) << "Venue" << " | ";
+    std::cout << std::setw(11) << "Bid" << " | ";
+    std::cout << std::setw(11) << "Ask" << " | ";
+    std::cout << std::setw(10) << "BVol" << " | ";
+    std::cout << std::setw(10) << "AVol" << " | ";
+    std::cout << std::setw(9) << "Spread_$" << " | ";
+    std::cout << std::setw(8) << "Spread_%" << " | ";
+    std::cout << std::setw(22) << "Best_Direction" << " | ";
+    std::cout << std::setw(10) << "Qty" << " | ";
+    std::cout << std::setw(12) << "Net_Profit_$" << " | ";
+    std::cout << std::setw(8) << "Lat_ms";
+    std::cout << std::endl;
+
+    // Print separator line with proper length
+    std::cout << std::string(12, '-') << "-+-";
+    std::cout << std::string(10, '-') << "-+-";
+    std::cout << std::string(10, '-') << "-+-";
+    std::cout << std::string(11, '-') << "-+-";
+    std::cout << std::string(11, '-') << "-+-";
+    std::cout << std::string(10, '-') << "-+-";
+    std::cout << std::string(10, '-') << "-+-";
+    std::cout << std::string(9, '-') << "-+-";
+    std::cout << std::string(8, '-') << "-+-";
+    std::cout << std::string(22, '-') << "-+-";
+    std::cout << std::string(10, '-') << "-+-";
+    std::cout << std::string(12, '-') << "-+-";
+    std::cout << std::string(8, '-') << std::endl;
+  }
+
+  // Local time of day into buf, without allocating
+  static const char *
+  getCurrentTimestamp(std::chrono::system_clock::time_point now, char (&buf)[32]) {
+    auto time_t = std::chrono::system_clock::to_time_t(now);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  now.time_since_epoch()) %
+              1000;
+
+    // localtime_r: other analyzers may format times on their own threads
+    std::tm local{};
+    localtime_r(&time_t, &local);
+    size_t n = std::strftime(buf, sizeof(buf), "%H:%M:%S", &local);
+    std::snprintf(buf + n, sizeof(buf) - n, ".%03d", static_cast<int>(ms.count()));
+    return buf;
+  }
+
+  // Matrix slot of the message's subscription, from its correlation id
+  bool route(const Message &message, size_t &venue, size_t &symbol) const {
+    const auto &ids = message.getCorrelationIdList();
+    if (ids.empty()) return false;
+    const std::string &id = ids[0];
+    size_t slot = 0;
+    auto result = std::from_chars(id.data(), id.data() + id.size(), slot);
+    if (result.ec != std::errc() || result.ptr != id.data() + id.size()) {
+      auto it = legacy_ids.find(id);
+      if (it == legacy_ids.end()) return false;
+      slot = it->second;
+    }
+    if (slot >= venues.size() * symbols.size()) return false;
+    venue = slot % venues.size();
+    symbol = slot / venues.size();
+    return true;
+  }
+
+  void onMessage(const Message &message) {
+    int64_t received_ns = LatencyClock::stamp();
+    size_t venue, symbol;
+    if (!apply(message, venue, symbol)) return;
+    int64_t parsed_ns = LatencyClock::stamp();
+    if (received_ns != 0) {
+      latency.parse->record(parsed_ns - received_ns);
+      skew_latency[venue]->record(matrix.at(venue, symbol).update_ns -
+                                  EventLog::toNanos(message.getTime()));
+    }
+    calculateAndPrint(venue, symbol, received_ns, parsed_ns);
+  }
+
+  // The messages of one ccapi event: all of them are applied, then every
+  // venue/symbol they updated is evaluated and reported once, so a burst
+  // costs one cross-venue search and one row per quote instead of one per
+  // message.
+  void onMessages(const std::vector<Message> &messages) {
+    int64_t received_ns = LatencyClock::stamp();
+    for (const auto &message : messages) {
+      size_t venue, symbol;
+      if (!stage(message, venue, symbol)) continue;
+      int64_t parsed_ns = LatencyClock::stamp();
+      if (received_ns != 0) {
+        latency.parse->record(parsed_ns - received_ns);
+        skew_latency[venue]->record(matrix.at(venue, symbol).update_ns -
+                                    EventLog::toNanos(message.getTime()));
+      }
+      markStaged(venue, symbol, received_ns, parsed_ns);
+    }
+    reportStaged();
+  }
+
+  // Routes a depth message and applies it to its venue's book, without
+  // output. Returns false if it is not one of ours or held no levels.
+  bool apply(const Message &message, size_t &venue, size_t &symbol) {
+    if (!stage(message, venue, symbol)) return false;
+    matrix.at(venue, symbol).book.finalize();
+    return true;
+  }
+
+  // Applies a book event decoded elsewhere, e.g. by a MarketDataBus shared
+  // with other modules, to venue/symbol, to be reported by the next
+  // reportStaged()
+  void stageBook(size_t venue, size_t symbol, const MarketEvent &ev) {
+    if (ev.type != MarketEvent::Type::BOOK || venue >= venues.size() ||
+        symbol >= symbols.size()) {
+      return;
+    }
+    ArbitrageMatrix::Quote &quote = matrix.at(venue, symbol);
+    stageQuote(quote, ev.book);
+    quote.update_ns = ev.receive_time_ns;
+    quote.has_data = true;
+    markStaged(venue, symbol, ev.received_stamp, ev.parsed_stamp);
+  }
+
+  // Evaluates and reports every quote staged since the last call, once
+  // each, after all of their books are current
+  void reportStaged() {
+    drainStaged([this](size_t venue, size_t symbol, const Staged &entry) {
+      calculateAndPrint(venue, symbol, entry.received_ns, entry.parsed_ns);
+    });
+  }
+
+  // Stages a depth message as onMessages() does, without output, e.g. to
+  // evaluate a recording one ccapi event at a time through
+  // evaluateStaged(). Returns false if it is not one of ours or held no
+  // levels.
+  bool stageMessage(const Message &message, size_t &venue, size_t &symbol) {
+    if (!stage(message, venue, symbol)) return false;
+    markStaged(venue, symbol, 0, 0);
+    return true;
+  }
+
+  // reportStaged() without output: calls on_best(venue, symbol, best) with
+  // the best cross of every quote staged since the last call, once each
+  template <typename OnBest>
+  void evaluateStaged(OnBest &&on_best) {
+    drainStaged([&](size_t venue, size_t symbol, const Staged &) {
+      on_best(venue, symbol, matrix.bestAgainst(venue, symbol));
+    });
+  }
+
+  // A single decoded book event, reported like onMessage()
+  void onBook(size_t venue, size_t symbol, const MarketEvent &ev) {
+    stageBook(venue, symbol, ev);
+    reportStaged();
+  }
+
+  // Best cross of venue's quote against the other venues of symbol
+  ArbitrageMatrix::Opportunity bestAgainst(size_t venue, size_t symbol) const {
+    return matrix.bestAgainst(venue, symbol);
+  }
+
+private:
+  // Book update without the prefix sum rebuild; the book is finalized
+  // before it is read
+  static void stageQuote(ArbitrageMatrix::Quote &quote, const BookEvent &book) {
+    if (book.snapshot) {
+      quote.book.stageSnapshot(book.bid_price, book.bid_size, book.bid_count,
+                               book.ask_price, book.ask_size, book.ask_count);
+    } else {
+      quote.book.stageDelta(book.bid_price, book.bid_size, book.bid_count,
+                            book.ask_price, book.ask_size, book.ask_count);
+    }
+  }
+
+  // Routes a depth message and stages it on its venue's book
+  bool stage(const Message &message, size_t &venue, size_t &symbol) {
+    if (!route(message, venue, symbol)) return false;
+
+    // Every depth message carries the venue's top levels
+    ArbitrageMatrix::Quote &quote = matrix.at(venue, symbol);
+    size_t updated = parser.parse(
+        message, MarketEvent::Type::BOOK, [this] { return &scratch; },
+        [&quote](MarketEvent &ev) { stageQuote(quote, ev.book); });
+
+    if (updated == 0) return false;
+    quote.update_ns = EventLog::toNanos(message.getTimeReceived());
+    quote.has_data = true;
+    return true;
+  }
+
+  // Finalizes the staged books, then visits each staged quote once and
+  // clears the stage
+  template <typename Visit>
+  void drainStaged(Visit &&visit) {
+    for (size_t slot : staged_slots) {
+      matrix.at(slot % venues.size(), slot / venues.size()).book.finalize();
+    }
+    for (size_t slot : staged_slots) {
+      Staged &entry = staged[slot];
+      visit(slot % venues.size(), slot / venues.size(), entry);
+      entry.pending = false;
+    }
+    staged_slots.clear();
+  }
+
+  void markStaged(size_t venue, size_t symbol, int64_t received_ns,
+                  int64_t parsed_ns) {
+    size_t slot = symbol * venues.size() + venue;
+    Staged &entry = staged[slot];
+    if (!entry.pending) {
+      entry.pending = true;
+      entry.received_ns = received_ns;
+      staged_slots.push_back(slot);
+    }
+    entry.parsed_ns = parsed_ns;
+  }
+
+  void publish(size_t venue, size_t symbol,
+               const ArbitrageMatrix::Opportunity &best) {
+    const auto &quote = matrix.at(venue, symbol);
+    ArbitrageSnapshot snapshot{};
+    snapshot.time_ns = best.valid ? best.now_ns : quote.update_ns;
+    snapshot.max_age_ns = best.max_age_ns;
+    snapshot.bid = quote.bid();
+    snapshot.ask = quote.ask();
+    snapshot.bid_size = quote.bidSize();
+    snapshot.ask_size = quote.askSize();
+    snapshot.buy_slot = snapshot.sell_slot = -1;
+    if (best.valid) {
+      size_t row = symbol * venues.size();
+      snapshot.buy_slot = static_cast<int32_t>(row + best.buy_venue);
+      snapshot.sell_slot = static_cast<int32_t>(row + best.sell_venue);
+      snapshot.spread = best.spread;
+      snapshot.quantity = best.sizing.quantity;
+      snapshot.buy_vwap = best.sizing.buy_vwap;
+      snapshot.sell_vwap = best.sizing.sell_vwap;
+      snapshot.profit = best.sizing.profit;
+    }
+    shm_publisher->publish(symbol * venues.size() + venue, snapshot);
+  }
+
+  // received_ns/parsed_ns are LatencyClock stamps of the update, 0 if
+  // untimed
+  void calculateAndPrint(size_t venue, size_t symbol, int64_t received_ns,
+                         int64_t parsed_ns) {
+    AllocationSpan allocation_span(latency.allocations, received_ns);
+    if (live_thresholds) live_thresholds->refresh(thresholds, thresholds_version);
+    auto best = matrix.bestAgainst(venue, symbol);
+    int64_t analyzed_ns = LatencyClock::stamp();
+    latency.analyze->recordSpan(parsed_ns, analyzed_ns);
+    // Output and total spans close after the row below is queued
+    LatencySpan output_span(latency.output, analyzed_ns);
+    LatencySpan total_span(latency.total, received_ns);
+    if (shm_publisher) publish(venue, symbol, best);
+    if (!best.valid) {
+      return; // Wait for a second venue to have data
+    }
+    const auto &quote = matrix.at(venue, symbol);
+    double buy_ask = matrix.at(best.buy_venue, symbol).ask();
+
+    // Cross-venue arbitrage: buy low, sell high, sized through both books
+    // after taker fees
+    double spread_percent = buy_ask > 0 ? best.spread / buy_ask * 100 : 0.0;
+    char best_direction[64] = "None"; // formatted in place: no per-row strings
+    double quantity = 0.0;
+    double potential_profit = 0.0;
+    if (thresholds.accepts(best.spread, best.sizing.profit)) {
+      std::snprintf(best_direction, sizeof(best_direction), "%s->%s",
+                    venues[best.buy_venue].c_str(),
+                    venues[best.sell_venue].c_str());
+      quantity = best.sizing.quantity;
+      potential_profit = best.sizing.profit;
+    }
+
+    // Latency is the age of the stalest quote in the row. "Now" is the
+    // receive time of the newest update so a replayed log prints the same
+    // rows
+    auto now = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+        TimePoint(std::chrono::nanoseconds(best.now_ns)));
+    auto max_latency = best.max_age_ns / 1000000;
+
+    // Queue the data row with consistent formatting
+    OutputLine row;
+    char timestamp[32];
+    row << std::left << std::fixed;
+    row << std::setw(12) << std::setprecision(0)
+        << getCurrentTimestamp(now, timestamp) << " | ";
+    row << std::setw(10) << symbols[symbol] << " | ";
+    row << std::setw(10) << venues[venue] << " | ";
+    row << std::setw(11) << std::setprecision(2) << quote.bid() << " | ";
+    row << std::setw(11) << std::setprecision(2) << quote.ask() << " | ";
+    row << std::setw(10) << std::setprecision(3) << quote.bidSize() << " | ";
+    row << std::setw(10) << std::setprecision(3) << quote.askSize() << " | ";
+    row << std::setw(9) << std::setprecision(2) << best.spread << " | ";
+    row << std::setw(8) << std::setprecision(3) << spread_percent << " | ";
+    row << std::setw(22) << best_direction << " | ";
+    row << std::setw(10) << std::setprecision(4) << quantity << " | ";
+    row << std::setw(12) << std::setprecision(2) << potential_profit << " | ";
+    row << std::setw(8) << max_latency;
+    row << "\n";
+  }
+};
+
+} // namespace ccapi
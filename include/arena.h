@@ -0,0 +1,177 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Bump allocator for per-event temporaries. Allocation advances a pointer
+// through a chain of blocks and deallocation does nothing; memory comes
+// back all at once when the arena is rewound to a mark or reset. Rewinding
+// keeps the blocks for the next event, so once the chain has grown to the
+// largest working set the arena never touches the heap again.
+//
+// Each thread has its own arena (thisThread()); code that needs scratch
+// memory opens an ArenaScope and builds ArenaVectors (or node containers
+// over ArenaAllocator) inside it.
+class MonotonicArena {
+ public:
+  static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+  // Position to rewind to
+  struct Mark {
+    void *block;
+    size_t used;
+  };
+
+  explicit MonotonicArena(size_t block_size = DEFAULT_BLOCK_SIZE)
+      : block_size_(std::max<size_t>(block_size, 256)) {}
+
+  ~MonotonicArena() {
+    while (head_) {
+      Block *next = head_->next;
+      ::operator delete(head_);
+      head_ = next;
+    }
+  }
+
+  MonotonicArena(const MonotonicArena &) = delete;
+  MonotonicArena &operator=(const MonotonicArena &) = delete;
+
+  static MonotonicArena &thisThread() {
+    thread_local MonotonicArena arena;
+    return arena;
+  }
+
+  // align must be a power of two
+  void *allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+    size_t offset;
+    if (current_ && fits(current_, used_, bytes, align, offset)) {
+      used_ = offset + bytes;
+      return current_->data() + offset;
+    }
+    return allocateSlow(bytes, align);
+  }
+
+  Mark mark() const { return {current_, used_}; }
+
+  // Frees everything allocated since m; later blocks stay for reuse
+  void rewind(const Mark &m) {
+    current_ = static_cast<Block *>(m.block);
+    used_ = m.used;
+  }
+
+  void reset() { rewind({nullptr, 0}); }
+
+  // Bytes held in blocks, used or not
+  size_t capacity() const {
+    size_t total = 0;
+    for (Block *b = head_; b; b = b->next) total += b->size;
+    return total;
+  }
+
+  size_t blockCount() const {
+    size_t n = 0;
+    for (Block *b = head_; b; b = b->next) ++n;
+    return n;
+  }
+
+ private:
+  struct alignas(std::max_align_t) Block {
+    Block *next;
+    size_t size; // usable bytes after the header
+
+    unsigned char *data() { return reinterpret_cast<unsigned char *>(this + 1); }
+  };
+
+  // Whether bytes aligned to align fit in block after from; offset is
+  // where they would start
+  static bool fits(Block *block, size_t from, size_t bytes, size_t align,
+                   size_t &offset) {
+    auto base = reinterpret_cast<uintptr_t>(block->data());
+    offset = ((base + from + align - 1) & ~(uintptr_t(align) - 1)) - base;
+    return offset + bytes <= block->size;
+  }
+
+  // Moves on to the next block that fits, or chains a new one after the
+  // current block
+  void *allocateSlow(size_t bytes, size_t align) {
+    size_t offset = 0;
+    Block *next = current_ ? current_->next : head_;
+    while (next && !fits(next, 0, bytes, align, offset)) {
+      next = next->next; // too small for this request; skipped until rewind
+    }
+    if (!next) {
+      size_t size = std::max(block_size_, bytes + align);
+      next = static_cast<Block *>(::operator new(sizeof(Block) + size));
+      next->size = size;
+      fits(next, 0, bytes, align, offset);
+      if (current_) {
+        next->next = current_->next;
+        current_->next = next;
+      } else {
+        next->next = head_;
+        head_ = next;
+      }
+    }
+    current_ = next;
+    used_ = offset + bytes;
+    return current_->data() + offset;
+  }
+
+  size_t block_size_;
+  Block *head_ = nullptr;
+  Block *current_ = nullptr;
+  size_t used_ = 0;
+};
+
+// Rewinds the thread's arena to where it was on construction
+class ArenaScope {
+ public:
+  ArenaScope() : arena_(MonotonicArena::thisThread()), mark_(arena_.mark()) {}
+  ~ArenaScope() { arena_.rewind(mark_); }
+
+  ArenaScope(const ArenaScope &) = delete;
+  ArenaScope &operator=(const ArenaScope &) = delete;
+
+  MonotonicArena &arena() { return arena_; }
+
+ private:
+  MonotonicArena &arena_;
+  MonotonicArena::Mark mark_;
+};
+
+// Standard allocator over a MonotonicArena, the calling thread's by
+// default. Containers using it must not outlive the enclosing ArenaScope.
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  ArenaAllocator() : arena_(&MonotonicArena::thisThread()) {}
+  explicit ArenaAllocator(MonotonicArena &arena) : arena_(&arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : arena_(other.arena()) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T *, size_t) {}
+
+  MonotonicArena *arena() const { return arena_; }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U> &other) const {
+    return arena_ == other.arena();
+  }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U> &other) const {
+    return arena_ != other.arena();
+  }
+
+ private:
+  MonotonicArena *arena_;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,362 @@
+#pragma once
+#include "microstructure_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Time-bucketed trade bars, aggregated as trades arrive so that long-window
+// metrics are evaluated from a bounded number of bars instead of from raw
+// trades. A bar holds OHLC, volume, signed volume, trade count and VWAP,
+// plus the sums the impact measures need over the consecutive trade pairs
+// that end in it, so Kyle's lambda and Amihud over a window of bars equal
+// their trade-level values up to the window edge (rounded out to whole
+// bars).
+
+inline int64_t floorDiv(int64_t a, int64_t b) {
+  int64_t q = a / b;
+  return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+// What a trade contributes to the impact measures as the second trade of a
+// consecutive pair. Parts that failed the measures' filters are not valid.
+struct ImpactSample {
+  bool kyle_valid = false;
+  double signed_volume = 0.0; // regressor of Kyle's lambda
+  double log_return = 0.0;
+  bool amihud_valid = false;
+  double abs_return = 0.0;
+  double dollar_volume = 0.0;
+};
+
+struct TradeBar {
+  int64_t start_ms = 0;
+  uint32_t trades = 0;
+  double open = 0.0;
+  double high = 0.0;
+  double low = 0.0;
+  double close = 0.0;
+  double volume = 0.0;
+  double signed_volume = 0.0; // buyer- minus seller-initiated volume
+  double notional = 0.0;      // Σ price × amount
+
+  // Kyle's lambda regression sums (x = signed volume, y = log return)
+  uint32_t kyle_pairs = 0;
+  double kyle_x = 0.0, kyle_y = 0.0, kyle_xy = 0.0, kyle_xx = 0.0;
+
+  // Amihud: Σ|return| and Σ dollar volume of same-day pairs
+  uint32_t amihud_pairs = 0;
+  double amihud_return = 0.0;
+  double amihud_volume = 0.0;
+
+  double vwap() const { return volume > 0 ? notional / volume : 0.0; }
+
+  void add(double price, double amount, double signed_amount,
+           const ImpactSample *pair) {
+    if (trades++ == 0) {
+      open = high = low = price;
+    } else {
+      high = std::max(high, price);
+      low = std::min(low, price);
+    }
+    close = price;
+    volume += amount;
+    signed_volume += signed_amount;
+    notional += price * amount;
+    if (!pair) return;
+    if (pair->kyle_valid) {
+      ++kyle_pairs;
+      kyle_x += pair->signed_volume;
+      kyle_y += pair->log_return;
+      kyle_xy += pair->signed_volume * pair->log_return;
+      kyle_xx += pair->signed_volume * pair->signed_volume;
+    }
+    if (pair->amihud_valid) {
+      ++amihud_pairs;
+      amihud_return += pair->abs_return;
+      amihud_volume += pair->dollar_volume;
+    }
+  }
+};
+
+// The last `capacity` bars of one interval in a fixed circular array,
+// indexed by bar number, so adding a trade is O(1) and nothing is
+// allocated after construction. Slots of periods without trades keep
+// their older bar until reused, and are skipped by the readers.
+class BarSeries {
+ public:
+  BarSeries(int64_t interval_ms, size_t capacity)
+      : interval_ms_(std::max<int64_t>(1, interval_ms)),
+        bars_(std::max<size_t>(1, capacity)) {}
+
+  int64_t intervalMs() const { return interval_ms_; }
+  size_t capacity() const { return bars_.size(); }
+  // Trades older than the series spans when they arrived
+  uint64_t lateTrades() const { return late_trades_; }
+
+  void add(int64_t timestamp_ms, double price, double amount,
+           double signed_amount, const ImpactSample *pair) {
+    int64_t number = barNumber(timestamp_ms);
+    TradeBar &bar = slot(number);
+    int64_t start = number * interval_ms_;
+    if (bar.start_ms != start || bar.trades == 0) {
+      if (bar.trades > 0 && bar.start_ms > start) {
+        ++late_trades_; // its bar was already overwritten by a newer one
+        return;
+      }
+      bar = TradeBar{};
+      bar.start_ms = start;
+    }
+    bar.add(price, amount, signed_amount, pair);
+  }
+
+  // Bars are numbered by start time / interval
+  int64_t barNumber(int64_t timestamp_ms) const {
+    return floorDiv(timestamp_ms, interval_ms_);
+  }
+
+  // Bar number, if it is kept and has trades
+  const TradeBar *bar(int64_t number) const {
+    const TradeBar &b = bars_[slotIndex(number)];
+    return b.trades > 0 && b.start_ms == number * interval_ms_ ? &b : nullptr;
+  }
+
+  // The bar covering timestamp_ms, if it is kept and has trades
+  const TradeBar *find(int64_t timestamp_ms) const {
+    return bar(barNumber(timestamp_ms));
+  }
+
+  // Calls f(bar) for every bar with trades that overlaps
+  // [now_ms - window_ms, now_ms], newest first. O(window / interval).
+  template <typename F>
+  void forEach(int64_t now_ms, int64_t window_ms, F &&f) const {
+    int64_t newest = barNumber(now_ms);
+    int64_t oldest = std::max(newest - static_cast<int64_t>(bars_.size()) + 1,
+                              barNumber(now_ms - window_ms));
+    for (int64_t number = newest; number >= oldest; --number) {
+      if (const TradeBar *b = bar(number)) f(*b);
+    }
+  }
+
+ private:
+  size_t slotIndex(int64_t number) const {
+    auto n = static_cast<int64_t>(bars_.size());
+    return static_cast<size_t>(((number % n) + n) % n);
+  }
+
+  TradeBar &slot(int64_t number) { return bars_[slotIndex(number)]; }
+
+  int64_t interval_ms_;
+  std::vector<TradeBar> bars_;
+  uint64_t late_trades_ = 0;
+};
+
+// Kyle's lambda and Amihud over the bars of a series that overlap a
+// trailing window. Running regression sums and per-day Amihud totals are
+// kept current as trades arrive, and whole bars are subtracted as they age
+// out, so a read is O(1) for Kyle's lambda and O(days) for Amihud instead
+// of O(bars). The window must be shorter than the series spans.
+class ImpactWindow {
+ public:
+  static constexpr int64_t DAY_IN_MS = 86400000LL;
+
+  ImpactWindow(const BarSeries &series, int64_t window_ms)
+      : series_(series), window_ms_(window_ms),
+        days_(static_cast<size_t>(window_ms / DAY_IN_MS) + 2) {}
+
+  // Call before the series takes the trade, so a rebuild here does not
+  // count it twice
+  void add(int64_t timestamp_ms, const ImpactSample &pair) {
+    expire(timestamp_ms);
+    if (series_.barNumber(timestamp_ms) < first_) return; // already aged out
+    apply(timestamp_ms, pair.kyle_valid, pair.signed_volume, pair.log_return,
+          pair.amihud_valid, pair.abs_return, pair.dollar_volume);
+  }
+
+  // Drops bars that ended before now_ms - window
+  void expire(int64_t now_ms) {
+    int64_t cutoff = series_.barNumber(now_ms - window_ms_);
+    if (first_ == INT64_MIN) first_ = cutoff;
+    if (cutoff <= first_) return;
+    if (cutoff - first_ >= static_cast<int64_t>(series_.capacity())) {
+      first_ = cutoff; // everything tracked is gone, or its slots reused
+      rebuild(now_ms);
+      return;
+    }
+    for (; first_ < cutoff; ++first_) {
+      if (const TradeBar *bar = series_.bar(first_)) remove(*bar);
+    }
+    if (removals_ >= series_.capacity()) rebuild(now_ms);
+  }
+
+  double kylesLambda(int64_t now_ms) {
+    expire(now_ms);
+    return WindowedRegression::slopeOf(kyle_n_, sx_, sy_, sxy_, sxx_);
+  }
+
+  // Mean across days of Σ|return| / Σ dollar volume
+  double amihudMeasure(int64_t now_ms) {
+    expire(now_ms);
+    double ratio_sum = 0.0;
+    size_t valid_days = 0;
+    for (const Day &d : days_) {
+      if (d.pairs == 0 || !(d.volume > 0)) continue;
+      double ratio = d.abs_return / d.volume;
+      if (std::isfinite(ratio)) {
+        ratio_sum += ratio;
+        ++valid_days;
+      }
+    }
+    return valid_days > 0 ? ratio_sum / valid_days : 0.0;
+  }
+
+ private:
+  struct Day {
+    int64_t day = 0;
+    size_t pairs = 0;
+    double abs_return = 0.0;
+    double volume = 0.0;
+  };
+
+  Day &daySlot(int64_t day) {
+    auto n = static_cast<int64_t>(days_.size());
+    return days_[static_cast<size_t>(((day % n) + n) % n)];
+  }
+
+  // Totals of the day of timestamp_ms. A slot holding another day holds
+  // one that has left the window.
+  Day &dayFor(int64_t timestamp_ms) {
+    int64_t day = floorDiv(timestamp_ms, DAY_IN_MS);
+    Day &d = daySlot(day);
+    if (d.day != day) d = Day{day};
+    return d;
+  }
+
+  void apply(int64_t timestamp_ms, bool kyle, double x, double y, bool amihud,
+             double abs_return, double volume) {
+    if (kyle) {
+      ++kyle_n_;
+      sx_ += x;
+      sy_ += y;
+      sxy_ += x * y;
+      sxx_ += x * x;
+    }
+    if (amihud) {
+      Day &d = dayFor(timestamp_ms);
+      ++d.pairs;
+      d.abs_return += abs_return;
+      d.volume += volume;
+    }
+  }
+
+  void addBar(const TradeBar &bar) {
+    kyle_n_ += bar.kyle_pairs;
+    sx_ += bar.kyle_x;
+    sy_ += bar.kyle_y;
+    sxy_ += bar.kyle_xy;
+    sxx_ += bar.kyle_xx;
+    if (bar.amihud_pairs > 0) {
+      Day &d = dayFor(bar.start_ms);
+      d.pairs += bar.amihud_pairs;
+      d.abs_return += bar.amihud_return;
+      d.volume += bar.amihud_volume;
+    }
+  }
+
+  void remove(const TradeBar &bar) {
+    ++removals_;
+    if (bar.kyle_pairs > 0) {
+      kyle_n_ -= bar.kyle_pairs;
+      if (kyle_n_ == 0) {
+        sx_ = sy_ = sxy_ = sxx_ = 0.0;
+      } else {
+        sx_ -= bar.kyle_x;
+        sy_ -= bar.kyle_y;
+        sxy_ -= bar.kyle_xy;
+        sxx_ -= bar.kyle_xx;
+      }
+    }
+    int64_t day = floorDiv(bar.start_ms, DAY_IN_MS);
+    Day &d = daySlot(day);
+    if (bar.amihud_pairs > 0 && d.day == day) {
+      d.pairs -= std::min<size_t>(d.pairs, bar.amihud_pairs);
+      if (d.pairs == 0) {
+        d = Day{d.day};
+      } else {
+        d.abs_return -= bar.amihud_return;
+        d.volume -= bar.amihud_volume;
+      }
+    }
+  }
+
+  // Re-sums the bars still in the window, bounding rounding drift
+  void rebuild(int64_t now_ms) {
+    kyle_n_ = 0;
+    sx_ = sy_ = sxy_ = sxx_ = 0.0;
+    for (Day &d : days_) d = Day{};
+    series_.forEach(now_ms, window_ms_, [this](const TradeBar &bar) {
+      if (series_.barNumber(bar.start_ms) >= first_) addBar(bar);
+    });
+    removals_ = 0;
+  }
+
+  const BarSeries &series_;
+  int64_t window_ms_;
+  int64_t first_ = INT64_MIN; // oldest bar number counted
+  size_t kyle_n_ = 0;
+  double sx_ = 0.0, sy_ = 0.0, sxy_ = 0.0, sxx_ = 0.0;
+  std::vector<Day> days_;
+  size_t removals_ = 0;
+};
+
+// 1 second, 1 minute and 1 hour bars of one instrument, spanning the last
+// hour, day and 90 days (about 0.9 MB in all), and the long impact windows
+// over them: Kyle's lambda over a day of minute bars and Amihud over 30 and
+// 90 days of hour bars
+class BarBuilder {
+ public:
+  static constexpr int64_t SECOND_MS = 1000;
+  static constexpr int64_t MINUTE_MS = 60 * SECOND_MS;
+  static constexpr int64_t HOUR_MS = 60 * MINUTE_MS;
+  static constexpr int64_t DAY_MS = 24 * HOUR_MS;
+
+  BarBuilder()
+      : seconds_(SECOND_MS, 3600 + 60), minutes_(MINUTE_MS, 24 * 60 + 60),
+        hours_(HOUR_MS, 91 * 24), daily_(minutes_, DAY_MS),
+        thirty_days_(hours_, 30 * DAY_MS), ninety_days_(hours_, 90 * DAY_MS) {}
+
+  // The windows point into the series
+  BarBuilder(const BarBuilder &) = delete;
+  BarBuilder &operator=(const BarBuilder &) = delete;
+
+  // pair is the trade's contribution as the second of a consecutive pair,
+  // null for the first trade
+  void add(int64_t timestamp_ms, double price, double amount,
+           double signed_amount, const ImpactSample *pair) {
+    if (pair) {
+      daily_.add(timestamp_ms, *pair);
+      thirty_days_.add(timestamp_ms, *pair);
+      ninety_days_.add(timestamp_ms, *pair);
+    }
+    seconds_.add(timestamp_ms, price, amount, signed_amount, pair);
+    minutes_.add(timestamp_ms, price, amount, signed_amount, pair);
+    hours_.add(timestamp_ms, price, amount, signed_amount, pair);
+  }
+
+  const BarSeries &seconds() const { return seconds_; }
+  const BarSeries &minutes() const { return minutes_; }
+  const BarSeries &hours() const { return hours_; }
+
+  // Reads expire aged-out bars
+  ImpactWindow &daily() { return daily_; }
+  ImpactWindow &thirtyDays() { return thirty_days_; }
+  ImpactWindow &ninetyDays() { return ninety_days_; }
+
+ private:
+  BarSeries seconds_;
+  BarSeries minutes_;
+  BarSeries hours_;
+  ImpactWindow daily_;
+  ImpactWindow thirty_days_;
+  ImpactWindow ninety_days_;
+};
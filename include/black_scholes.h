@@ -0,0 +1,180 @@
+#pragma once
+#include "black_scholes_batch.h"
+#include "output_sink.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <string>
+#include <string_view>
+
+// Closed-form Black-Scholes Greeks of a single option, with the implied
+// volatility solved from its quoted price.
+
+// Mathematical functions for Black-Scholes
+class BlackScholesCalculator {
+private:
+  // Cumulative standard normal distribution
+  static double normalCDF(double x) {
+    return 0.5 * (1.0 + std::erf(x / std::sqrt(2.0)));
+  }
+
+  // Standard normal probability density function
+  static double normalPDF(double x) {
+    return (1.0 / std::sqrt(2.0 * M_PI)) * std::exp(-0.5 * x * x);
+  }
+
+  // Calculate d1 parameter
+  static double calculateD1(double S, double K, double T, double r,
+                            double sigma) {
+    return (std::log(S / K) + (r + 0.5 * sigma * sigma) * T) /
+           (sigma * std::sqrt(T));
+  }
+
+  // Calculate d2 parameter
+  static double calculateD2(double d1, double sigma, double T) {
+    return d1 - sigma * std::sqrt(T);
+  }
+
+public:
+  struct OptionData {
+    double spot_price;     // Current price of underlying
+    double strike_price;   // Strike price
+    double time_to_expiry; // Time to expiration in years
+    double risk_free_rate; // Risk-free interest rate
+    double volatility;     // Implied volatility
+    bool is_call;          // true for call, false for put
+
+    // Market data
+    double option_price;
+    double volume;
+    double open_interest;
+  };
+
+  struct Greeks {
+    double delta;
+    double gamma;
+    double theta;
+    double vega;
+    double rho;
+    double intrinsic_value;
+    double extrinsic_value;
+    double implied_volatility;
+  };
+
+  static Greeks calculateGreeks(const OptionData &data) {
+    Greeks greeks;
+
+    double S = data.spot_price;
+    double K = data.strike_price;
+    double T = data.time_to_expiry;
+    double r = data.risk_free_rate;
+    double sigma = data.volatility;
+
+    // sqrt(T) and the discount factor are shared by every term below
+    double sqrt_t = std::sqrt(T);
+    double disc = std::exp(-r * T);
+    double d1 = calculateD1(S, K, T, r, sigma);
+    double d2 = calculateD2(d1, sigma, T);
+
+    double Nd1 = normalCDF(d1);
+    double Nd2 = normalCDF(d2);
+    double nd1 = normalPDF(d1);
+
+    if (data.is_call) {
+      // Call option Greeks
+      greeks.delta = Nd1;
+      greeks.gamma = nd1 / (S * sigma * sqrt_t);
+      greeks.theta = -(S * nd1 * sigma) / (2 * sqrt_t) - r * K * disc * Nd2;
+      greeks.vega = S * nd1 * sqrt_t;
+      greeks.rho = K * T * disc * Nd2;
+
+      greeks.intrinsic_value = std::max(0.0, S - K);
+    } else {
+      // Put option Greeks
+      double Nmd2 = 1.0 - Nd2;
+      greeks.delta = Nd1 - 1.0;
+      greeks.gamma = nd1 / (S * sigma * sqrt_t);
+      greeks.theta = -(S * nd1 * sigma) / (2 * sqrt_t) + r * K * disc * Nmd2;
+      greeks.vega = S * nd1 * sqrt_t;
+      greeks.rho = -K * T * disc * Nmd2;
+
+      greeks.intrinsic_value = std::max(0.0, K - S);
+    }
+
+    // Convert theta to per day (divide by 365)
+    greeks.theta /= 365.0;
+
+    // Convert vega to per 1% change in volatility (divide by 100)
+    greeks.vega /= 100.0;
+
+    // Convert rho to per 1% change in interest rate (divide by 100)
+    greeks.rho /= 100.0;
+
+    greeks.extrinsic_value = data.option_price - greeks.intrinsic_value;
+
+    // Solve from the quoted price; keep the input vol if it has none or
+    // the price violates the no-arbitrage bounds
+    double iv = impliedVolatility(data, data.volatility);
+    greeks.implied_volatility = std::isfinite(iv) ? iv : data.volatility;
+
+    return greeks;
+  }
+
+  // Volatility implied by data.option_price, NaN if it cannot be solved.
+  // A previous solution as guess makes convergence take one or two steps.
+  static double impliedVolatility(const OptionData &data, double guess = 0.0,
+                                  int *iterations = nullptr) {
+    int steps = 0;
+    double iv = ImpliedVol::solve(data.spot_price, data.strike_price,
+                                  data.time_to_expiry, data.risk_free_rate,
+                                  data.is_call, data.option_price, guess,
+                                  steps);
+    if (iterations) *iterations = steps;
+    return iv;
+  }
+
+  // Titled "symbol description", e.g. "BTCUSDT Call Option"
+  static void printGreeks(std::string_view symbol, std::string_view description,
+                          const OptionData &data, const Greeks &greeks) {
+    OutputLine out;
+    if (!out.active()) return;
+    out << "\n" << Repeat{'=', 60} << "\n";
+    out << "OPTIONS ANALYSIS FOR: " << symbol;
+    if (!description.empty()) out << " " << description;
+    out << "\n";
+    out << Repeat{'=', 60} << "\n";
+
+    out << std::fixed << std::setprecision(4);
+
+    out << "\nMARKET DATA:\n";
+    out << "  Spot Price:        $" << data.spot_price << "\n";
+    out << "  Strike Price:      $" << data.strike_price << "\n";
+    out << "  Option Price:      $" << data.option_price << "\n";
+    out << "  Time to Expiry:    " << data.time_to_expiry << " years\n";
+    out << "  Volume:            " << data.volume << "\n";
+    out << "  Open Interest:     " << data.open_interest << "\n";
+
+    out << "\nOPTION VALUES:\n";
+    out << "  Intrinsic Value:   $" << greeks.intrinsic_value << "\n";
+    out << "  Extrinsic Value:   $" << greeks.extrinsic_value << "\n";
+    out << "  Implied Volatility: " << (greeks.implied_volatility * 100)
+        << "%\n";
+
+    out << "\nTHE GREEKS:\n";
+    out << "  Delta (Δ):         " << greeks.delta << "\n";
+    out << "  Gamma (Γ):         " << greeks.gamma << "\n";
+    out << "  Theta (Θ):         $" << greeks.theta << " per day\n";
+    out << "  Vega (ν):          $" << greeks.vega << " per 1% IV\n";
+    out << "  Rho (ρ):           $" << greeks.rho << " per 1% rate\n";
+
+    out << "\nGREEKS INTERPRETATION:\n";
+    out << "  Delta: Option price changes by $" << std::abs(greeks.delta)
+        << " for each $1 move in underlying\n";
+    out << "  Gamma: Delta changes by " << greeks.gamma
+        << " for each $1 move in underlying\n";
+    out << "  Theta: Option loses $" << std::abs(greeks.theta)
+        << " in value each day (time decay)\n";
+    out << "  Vega: Option price changes by $" << std::abs(greeks.vega)
+        << " for each 1% change in volatility\n";
+  }
+};
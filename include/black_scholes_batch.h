@@ -0,0 +1,425 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Branch-free approximations for the batch pricer. They are plain double
+// arithmetic (selects instead of branches, bit casts instead of libm calls)
+// so loops over them auto-vectorize.
+namespace FastMath {
+constexpr double LOG2E = 1.4426950408889634;
+constexpr double LN2_HI = 6.93147180369123816490e-01;
+constexpr double LN2_LO = 1.90821492927058770002e-10;
+constexpr double INV_SQRT_2PI = 0.3989422804014327;
+// Adding 1.5 * 2^52 rounds to an integer held in the low mantissa bits
+constexpr double ROUND_MAGIC = 6755399441055744.0;
+
+// e^x for x <= 0, clamped at -708. Cody-Waite range reduction to
+// |r| <= ln2/2 and a degree-11 Taylor polynomial; relative error < 1e-14.
+inline double expNonPositive(double x) {
+  x = std::min(std::max(x, -708.0), 0.0);
+  double shifted = x * LOG2E + ROUND_MAGIC;
+  double n = shifted - ROUND_MAGIC;
+  double r = (x - n * LN2_HI) - n * LN2_LO;
+  double p = 1.0 / 39916800.0;
+  p = p * r + 1.0 / 3628800.0;
+  p = p * r + 1.0 / 362880.0;
+  p = p * r + 1.0 / 40320.0;
+  p = p * r + 1.0 / 5040.0;
+  p = p * r + 1.0 / 720.0;
+  p = p * r + 1.0 / 120.0;
+  p = p * r + 1.0 / 24.0;
+  p = p * r + 1.0 / 6.0;
+  p = p * r + 0.5;
+  p = p * r + 1.0;
+  p = p * r + 1.0;
+  int64_t bits, magic_bits;
+  std::memcpy(&bits, &shifted, sizeof(bits));
+  std::memcpy(&magic_bits, &ROUND_MAGIC, sizeof(magic_bits));
+  int64_t scale_bits = (bits - magic_bits + 1023) << 52;
+  double scale;
+  std::memcpy(&scale, &scale_bits, sizeof(scale));
+  return p * scale;
+}
+
+inline double normalPdf(double x) {
+  return INV_SQRT_2PI * expNonPositive(-0.5 * x * x);
+}
+
+// N(x) given pdf = n(x): Abramowitz & Stegun 26.2.17, |error| < 7.5e-8.
+inline double normalCdfFromPdf(double x, double pdf) {
+  double t = 1.0 / (1.0 + 0.2316419 * std::abs(x));
+  double poly =
+      t * (0.319381530 +
+           t * (-0.356563782 +
+                t * (1.781477937 + t * (-1.821255978 + t * 1.330274429))));
+  double tail = pdf * poly;
+  return x >= 0.0 ? 1.0 - tail : tail;
+}
+
+constexpr double FAST_CDF_ERROR = 7.5e-8;
+} // namespace FastMath
+
+// A chain of options on one underlying in structure-of-arrays form, grouped
+// by expiry: addExpiry() opens a group and addOption() appends to it, so
+// per-expiry terms are computed once per group. log(strike) is cached since
+// strikes outlive many spot ticks.
+class OptionChain {
+ public:
+  struct Expiry {
+    double time_to_expiry; // years
+    size_t begin;          // first option index
+    size_t end;
+  };
+
+  size_t addExpiry(double time_to_expiry) {
+    expiries_.push_back({time_to_expiry, strike.size(), strike.size()});
+    return expiries_.size() - 1;
+  }
+
+  // Appends to the most recently added expiry; returns the option index.
+  size_t addOption(double strike_price, double volatility, bool is_call) {
+    if (expiries_.empty()) addExpiry(0.0);
+    strike.push_back(strike_price);
+    log_strike.push_back(std::log(strike_price));
+    vol.push_back(volatility);
+    call.push_back(is_call ? 1 : 0);
+    expiries_.back().end = strike.size();
+    return strike.size() - 1;
+  }
+
+  size_t size() const { return strike.size(); }
+  const std::vector<Expiry> &expiries() const { return expiries_; }
+
+  void clear() {
+    expiries_.clear();
+    strike.clear();
+    log_strike.clear();
+    vol.clear();
+    call.clear();
+  }
+
+  // Columns, indexed by option. vol may be updated in place between prices.
+  std::vector<double> strike;
+  std::vector<double> log_strike;
+  std::vector<double> vol;
+  std::vector<uint8_t> call;
+
+ private:
+  std::vector<Expiry> expiries_;
+};
+
+// Greeks for a chain, one column per output, in the units of
+// BlackScholesCalculator::Greeks (theta per day, vega and rho per 1%).
+struct ChainGreeks {
+  std::vector<double> price;
+  std::vector<double> delta;
+  std::vector<double> gamma;
+  std::vector<double> theta;
+  std::vector<double> vega;
+  std::vector<double> rho;
+
+  void resize(size_t n) {
+    price.resize(n);
+    delta.resize(n);
+    gamma.resize(n);
+    theta.resize(n);
+    vega.resize(n);
+    rho.resize(n);
+  }
+
+  size_t size() const { return price.size(); }
+
+  // Second-order spot update of options [begin, end) from a full pricing
+  // in base: price and delta move along delta and gamma, the other Greeks
+  // keep their base values until the next reprice.
+  void taylorFrom(const ChainGreeks &base, double spot_move, size_t begin,
+                  size_t end) {
+    resize(base.size());
+    for (size_t i = begin; i < end; ++i) {
+      price[i] = base.price[i] + spot_move * (base.delta[i] +
+                                              0.5 * spot_move * base.gamma[i]);
+      delta[i] = base.delta[i] + spot_move * base.gamma[i];
+      gamma[i] = base.gamma[i];
+      theta[i] = base.theta[i];
+      vega[i] = base.vega[i];
+      rho[i] = base.rho[i];
+    }
+  }
+};
+
+// Prices whole chains. The tolerance is the largest acceptable error in
+// N(x): at FastMath::FAST_CDF_ERROR or above the vectorizable polynomial is
+// used, below it std::erfc. Expired or zero-vol options are priced with
+// sigma * sqrt(T) floored at MIN_STDDEV rather than producing NaN.
+class BatchBlackScholes {
+ public:
+  static constexpr double MIN_STDDEV = 1e-8;
+
+  explicit BatchBlackScholes(double cdf_tolerance = 1e-7)
+      : fast_(cdf_tolerance >= FastMath::FAST_CDF_ERROR) {}
+
+  bool usesFastCdf() const { return fast_; }
+
+  void price(double spot, double rate, const OptionChain &chain,
+             ChainGreeks &out) const {
+    out.resize(chain.size());
+    if (chain.size() == 0 || !(spot > 0.0)) return;
+    double log_spot = std::log(spot);
+    for (const auto &expiry : chain.expiries()) {
+      if (fast_) {
+        priceExpiry<true>(spot, log_spot, rate, expiry, chain, out);
+      } else {
+        priceExpiry<false>(spot, log_spot, rate, expiry, chain, out);
+      }
+    }
+  }
+
+  // Reprices only chain.expiries()[expiry], leaving the rest of out as is.
+  void price(double spot, double rate, const OptionChain &chain,
+             size_t expiry, ChainGreeks &out) const {
+    out.resize(chain.size());
+    if (expiry >= chain.expiries().size() || !(spot > 0.0)) return;
+    const auto &e = chain.expiries()[expiry];
+    if (fast_) {
+      priceExpiry<true>(spot, std::log(spot), rate, e, chain, out);
+    } else {
+      priceExpiry<false>(spot, std::log(spot), rate, e, chain, out);
+    }
+  }
+
+ private:
+  template <bool Fast>
+  static void priceExpiry(double spot, double log_spot, double rate,
+                          const OptionChain::Expiry &expiry,
+                          const OptionChain &chain, ChainGreeks &out) {
+    // Shared by every strike of the expiry
+    const double T = std::max(expiry.time_to_expiry, 0.0);
+    size_t b = expiry.begin;
+    kernel<Fast>(expiry.end - b, spot, log_spot, rate, T, std::sqrt(T),
+                 std::exp(-rate * T), chain.strike.data() + b,
+                 chain.log_strike.data() + b, chain.vol.data() + b,
+                 chain.call.data() + b, out.price.data() + b,
+                 out.delta.data() + b, out.gamma.data() + b,
+                 out.theta.data() + b, out.vega.data() + b,
+                 out.rho.data() + b);
+  }
+
+  // Restrict-qualified columns let the compiler vectorize without runtime
+  // alias checks.
+  template <bool Fast>
+  static void kernel(size_t n, double spot, double log_spot, double rate,
+                     double T, double sqrt_t, double disc,
+                     const double *__restrict strike,
+                     const double *__restrict log_strike,
+                     const double *__restrict vol,
+                     const uint8_t *__restrict call, double *__restrict price,
+                     double *__restrict delta, double *__restrict gamma,
+                     double *__restrict theta, double *__restrict vega,
+                     double *__restrict rho) {
+    const double inv_sqrt_t = 1.0 / std::max(sqrt_t, MIN_STDDEV);
+    for (size_t i = 0; i < n; ++i) {
+      double sigma = vol[i];
+      double K = strike[i];
+      double stddev = std::max(sigma * sqrt_t, MIN_STDDEV);
+      double d1 = (log_spot - log_strike[i] + (rate + 0.5 * sigma * sigma) * T) /
+                  stddev;
+      double d2 = d1 - stddev;
+      double kd = K * disc;
+
+      double nd1, Nd1, Nd2;
+      if (Fast) {
+        nd1 = FastMath::normalPdf(d1);
+        // n(d2) = n(d1) * S / (K e^{-rT}) saves the second exponential
+        double nd2 = nd1 * spot / kd;
+        Nd1 = FastMath::normalCdfFromPdf(d1, nd1);
+        Nd2 = FastMath::normalCdfFromPdf(d2, nd2);
+      } else {
+        nd1 = FastMath::INV_SQRT_2PI * std::exp(-0.5 * d1 * d1);
+        Nd1 = 0.5 * std::erfc(-d1 * M_SQRT1_2);
+        Nd2 = 0.5 * std::erfc(-d2 * M_SQRT1_2);
+      }
+
+      double is_put = 1.0 - static_cast<double>(call[i]); // call is 0 or 1
+      // Put terms via parity: N(-d) = 1 - N(d)
+      double Nd2_signed = Nd2 - is_put;
+      double call_price = spot * Nd1 - kd * Nd2;
+
+      price[i] = call_price - is_put * (spot - kd);
+      delta[i] = Nd1 - is_put;
+      gamma[i] = nd1 / (spot * stddev);
+      theta[i] = (-(spot * nd1 * sigma) * 0.5 * inv_sqrt_t -
+                  rate * kd * Nd2_signed) /
+                 365.0;
+      vega[i] = spot * nd1 * sqrt_t / 100.0;
+      rho[i] = K * T * disc * Nd2_signed / 100.0;
+    }
+  }
+
+  bool fast_;
+};
+
+// Implied volatility by Halley iteration on vega, safeguarded by a shrinking
+// bracket. Cold starts use the Corrado-Miller rational approximation;
+// callers with a previous solution pass it as the guess, which usually
+// converges in one or two steps.
+namespace ImpliedVol {
+constexpr double MIN_VOL = 1e-4;
+constexpr double MAX_VOL = 10.0;
+
+// Corrado-Miller (1996) estimate of sigma from a call price.
+inline double initialGuess(double spot, double strike, double T, double rate,
+                           double call_price) {
+  double x = strike * std::exp(-rate * T);
+  double half_moneyness = 0.5 * (spot - x);
+  double a = call_price - half_moneyness;
+  double disc = a * a - (spot - x) * (spot - x) / M_PI;
+  double sigma_sqrt_t =
+      std::sqrt(2.0 * M_PI) / (spot + x) * (a + std::sqrt(std::max(disc, 0.0)));
+  double sigma = T > 0 ? sigma_sqrt_t / std::sqrt(T) : 0.0;
+  return std::isfinite(sigma) && sigma > MIN_VOL ? std::min(sigma, MAX_VOL)
+                                                 : 0.5;
+}
+
+// Solves for sigma given an option price. Returns NaN when the price is
+// outside the no-arbitrage bounds or the iteration does not converge.
+// guess <= 0 requests a cold start; iterations receives the step count.
+//
+// The solve runs on the out-of-the-money side (converting by parity) and on
+// log price, which is close to linear in sigma even far from the money, so
+// deep OTM wings converge as fast as the ATM strikes.
+inline double solve(double spot, double strike, double T, double rate,
+                    bool is_call, double price, double guess,
+                    int &iterations, double tolerance = 1e-10,
+                    int max_iterations = 32) {
+  iterations = 0;
+  if (!(spot > 0) || !(strike > 0) || !(T > 0) || !(price > 0)) return NAN;
+  double sqrt_t = std::sqrt(T);
+  double kd = strike * std::exp(-rate * T);
+  bool otm_call = kd >= spot;
+  double target = price;
+  if (is_call != otm_call) {
+    target = is_call ? price - spot + kd : price + spot - kd;
+  }
+  if (!(target > 0) || !(target < (otm_call ? spot : kd))) return NAN;
+  double log_target = std::log(target);
+
+  double sigma = guess;
+  if (!(sigma > MIN_VOL && sigma < MAX_VOL)) {
+    double call_price = otm_call ? target : target + spot - kd;
+    sigma = initialGuess(spot, strike, T, rate, call_price);
+  }
+  double lo = MIN_VOL, hi = MAX_VOL;
+  double log_moneyness = std::log(spot / strike) + rate * T;
+  for (iterations = 1; iterations <= max_iterations; ++iterations) {
+    double stddev = sigma * sqrt_t;
+    double d1 = log_moneyness / stddev + 0.5 * stddev;
+    double d2 = d1 - stddev;
+    double model = otm_call ? spot * 0.5 * std::erfc(-d1 * M_SQRT1_2) -
+                                  kd * 0.5 * std::erfc(-d2 * M_SQRT1_2)
+                            : kd * 0.5 * std::erfc(d2 * M_SQRT1_2) -
+                                  spot * 0.5 * std::erfc(d1 * M_SQRT1_2);
+    double next = NAN;
+    if (model > 0) {
+      double f = std::log(model) - log_target;
+      // Price is increasing in sigma, so the sign of f narrows the bracket
+      if (f > 0) {
+        hi = std::min(hi, sigma);
+      } else {
+        lo = std::max(lo, sigma);
+      }
+      double vega = spot * FastMath::INV_SQRT_2PI *
+                    std::exp(-0.5 * d1 * d1) * sqrt_t;
+      double g = vega / model; // d ln(price) / d sigma
+      if (g > 1e-300) {
+        // Halley on ln(price): f'' = volga / model - g^2
+        double newton = f / g;
+        double curvature = (vega * d1 * d2 / sigma) / model - g * g;
+        double denom = 1.0 - 0.5 * newton * curvature / g;
+        next = sigma - (denom > 0.5 ? newton / denom : newton);
+      }
+    } else {
+      lo = std::max(lo, sigma); // underflow: sigma is far too low
+    }
+    if (std::abs(next - sigma) < tolerance * std::max(1.0, sigma)) {
+      return next;
+    }
+    if (!(next > lo && next < hi)) next = 0.5 * (lo + hi); // bisect
+    if (hi - lo < tolerance) return 0.5 * (lo + hi);
+    sigma = next;
+  }
+  return NAN;
+}
+} // namespace ImpliedVol
+
+// Solves implied vols for a whole chain from observed option prices, warm
+// starting each option from its previous solution.
+class ImpliedVolSolver {
+ public:
+  struct Stats {
+    uint64_t solved = 0;
+    uint64_t failed = 0;
+    uint64_t iterations = 0;
+    int max_iterations = 0;
+    uint64_t warm_starts = 0;
+
+    double meanIterations() const {
+      uint64_t n = solved + failed;
+      return n ? static_cast<double>(iterations) / n : 0.0;
+    }
+  };
+
+  explicit ImpliedVolSolver(double tolerance = 1e-10, int max_iterations = 32)
+      : tolerance_(tolerance), max_iterations_(max_iterations) {}
+
+  // Writes the implied vol for each option of chain priced at prices[i]
+  // into vols (NaN on failure) and returns this call's statistics.
+  // Solutions are remembered per option index for the next call.
+  Stats solve(double spot, double rate, const OptionChain &chain,
+              const double *prices, std::vector<double> &vols) {
+    Stats stats;
+    vols.resize(chain.size());
+    if (previous_.size() != chain.size()) previous_.assign(chain.size(), 0.0);
+    for (const auto &expiry : chain.expiries()) {
+      for (size_t i = expiry.begin; i < expiry.end; ++i) {
+        double guess = previous_[i];
+        if (guess > 0) ++stats.warm_starts;
+        int iterations = 0;
+        double sigma = ImpliedVol::solve(
+            spot, chain.strike[i], expiry.time_to_expiry, rate,
+            chain.call[i] != 0, prices[i], guess, iterations, tolerance_,
+            max_iterations_);
+        stats.iterations += static_cast<uint64_t>(iterations);
+        stats.max_iterations = std::max(stats.max_iterations, iterations);
+        if (std::isfinite(sigma)) {
+          ++stats.solved;
+          previous_[i] = sigma;
+        } else {
+          ++stats.failed;
+          previous_[i] = 0.0; // cold start next time
+        }
+        vols[i] = sigma;
+      }
+    }
+    total_.solved += stats.solved;
+    total_.failed += stats.failed;
+    total_.iterations += stats.iterations;
+    total_.warm_starts += stats.warm_starts;
+    total_.max_iterations = std::max(total_.max_iterations, stats.max_iterations);
+    return stats;
+  }
+
+  // Forget warm starts, e.g. after the chain's strikes change.
+  void reset() { previous_.clear(); }
+
+  const Stats &totals() const { return total_; }
+
+ private:
+  double tolerance_;
+  int max_iterations_;
+  std::vector<double> previous_;
+  Stats total_;
+};
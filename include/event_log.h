@@ -0,0 +1,380 @@
+#pragma once
+#include "ccapi_cpp/ccapi_session.h"
+#include "output_sink.h"
+#include "simple_config.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Binary event log of ccapi events, used to record live sessions and replay
+// them deterministically through the same EventHandler implementations.
+//
+// Layout (host byte order):
+//   header:  "CCEVLOG1" | u32 version
+//   records: u8 tag, then
+//     TAG_STRING: u16 id | u16 len | bytes          (interned name / id)
+//     TAG_EVENT:  u8 event type | u32 message count | messages
+//   message:  u8 type | u8 recap type | i64 exchange time ns |
+//             i64 receive time ns | u8 correlation id count | u16 ids... |
+//             u16 element count | elements
+//   element:  u16 field count | (u16 name id | u16 value len | bytes)...
+namespace EventLog {
+constexpr char MAGIC[8] = {'C', 'C', 'E', 'V', 'L', 'O', 'G', '1'};
+constexpr uint32_t VERSION = 1;
+constexpr uint8_t TAG_STRING = 1;
+constexpr uint8_t TAG_EVENT = 2;
+
+inline int64_t toNanos(const ccapi::TimePoint &tp) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             tp.time_since_epoch())
+      .count();
+}
+} // namespace EventLog
+
+// Appends ccapi events to an event log. Thread-safe; field names and
+// correlation ids are interned so each is written once.
+class EventRecorder {
+ public:
+  explicit EventRecorder(const std::string &path) : buffer_(1 << 16) {
+    out_.rdbuf()->pubsetbuf(buffer_.data(),
+                            static_cast<std::streamsize>(buffer_.size()));
+    out_.open(path, std::ios::binary | std::ios::trunc);
+    if (!out_) throw std::runtime_error("Cannot open event log: " + path);
+    out_.write(EventLog::MAGIC, sizeof(EventLog::MAGIC));
+    put<uint32_t>(EventLog::VERSION);
+  }
+
+  ~EventRecorder() { flush(); }
+
+  void record(const ccapi::Event &event) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto &messages = event.getMessageList();
+    // Intern first so definitions precede the event record
+    for (const auto &message : messages) {
+      for (const auto &id : message.getCorrelationIdList()) intern(id);
+      for (const auto &element : message.getElementList()) {
+        for (const auto &pair : element.getNameValueMap()) intern(pair.first);
+      }
+    }
+    put<uint8_t>(EventLog::TAG_EVENT);
+    put<uint8_t>(static_cast<uint8_t>(event.getType()));
+    put<uint32_t>(static_cast<uint32_t>(messages.size()));
+    for (const auto &message : messages) {
+      put<uint8_t>(static_cast<uint8_t>(message.getType()));
+      put<uint8_t>(static_cast<uint8_t>(message.getRecapType()));
+      put<int64_t>(EventLog::toNanos(message.getTime()));
+      put<int64_t>(EventLog::toNanos(message.getTimeReceived()));
+      const auto &ids = message.getCorrelationIdList();
+      put<uint8_t>(static_cast<uint8_t>(ids.size()));
+      for (const auto &id : ids) put<uint16_t>(intern(id));
+      const auto &elements = message.getElementList();
+      put<uint16_t>(static_cast<uint16_t>(elements.size()));
+      for (const auto &element : elements) {
+        const auto &fields = element.getNameValueMap();
+        put<uint16_t>(static_cast<uint16_t>(fields.size()));
+        for (const auto &pair : fields) {
+          put<uint16_t>(intern(pair.first));
+          putBytes(pair.second);
+        }
+      }
+    }
+    ++events_;
+  }
+
+  void flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_.flush();
+  }
+
+  uint64_t eventsRecorded() const { return events_; }
+
+ private:
+  template <typename T>
+  void put(T value) {
+    out_.write(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  void putBytes(std::string_view bytes) {
+    put<uint16_t>(static_cast<uint16_t>(bytes.size()));
+    out_.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  }
+
+  uint16_t intern(std::string_view name) {
+    auto it = ids_.find(name);
+    if (it != ids_.end()) return it->second;
+    if (names_.size() > UINT16_MAX) {
+      throw std::runtime_error("Event log string table is full");
+    }
+    uint16_t id = static_cast<uint16_t>(names_.size());
+    names_.emplace_back(name);
+    ids_.emplace(names_.back(), id);
+    put<uint8_t>(EventLog::TAG_STRING);
+    put<uint16_t>(id);
+    putBytes(name);
+    return id;
+  }
+
+  std::vector<char> buffer_; // declared before out_, which writes into it
+  std::ofstream out_;
+  std::mutex mutex_;
+  std::deque<std::string> names_; // stable storage for the map keys
+  std::map<std::string_view, uint16_t> ids_;
+  uint64_t events_ = 0;
+};
+
+// Forwards every event to an inner handler after appending it to a log.
+class RecordingEventHandler : public ccapi::EventHandler {
+ public:
+  RecordingEventHandler(ccapi::EventHandler &inner, EventRecorder &recorder)
+      : inner_(inner), recorder_(recorder) {}
+
+  void processEvent(const ccapi::Event &event,
+                    ccapi::Session *session) override {
+    recorder_.record(event);
+    inner_.processEvent(event, session);
+  }
+
+ private:
+  ccapi::EventHandler &inner_;
+  EventRecorder &recorder_;
+};
+
+// Reads an event log and feeds it to an EventHandler, either as fast as
+// possible (speed <= 0) or paced at `speed` times the recorded rate using
+// the receive timestamps.
+class EventReplayer {
+ public:
+  struct Summary {
+    uint64_t events = 0;
+    uint64_t messages = 0;
+    double elapsed_seconds = 0.0;
+    double recorded_seconds = 0.0;
+  };
+
+  explicit EventReplayer(const std::string &path)
+      : in_(path, std::ios::binary) {
+    if (!in_) throw std::runtime_error("Cannot open event log: " + path);
+    char magic[sizeof(EventLog::MAGIC)];
+    in_.read(magic, sizeof(magic));
+    uint32_t version = 0;
+    if (!in_ || std::memcmp(magic, EventLog::MAGIC, sizeof(magic)) != 0 ||
+        !get(version) || version != EventLog::VERSION) {
+      throw std::runtime_error("Not a supported event log: " + path);
+    }
+  }
+
+  // Reads the next event; returns false at end of log.
+  bool next(ccapi::Event &event) {
+    uint8_t tag;
+    while (get(tag)) {
+      if (tag == EventLog::TAG_STRING) {
+        readString();
+      } else if (tag == EventLog::TAG_EVENT) {
+        readEvent(event);
+        return true;
+      } else {
+        throw std::runtime_error("Corrupt event log record");
+      }
+    }
+    return false;
+  }
+
+  Summary run(ccapi::EventHandler &handler, double speed = 0.0) {
+    Summary summary;
+    auto wall_start = std::chrono::steady_clock::now();
+    int64_t first_ns = 0;
+    int64_t last_ns = 0;
+    ccapi::Event event;
+    while (next(event)) {
+      const auto &messages = event.getMessageList();
+      if (!messages.empty()) {
+        int64_t recv_ns = EventLog::toNanos(messages.front().getTimeReceived());
+        if (summary.events == 0) first_ns = recv_ns;
+        last_ns = recv_ns;
+        if (speed > 0.0 && recv_ns > first_ns) {
+          auto offset = std::chrono::nanoseconds(
+              static_cast<int64_t>((recv_ns - first_ns) / speed));
+          std::this_thread::sleep_until(wall_start + offset);
+        }
+      }
+      handler.processEvent(event, nullptr);
+      ++summary.events;
+      summary.messages += messages.size();
+    }
+    summary.elapsed_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      wall_start)
+            .count();
+    summary.recorded_seconds = (last_ns - first_ns) / 1e9;
+    return summary;
+  }
+
+ private:
+  template <typename T>
+  bool get(T &value) {
+    return static_cast<bool>(
+        in_.read(reinterpret_cast<char *>(&value), sizeof(T)));
+  }
+
+  template <typename T>
+  T require() {
+    T value;
+    if (!get(value)) throw std::runtime_error("Truncated event log");
+    return value;
+  }
+
+  std::string readBytes() {
+    uint16_t len = require<uint16_t>();
+    std::string bytes(len, '\0');
+    if (!in_.read(&bytes[0], len)) {
+      throw std::runtime_error("Truncated event log");
+    }
+    return bytes;
+  }
+
+  void readString() {
+    uint16_t id = require<uint16_t>();
+    std::string name = readBytes();
+    if (id != names_.size()) throw std::runtime_error("Corrupt string table");
+    names_.push_back(std::move(name));
+  }
+
+  // Element keys are string_views into names_, which never relocates
+  std::string_view name(uint16_t id) const {
+    if (id >= names_.size()) throw std::runtime_error("Unknown string id");
+    return names_[id];
+  }
+
+  void readEvent(ccapi::Event &event) {
+    event = ccapi::Event();
+    event.setType(static_cast<ccapi::Event::Type>(require<uint8_t>()));
+    uint32_t message_count = require<uint32_t>();
+    std::vector<ccapi::Message> messages;
+    messages.reserve(message_count);
+    for (uint32_t m = 0; m < message_count; ++m) {
+      ccapi::Message message;
+      message.setType(static_cast<ccapi::Message::Type>(require<uint8_t>()));
+      message.setRecapType(
+          static_cast<ccapi::Message::RecapType>(require<uint8_t>()));
+      message.setTime(ccapi::TimePoint(std::chrono::nanoseconds(require<int64_t>())));
+      message.setTimeReceived(
+          ccapi::TimePoint(std::chrono::nanoseconds(require<int64_t>())));
+      uint8_t id_count = require<uint8_t>();
+      std::vector<std::string> ids;
+      for (uint8_t i = 0; i < id_count; ++i) {
+        ids.emplace_back(name(require<uint16_t>()));
+      }
+      message.setCorrelationIdList(ids);
+      uint16_t element_count = require<uint16_t>();
+      std::vector<ccapi::Element> elements(element_count);
+      for (auto &element : elements) {
+        uint16_t field_count = require<uint16_t>();
+        for (uint16_t f = 0; f < field_count; ++f) {
+          std::string_view field = name(require<uint16_t>());
+          element.insert(field, readBytes());
+        }
+      }
+      message.setElementList(elements);
+      messages.push_back(std::move(message));
+    }
+    event.setMessageList(messages);
+  }
+
+  std::ifstream in_;
+  std::deque<std::string> names_;
+};
+
+// Record/replay switches shared by the executables:
+//   --record=PATH         log every live event to PATH
+//   --replay=PATH         feed PATH to the handler instead of connecting
+//   --replay-speed=X      pace the replay at X (> 0) times the recorded
+//                         rate (default: as fast as possible)
+struct EventLogOptions {
+  std::string record_path;
+  std::string replay_path;
+  double replay_speed = 0.0;
+
+  // Throws std::invalid_argument if --replay-speed is not a finite
+  // number > 0
+  static EventLogOptions fromArgs(int argc, char **argv) {
+    EventLogOptions options;
+    options.record_path = RovoConfig::argValue(argc, argv, "--record");
+    options.replay_path = RovoConfig::argValue(argc, argv, "--replay");
+    std::string speed = RovoConfig::argValue(argc, argv, "--replay-speed");
+    if (!speed.empty()) {
+      char *end = nullptr;
+      options.replay_speed = std::strtod(speed.c_str(), &end);
+      if (end != speed.c_str() + speed.size() ||
+          !std::isfinite(options.replay_speed) || !(options.replay_speed > 0.0)) {
+        throw std::invalid_argument("Invalid --replay-speed=" + speed +
+                                    ", expected a number > 0");
+      }
+    }
+    return options;
+  }
+
+  bool recording() const { return !record_path.empty(); }
+  bool replaying() const { return !replay_path.empty(); }
+};
+
+// Replays options.replay_path into handler and prints a throughput summary.
+// Returns false, after reporting why, if the log cannot be read.
+inline bool replayEventLog(const EventLogOptions &options,
+                           ccapi::EventHandler &handler) {
+  std::cout << "Replaying " << options.replay_path;
+  if (options.replay_speed > 0.0) {
+    std::cout << " at " << options.replay_speed << "x";
+  }
+  std::cout << "..." << std::endl;
+  try {
+    EventReplayer replayer(options.replay_path);
+    auto summary = replayer.run(handler, options.replay_speed);
+    // Let the handler's queued output land before the summary
+    OutputSink::instance().flush();
+    double rate = summary.elapsed_seconds > 0.0
+                      ? summary.messages / summary.elapsed_seconds
+                      : 0.0;
+    std::cout << "Replayed " << summary.events << " events / "
+              << summary.messages << " messages (" << summary.recorded_seconds
+              << "s recorded) in " << summary.elapsed_seconds << "s, "
+              << static_cast<uint64_t>(rate) << " msgs/s" << std::endl;
+    return true;
+  } catch (const std::exception &e) {
+    std::cerr << "Replay failed: " << e.what() << std::endl;
+    return false;
+  }
+}
+
+// Handler to give the live Session: the handler itself, or a recording
+// wrapper around it when --record was given.
+class SessionRecording {
+ public:
+  SessionRecording(const EventLogOptions &options, ccapi::EventHandler &handler)
+      : handler_(&handler) {
+    if (!options.recording()) return;
+    recorder_ = std::make_unique<EventRecorder>(options.record_path);
+    wrapper_ = std::make_unique<RecordingEventHandler>(handler, *recorder_);
+    handler_ = wrapper_.get();
+    std::cout << "Recording events to " << options.record_path << std::endl;
+  }
+
+  ccapi::EventHandler *handler() const { return handler_; }
+
+ private:
+  std::unique_ptr<EventRecorder> recorder_;
+  std::unique_ptr<RecordingEventHandler> wrapper_;
+  ccapi::EventHandler *handler_;
+};
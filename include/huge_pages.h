@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <sys/mman.h>
+
+// Huge pages for the large, long-lived buffers: ingest rings and trade
+// histories. Once enabled, a HugePageAllocator constructed afterwards
+// maps every allocation of at least one huge page from reserved
+// (MAP_HUGETLB) pages, or, when none are reserved, from 2 MiB aligned
+// anonymous memory advised for transparent huge pages. Smaller
+// allocations, and everything while disabled, come from operator new.
+//
+// An allocator keeps the mode it was constructed with, so a buffer is
+// always released the way it was obtained.
+namespace HugePages {
+constexpr size_t PAGE_SIZE = 2 * 1024 * 1024;
+
+inline std::atomic<bool> &enabledFlag() {
+  static std::atomic<bool> enabled{false};
+  return enabled;
+}
+
+inline bool enabled() { return enabledFlag().load(std::memory_order_relaxed); }
+
+// Applies to allocators constructed afterwards
+inline void setEnabled(bool enabled) {
+  enabledFlag().store(enabled, std::memory_order_relaxed);
+}
+
+inline size_t roundUp(size_t bytes) {
+  return (bytes + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+}
+
+// bytes must be a multiple of PAGE_SIZE. nullptr if nothing could be mapped.
+inline void *map(size_t bytes) {
+#ifdef MAP_HUGETLB
+  void *p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (p != MAP_FAILED) return p;
+#endif
+  // Over-map by a page and trim both ends to a PAGE_SIZE boundary, so the
+  // kernel can back the whole range with transparent huge pages
+  size_t span = bytes + PAGE_SIZE;
+  void *raw = ::mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) return nullptr;
+  auto base = reinterpret_cast<uintptr_t>(raw);
+  uintptr_t start = (base + PAGE_SIZE - 1) & ~uintptr_t(PAGE_SIZE - 1);
+  if (start > base) ::munmap(raw, start - base);
+  size_t tail = base + span - (start + bytes);
+  if (tail) ::munmap(reinterpret_cast<void *>(start + bytes), tail);
+#ifdef MADV_HUGEPAGE
+  ::madvise(reinterpret_cast<void *>(start), bytes, MADV_HUGEPAGE);
+#endif
+  return reinterpret_cast<void *>(start);
+}
+
+inline void unmap(void *p, size_t bytes) { ::munmap(p, bytes); }
+} // namespace HugePages
+
+template <typename T>
+class HugePageAllocator {
+ public:
+  using value_type = T;
+
+  HugePageAllocator() : huge_(HugePages::enabled()) {}
+  template <typename U>
+  HugePageAllocator(const HugePageAllocator<U> &other) : huge_(other.huge()) {}
+
+  T *allocate(size_t n) {
+    size_t bytes = n * sizeof(T);
+    if (!mapped(bytes)) return std::allocator<T>().allocate(n);
+    void *p = HugePages::map(HugePages::roundUp(bytes));
+    if (!p) throw std::bad_alloc();
+    return static_cast<T *>(p);
+  }
+
+  void deallocate(T *p, size_t n) {
+    size_t bytes = n * sizeof(T);
+    if (!mapped(bytes)) {
+      std::allocator<T>().deallocate(p, n);
+      return;
+    }
+    HugePages::unmap(p, HugePages::roundUp(bytes));
+  }
+
+  bool huge() const { return huge_; }
+
+  template <typename U>
+  bool operator==(const HugePageAllocator<U> &other) const {
+    return huge_ == other.huge();
+  }
+  template <typename U>
+  bool operator!=(const HugePageAllocator<U> &other) const {
+    return huge_ != other.huge();
+  }
+
+ private:
+  bool mapped(size_t bytes) const {
+    return huge_ && bytes >= HugePages::PAGE_SIZE;
+  }
+
+  bool huge_;
+};
@@ -0,0 +1,162 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// Streaming JSON writer into a reusable buffer.
+//
+// clear() keeps the buffer's capacity, so once it has grown to the size of
+// a document, writing the next one does not allocate. Numbers are
+// formatted with std::to_chars in fixed notation at a set precision, and
+// absent optionals and non-finite values are written as null. The pretty
+// layout puts one member per line, indented two spaces per level. Objects
+// nest up to 63 levels.
+//
+//   JsonWriter json;
+//   json.beginObject().field("spread", 0.5).field("vwap", std::nullopt);
+//   json.beginObject("lambda").field("daily", 1e-6).endObject().endObject();
+//   std::string_view text = json.view();
+class JsonWriter {
+ public:
+  explicit JsonWriter(size_t capacity = 4096, bool pretty = true,
+                      int precision = 8)
+      : pretty_(pretty), precision_(precision) {
+    buf_.reserve(capacity);
+  }
+
+  void clear() {
+    buf_.clear();
+    depth_ = 0;
+    has_members_ = 0;
+  }
+
+  std::string_view view() const { return buf_; }
+  size_t size() const { return buf_.size(); }
+
+  void setPrecision(int precision) { precision_ = precision; }
+
+  // Opens the top-level object, or a nested one as member key
+  JsonWriter &beginObject(std::string_view key = {}) {
+    if (depth_ > 0) member(key);
+    buf_.push_back('{');
+    ++depth_;
+    has_members_ &= ~bit(depth_);
+    return *this;
+  }
+
+  JsonWriter &endObject() {
+    if (pretty_ && (has_members_ & bit(depth_))) {
+      buf_.push_back('\n');
+      indent(depth_ - 1);
+    }
+    --depth_;
+    buf_.push_back('}');
+    return *this;
+  }
+
+  JsonWriter &field(std::string_view key, double number) {
+    member(key);
+    appendNumber(number);
+    return *this;
+  }
+
+  JsonWriter &field(std::string_view key, const std::optional<double> &number) {
+    member(key);
+    if (number) {
+      appendNumber(*number);
+    } else {
+      buf_.append("null");
+    }
+    return *this;
+  }
+
+  JsonWriter &integer(std::string_view key, int64_t number) {
+    member(key);
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    buf_.append(digits, result.ptr);
+    return *this;
+  }
+
+  JsonWriter &string(std::string_view key, std::string_view text) {
+    member(key);
+    appendString(text);
+    return *this;
+  }
+
+ private:
+  static uint64_t bit(int depth) { return uint64_t(1) << (depth & 63); }
+
+  void indent(int depth) { buf_.append(static_cast<size_t>(depth) * 2, ' '); }
+
+  void member(std::string_view key) {
+    if (has_members_ & bit(depth_)) buf_.push_back(',');
+    has_members_ |= bit(depth_);
+    if (pretty_) {
+      buf_.push_back('\n');
+      indent(depth_);
+    }
+    appendString(key);
+    buf_.append(pretty_ ? ": " : ":");
+  }
+
+  void appendNumber(double number) {
+    if (!std::isfinite(number)) {
+      buf_.append("null"); // JSON has no NaN or infinity
+      return;
+    }
+    // Room for DBL_MAX in fixed notation plus the fraction
+    char digits[400];
+#if defined(__cpp_lib_to_chars)
+    auto result = std::to_chars(digits, digits + sizeof(digits), number,
+                                std::chars_format::fixed, precision_);
+    if (result.ec == std::errc()) {
+      buf_.append(digits, result.ptr);
+      return;
+    }
+#endif
+    int n = std::snprintf(digits, sizeof(digits), "%.*f", precision_, number);
+    if (n > 0) buf_.append(digits, std::min<size_t>(n, sizeof(digits) - 1));
+  }
+
+  void appendString(std::string_view text) {
+    buf_.push_back('"');
+    for (char c : text) {
+      switch (c) {
+      case '"':
+        buf_.append("\\\"");
+        break;
+      case '\\':
+        buf_.append("\\\\");
+        break;
+      case '\n':
+        buf_.append("\\n");
+        break;
+      case '\t':
+        buf_.append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          buf_.append(escaped);
+        } else {
+          buf_.push_back(c);
+        }
+      }
+    }
+    buf_.push_back('"');
+  }
+
+  std::string buf_;
+  bool pretty_;
+  int precision_;
+  int depth_ = 0;
+  uint64_t has_members_ = 0; // bit per open object: a member was written
+};
@@ -0,0 +1,346 @@
+#pragma once
+#include "allocation_counter.h"
+#include "output_sink.h"
+#include "runtime_tuning.h"
+#include "simple_config.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+// Pipeline latency instrumentation shared by the programs.
+//
+// Hot paths take steady-clock stamps (LatencyClock::stamp(), 0 while
+// instrumentation is off) as an update is received, parsed, analyzed and
+// output, and record the spans between them into LatencyHistograms:
+// fixed log-linear bucket arrays (HDR style, ~3% relative precision) of
+// relaxed atomic counters, so any thread records without locks or
+// allocation. Exchange-to-receipt clock skew goes into one histogram per
+// venue. LatencyMonitor owns the named histograms and prints p50/p99/p99.9
+// every latency_report_interval seconds, on SIGUSR1, and on report(),
+// followed by the heap allocations per update of the analysis paths
+// (AllocationSpan) in programs that count them (allocation_counter.h).
+
+namespace LatencyClock {
+inline std::atomic<bool> &enabledFlag() {
+  static std::atomic<bool> enabled{false};
+  return enabled;
+}
+
+inline int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// now(), or 0 when instrumentation is off so no clock is read
+inline int64_t stamp() {
+  return enabledFlag().load(std::memory_order_relaxed) ? now() : 0;
+}
+} // namespace LatencyClock
+
+class LatencyHistogram {
+ public:
+  static constexpr int SUB_BITS = 5; // 32 linear buckets per power of two
+  static constexpr int MAX_BITS = 40; // values clamp at ~18 minutes of ns
+  static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BITS;
+  static constexpr size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+  struct Summary {
+    uint64_t count = 0;
+    uint64_t negative = 0; // samples below zero, recorded as 0
+    int64_t max = 0;
+    double mean = 0.0;
+    int64_t p50 = 0;
+    int64_t p99 = 0;
+    int64_t p999 = 0;
+  };
+
+  void record(int64_t value) {
+    if (value < 0) {
+      negative_.fetch_add(1, std::memory_order_relaxed);
+      value = 0;
+    }
+    counts_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(static_cast<uint64_t>(value), std::memory_order_relaxed);
+    int64_t seen = max_.load(std::memory_order_relaxed);
+    while (value > seen &&
+           !max_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  // Records to - from, unless from was not stamped
+  void recordSpan(int64_t from, int64_t to) {
+    if (from != 0 && to != 0) record(to - from);
+  }
+
+  // Percentiles are bucket upper bounds, capped at the maximum. Samples
+  // recorded concurrently may or may not be included.
+  Summary summary() const {
+    Summary s;
+    std::array<uint64_t, BUCKETS> counts;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+      counts[i] = counts_[i].load(std::memory_order_relaxed);
+      s.count += counts[i];
+    }
+    if (s.count == 0) return s;
+    s.negative = negative_.load(std::memory_order_relaxed);
+    s.max = max_.load(std::memory_order_relaxed);
+    s.mean = static_cast<double>(sum_.load(std::memory_order_relaxed)) /
+             static_cast<double>(s.count);
+    s.p50 = std::min(s.max, percentile(counts, s.count, 0.50));
+    s.p99 = std::min(s.max, percentile(counts, s.count, 0.99));
+    s.p999 = std::min(s.max, percentile(counts, s.count, 0.999));
+    return s;
+  }
+
+  // Bucket holding value: exact below SUB_BUCKETS, then SUB_BUCKETS
+  // buckets per power of two
+  static size_t bucketOf(int64_t value) {
+    uint64_t v = std::min<uint64_t>(static_cast<uint64_t>(value),
+                                    (uint64_t(1) << MAX_BITS) - 1);
+    if (v < SUB_BUCKETS) return static_cast<size_t>(v);
+    int bits = 63 - __builtin_clzll(v);
+    size_t sub = (v >> (bits - SUB_BITS)) & (SUB_BUCKETS - 1);
+    return (bits - SUB_BITS + 1) * SUB_BUCKETS + sub;
+  }
+
+  // Largest value that falls in bucket
+  static int64_t bucketUpperBound(size_t bucket) {
+    size_t magnitude = bucket / SUB_BUCKETS;
+    uint64_t sub = bucket % SUB_BUCKETS;
+    if (magnitude == 0) return static_cast<int64_t>(sub);
+    uint64_t width = uint64_t(1) << (magnitude - 1);
+    return static_cast<int64_t>((SUB_BUCKETS + sub + 1) * width - 1);
+  }
+
+ private:
+  static int64_t percentile(const std::array<uint64_t, BUCKETS> &counts,
+                            uint64_t total, double q) {
+    auto rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+      seen += counts[i];
+      if (seen >= rank) return bucketUpperBound(i);
+    }
+    return bucketUpperBound(BUCKETS - 1);
+  }
+
+  std::array<std::atomic<uint64_t>, BUCKETS> counts_{};
+  std::atomic<uint64_t> negative_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<int64_t> max_{0};
+};
+
+// Records the span from a stamp to the end of its scope, e.g. to time an
+// OutputLine declared after it through its submission
+class LatencySpan {
+ public:
+  LatencySpan(LatencyHistogram *histogram, int64_t from)
+      : histogram_(histogram), from_(from) {}
+  ~LatencySpan() {
+    if (histogram_ && from_ != 0) histogram_->record(LatencyClock::now() - from_);
+  }
+
+  LatencySpan(const LatencySpan &) = delete;
+  LatencySpan &operator=(const LatencySpan &) = delete;
+
+ private:
+  LatencyHistogram *histogram_;
+  int64_t from_;
+};
+
+// Heap allocations made on the analysis paths of timed updates, from the
+// decoded event until its output is queued
+struct PipelineAllocations {
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> updates{0};
+};
+
+// Adds the allocations the current thread makes until the end of its scope
+// to stats, if the update was stamped. A batch counts as its number of
+// updates; updates = 0 counts allocations of follow-up work (e.g. a
+// periodic report) without counting an update.
+class AllocationSpan {
+ public:
+  AllocationSpan(PipelineAllocations *stats, int64_t from, uint64_t updates = 1)
+      : stats_(from != 0 ? stats : nullptr), updates_(updates) {}
+  ~AllocationSpan() {
+    if (!stats_) return;
+    stats_->allocations.fetch_add(scope_.allocations(), std::memory_order_relaxed);
+    if (updates_) stats_->updates.fetch_add(updates_, std::memory_order_relaxed);
+  }
+
+  AllocationSpan(const AllocationSpan &) = delete;
+  AllocationSpan &operator=(const AllocationSpan &) = delete;
+
+ private:
+  PipelineAllocations *stats_;
+  uint64_t updates_;
+  AllocationScope scope_;
+};
+
+class LatencyMonitor {
+ public:
+  struct Options {
+    bool enabled = false;
+    long report_interval_s = 0; // 0 = only on SIGUSR1 and report()
+
+    // latency_stats (0/1), latency_report_interval (seconds)
+    static Options fromConfig(const SimpleConfig &cfg) {
+      Options o;
+      o.enabled = cfg.getInt("latency_stats", 0) != 0;
+      o.report_interval_s = std::max(0L, cfg.getLong("latency_report_interval", 0));
+      return o;
+    }
+  };
+
+  static LatencyMonitor &instance() {
+    static LatencyMonitor monitor;
+    return monitor;
+  }
+
+  ~LatencyMonitor() { stopReporter(); }
+
+  // Turns stamping on or off and (re)starts the periodic reporter. Set up
+  // the histograms before the feed starts.
+  void configure(const Options &options) {
+    std::lock_guard<std::mutex> lock(control_);
+    stopReporter();
+    LatencyClock::enabledFlag().store(options.enabled, std::memory_order_relaxed);
+    AllocationCounter::setProcessCounting(options.enabled);
+    if (!options.enabled) return;
+    interval_s_ = options.report_interval_s;
+    dumpRequested(); // initialized before the handler can run
+    std::signal(SIGUSR1, [](int) {
+      dumpRequested().store(true, std::memory_order_relaxed);
+    });
+    running_.store(true, std::memory_order_release);
+    reporter_ = std::thread([this] { reporterLoop(); });
+  }
+
+  bool enabled() const {
+    return LatencyClock::enabledFlag().load(std::memory_order_relaxed);
+  }
+
+  // The histogram called name, created on first use. The reference stays
+  // valid for the life of the process; look it up once, not per update.
+  LatencyHistogram &histogram(const std::string &name) {
+    std::lock_guard<std::mutex> lock(histograms_mutex_);
+    for (auto &entry : histograms_) {
+      if (entry.first == name) return *entry.second;
+    }
+    histograms_.emplace_back(name, std::make_unique<LatencyHistogram>());
+    return *histograms_.back().second;
+  }
+
+  PipelineAllocations &pipelineAllocations() { return pipeline_allocations_; }
+
+  // Exchange-to-receipt skew of venue
+  LatencyHistogram &skew(const std::string &venue) {
+    return histogram("skew " + venue);
+  }
+
+  // One table of every histogram with samples, in microseconds, then the
+  // heap allocations of the analysis paths and of the whole process
+  void print(std::ostream &out) {
+    std::lock_guard<std::mutex> lock(histograms_mutex_);
+    out << "[latency] " << std::left << std::setw(20) << "stage" << std::right
+        << std::setw(10) << "count" << std::setw(11) << "mean_us"
+        << std::setw(11) << "p50_us" << std::setw(11) << "p99_us"
+        << std::setw(11) << "p99.9_us" << std::setw(11) << "max_us" << "\n";
+    out << std::fixed << std::setprecision(1);
+    for (const auto &entry : histograms_) {
+      auto s = entry.second->summary();
+      if (s.count == 0) continue;
+      out << "[latency] " << std::left << std::setw(20) << entry.first
+          << std::right << std::setw(10) << s.count << std::setw(11)
+          << s.mean / 1e3 << std::setw(11) << s.p50 / 1e3 << std::setw(11)
+          << s.p99 / 1e3 << std::setw(11) << s.p999 / 1e3 << std::setw(11)
+          << s.max / 1e3;
+      if (s.negative > 0) out << "  (" << s.negative << " negative)";
+      out << "\n";
+    }
+    if (AllocationCounter::installed()) {
+      uint64_t allocations =
+          pipeline_allocations_.allocations.load(std::memory_order_relaxed);
+      uint64_t updates = pipeline_allocations_.updates.load(std::memory_order_relaxed);
+      out << "[latency] allocations: pipeline " << allocations << " over "
+          << updates << " updates";
+      if (updates > 0) {
+        out << std::setprecision(3) << " ("
+            << double(allocations) / double(updates) << " per update)";
+      }
+      out << ", process " << AllocationCounter::processTotal() << "\n";
+    }
+  }
+
+  // Queues the table through the output sink, if instrumentation is on
+  void report() {
+    if (!enabled()) return;
+    OutputLine out(OutputLevel::ERROR); // never rate limited
+    print(out.stream());
+  }
+
+ private:
+  // The sink outlives the monitor's reporter
+  LatencyMonitor() { OutputSink::instance(); }
+
+  static std::atomic<bool> &dumpRequested() {
+    static std::atomic<bool> requested{false};
+    return requested;
+  }
+
+  void stopReporter() {
+    running_.store(false, std::memory_order_release);
+    if (reporter_.joinable()) reporter_.join();
+  }
+
+  void reporterLoop() {
+    RuntimeTuning::instance().pinThisThread(RuntimeTuning::Role::BACKGROUND);
+    auto next = std::chrono::steady_clock::now() +
+                std::chrono::seconds(interval_s_);
+    while (running_.load(std::memory_order_acquire)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      bool due = interval_s_ > 0 && std::chrono::steady_clock::now() >= next;
+      if (dumpRequested().exchange(false, std::memory_order_relaxed) || due) {
+        report();
+        if (due) next += std::chrono::seconds(interval_s_);
+      }
+    }
+  }
+
+  std::mutex control_;
+  std::mutex histograms_mutex_;
+  std::deque<std::pair<std::string, std::unique_ptr<LatencyHistogram>>>
+      histograms_;
+  PipelineAllocations pipeline_allocations_;
+  long interval_s_ = 0;
+  std::atomic<bool> running_{false};
+  std::thread reporter_;
+};
+
+// The stage histograms every pipeline shares, looked up once
+struct PipelineLatency {
+  LatencyHistogram *parse;   // received -> decoded
+  LatencyHistogram *analyze; // decoded -> analyzed, including any queueing
+  LatencyHistogram *output;  // analyzed -> output queued and published
+  LatencyHistogram *total;   // received -> output queued
+  PipelineAllocations *allocations; // decoded -> output queued
+
+  static PipelineLatency get() {
+    auto &monitor = LatencyMonitor::instance();
+    return {&monitor.histogram("parse"), &monitor.histogram("analyze"),
+            &monitor.histogram("output"), &monitor.histogram("total"),
+            &monitor.pipelineAllocations()};
+  }
+};
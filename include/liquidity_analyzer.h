@@ -0,0 +1,683 @@
+#pragma once
+#include "arena.h"
+#include "bar_builder.h"
+#include "liquidity_metrics.h"
+#include "market_events.h"
+#include "metric_pipeline.h"
+#include "order_book.h"
+#include "output_sink.h"
+#include "rolling_stats.h"
+#include "trade_record.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Liquidity, risk and market impact analysis of one instrument's trades and
+// order book, independent of ccapi; liquidity_analyzer.cpp feeds it from a
+// live or replayed session.
+
+// Order book level
+struct OrderBookLevel {
+  double price;
+  double size;
+
+  OrderBookLevel(double p = 0.0, double s = 0.0) : price(p), size(s) {
+    if (price < 0.0 || size < 0.0) {
+      throw std::invalid_argument(
+          "Invalid order book level: price and size must be non-negative");
+    }
+  }
+};
+
+class LiquidityAnalyzer {
+public:
+  static constexpr size_t BOOK_CAPACITY = 256; // levels kept per side
+  using OrderBook = BasicOrderBook<BOOK_CAPACITY>;
+
+private:
+  // A trade as applied; the history keeps it as a fixed-point TradeRecord
+  struct Trade {
+    int64_t timestamp; // ms since epoch
+    double price;
+    double amount;
+    TradeSide side;
+  };
+
+  RingBuffer<TradeRecord> trade_history{MAX_TRADE_HISTORY};
+  uint16_t symbol_id = 0;
+  FixedPointScale price_scale;
+  FixedPointScale size_scale;
+  uint64_t rejected_trades = 0;
+  OrderBook book;
+
+  static constexpr size_t MAX_TRADE_HISTORY = 10000;
+  static constexpr int64_t DAY_IN_MS = 86400000LL;
+  static constexpr size_t HISTORICAL_VOL_WINDOW = 30;
+  static constexpr size_t ANALYSIS_DEPTH = 10; // levels behind depth and slopes
+
+public:
+  // The metric pipeline for a set: kernels over the first ANALYSIS_DEPTH
+  // levels, and returns and short impact windows over one pair per
+  // consecutive trades of the history
+  template <uint32_t Set>
+  using Pipeline = StaticMetricPipeline<Set, OrderBook, ANALYSIS_DEPTH,
+                                        MAX_TRADE_HISTORY - 1,
+                                        HISTORICAL_VOL_WINDOW>;
+
+private:
+  std::optional<Trade> last_trade;
+
+  // The selected metrics with their incremental state: rolling returns, so
+  // risk metrics never rescan the history, streaming Kyle's lambda and
+  // Amihud accumulators for the short windows, and time bars for the long
+  // ones. Reads only expire stale samples, so the pipeline is not const
+  // even under the const analysis API.
+  MetricSet metric_set;
+  std::unique_ptr<MetricPipeline<OrderBook>> pipeline =
+      makeMetricPipeline<Pipeline>(metric_set);
+
+  // In event-time mode windows end at the latest trade instead of the wall
+  // clock, so replaying a recording gives the same results every run
+  bool event_time = false;
+  int64_t latest_trade_ms = 0;
+
+public:
+  // Monotonic versions of the inputs of the metric groups. The book has one
+  // per depth band: its best level (spread), the best ANALYSIS_DEPTH
+  // levels (depth, imbalance and slopes) and any level (VWAP, which walks
+  // as deep as its sample volume). Trades version the history behind the
+  // risk and impact metrics; the impact windows also move with their end.
+  struct MetricVersions {
+    uint64_t book_best = 0;
+    uint64_t book_top = 0;
+    uint64_t book_any = 0;
+    uint64_t trades = 0;
+    int64_t window_end_ms = 0;
+
+    // Groups whose inputs changed between then and these versions
+    uint32_t staleSince(const MetricVersions &then) const {
+      uint32_t stale = 0;
+      if (book_best != then.book_best) stale |= MetricSet::SPREAD;
+      if (book_top != then.book_top) stale |= MetricSet::DEPTH | MetricSet::SLOPE;
+      if (book_any != then.book_any) stale |= MetricSet::VWAP;
+      if (trades != then.trades) stale |= MetricSet::TRADES;
+      if (window_end_ms != then.window_end_ms) stale |= MetricSet::IMPACT;
+      return stale;
+    }
+  };
+
+private:
+  // Start above a default MetricVersions, so fresh snapshots and caches
+  // read as stale
+  MetricVersions versions{1, 1, 1, 1, 0};
+
+public:
+  // Everything an analysis reads, copied out by the ingest thread so that
+  // analyze() runs on another thread against a consistent view, without
+  // locks. Window statistics are evaluated when the snapshot is taken
+  // (O(1) each); only the book is copied level by level, and only if a
+  // book metric is selected. A snapshot object that is filled again (as
+  // the buffers of a SnapshotBuffer are) keeps the parts whose versions
+  // have not moved.
+  struct Snapshot {
+    OrderBook book;
+    int64_t time_ns = 0; // exchange time of the trade that triggered it
+    size_t trades = 0;   // trade history size
+    uint64_t rejected_trades = 0;
+    int64_t received_stamp = 0; // LatencyClock stamps of that trade
+    int64_t parsed_stamp = 0;
+
+    MetricValues values;
+    // The selected kernels of the pipeline that took the snapshot
+    MetricPipeline<OrderBook>::Compute compute =
+        &Pipeline<MetricSet::ALL>::computeMetrics;
+    MetricVersions versions; // of the book and values above
+  };
+
+  // Metrics of the last snapshot a thread analyzed, memoized with the
+  // versions they were computed at; see analyze(snapshot, cache)
+  struct MetricCache {
+    LiquidityMetrics metrics;
+    MetricVersions versions;
+    MetricPipeline<OrderBook>::Compute compute = nullptr;
+    uint32_t refreshed = 0; // groups the last analysis recomputed
+  };
+
+  // Non-static methods are called only from the thread that applies
+  // events; the static ones work on snapshots from any thread.
+
+  void setEventTimeMode(bool enabled) { event_time = enabled; }
+
+  // Metric groups to maintain and compute (all by default). Call before
+  // the first trade.
+  void setMetrics(MetricSet set) {
+    metric_set = set;
+    pipeline = makeMetricPipeline<Pipeline>(set);
+  }
+
+  MetricSet selectedMetrics() const { return metric_set; }
+
+  // Instrument the history is tagged with and the decimals its prices and
+  // sizes are kept to. Call before the first trade.
+  void setInstrument(uint16_t symbol, const FixedPointScale &prices,
+                     const FixedPointScale &sizes) {
+    symbol_id = symbol;
+    price_scale = prices;
+    size_scale = sizes;
+  }
+
+  // Applies a trade. Returns false, and counts it as rejected, if price or
+  // amount is not positive or does not fit the instrument's scale.
+  bool addTrade(int64_t timestamp_ms, double price, double amount,
+                TradeSide side) {
+    TradeRecord record;
+    if (!TradeRecord::make(timestamp_ms, price, amount, side, symbol_id,
+                           price_scale, size_scale, record)) {
+      ++rejected_trades;
+      return false;
+    }
+    Trade trade{timestamp_ms, price, amount, side};
+    if (metric_set.has(MetricSet::TRADES)) {
+      MetricTrade update{trade.timestamp, trade.price, trade.amount,
+                         trade.amount * sideSign(trade.side), nullptr,
+                         std::nullopt};
+      ImpactSample pair;
+      if (last_trade && metric_set.has(MetricSet::IMPACT)) {
+        pair = impactSample(*last_trade, trade);
+        update.pair = &pair;
+      }
+      if (last_trade && metric_set.has(MetricSet::RISK)) {
+        double return_val = std::log(trade.price / last_trade->price);
+        if (std::isfinite(return_val)) {
+          update.log_return = return_val;
+        }
+      }
+      pipeline->onTrade(update);
+    }
+    ++versions.trades;
+    trade_history.push(record);
+    last_trade = trade;
+    latest_trade_ms = std::max(latest_trade_ms, trade.timestamp);
+    return true;
+  }
+
+  // Replace the book with a full snapshot. Invalid levels are skipped and
+  // already-sorted input (the exchange norm) is taken without sorting.
+  void updateOrderBook(const std::vector<OrderBookLevel> &bids,
+                       const std::vector<OrderBookLevel> &asks) {
+    book.applySnapshot(bids, asks);
+    noteBookChange();
+  }
+
+  // Apply a snapshot or an in-place price-level delta
+  void updateOrderBook(const BookEvent &update) {
+    updateOrderBook(update.snapshot, update.bid_price, update.bid_size,
+                    update.bid_count, update.ask_price, update.ask_size,
+                    update.ask_count);
+  }
+
+  // Same from parallel level arrays, e.g. rows of a mapped tick file
+  void updateOrderBook(bool snapshot, const double *bid_price,
+                       const double *bid_size, size_t bid_count,
+                       const double *ask_price, const double *ask_size,
+                       size_t ask_count) {
+    if (snapshot) {
+      book.applySnapshot(bid_price, bid_size, bid_count, ask_price, ask_size,
+                         ask_count);
+    } else {
+      book.applyDelta(bid_price, bid_size, bid_count, ask_price, ask_size,
+                      ask_count);
+    }
+    noteBookChange();
+  }
+
+  // Applies a batch of events in order, like addTrade() and
+  // updateOrderBook() one by one, but a run of book updates rebuilds the
+  // book's prefix sums once, and updates a later snapshot in the same run
+  // replaces are skipped. on_trade(ev) runs after each accepted trade, with
+  // the book current. Returns the number of accepted trades.
+  template <typename OnTrade>
+  size_t applyEvents(const MarketEvent *events, size_t count, OnTrade &&on_trade) {
+    size_t accepted = 0;
+    for (size_t i = 0; i < count;) {
+      const MarketEvent &ev = events[i];
+      if (ev.type == MarketEvent::Type::TRADE) {
+        if (addTrade(ev.exchange_time_ns / 1000000, ev.trade.price,
+                     ev.trade.amount, ev.trade.side)) {
+          ++accepted;
+          on_trade(ev);
+        }
+        ++i;
+        continue;
+      }
+      size_t from = i, end = i;
+      for (; end < count && events[end].type == MarketEvent::Type::BOOK; ++end) {
+        if (events[end].book.snapshot) from = end;
+      }
+      for (size_t k = from; k < end; ++k) stageOrderBook(events[k].book);
+      book.finalize();
+      noteBookChange();
+      i = end;
+    }
+    return accepted;
+  }
+
+  // Calculate Kyle's Lambda measure of market impact. With Kyle's lambda
+  // selected, the hourly window is maintained per trade pair and the daily
+  // one evaluated from minute bars, so it covers the whole day however many
+  // trades it held; other windows rescan the history.
+  double calculateKylesLambda(int64_t time_window_ms = DAY_IN_MS) const {
+    double lambda;
+    if (pipeline->kylesLambda(time_window_ms, currentTimeMs(), lambda)) {
+      return lambda;
+    }
+    return scanKylesLambda(time_window_ms);
+  }
+
+  // Calculate Amihud's illiquidity measure. With Amihud selected, the 1 day
+  // period is maintained per trade pair and the 30 and 90 day periods
+  // evaluated from hour bars; other periods rescan the history.
+  double calculateAmihudMeasure(int period_days = 30) const {
+    double measure;
+    if (pipeline->amihudMeasure(period_days, currentTimeMs(), measure)) {
+      return measure;
+    }
+    return scanAmihudMeasure(period_days);
+  }
+
+  // 1s/1m/1h OHLCV bars of the trades applied so far; null unless an
+  // impact measure is selected
+  const BarBuilder *tradeBars() const { return pipeline->bars(); }
+
+  // Copies the levels of the book the selected metrics read (all for
+  // VWAP, ANALYSIS_DEPTH for the others) and evaluates the window
+  // statistics into out, each only if its versions moved since out was
+  // last taken
+  void takeSnapshot(Snapshot &out, int64_t time_ns) const {
+    MetricVersions now = versions;
+    now.window_end_ms = currentTimeMs();
+    uint32_t stale = out.compute == pipeline->compute()
+                         ? now.staleSince(out.versions)
+                         : MetricSet::ALL;
+    stale &= metric_set.groups;
+    if (stale & MetricSet::BOOK) {
+      if (metric_set.has(MetricSet::VWAP)) {
+        out.book.copyTop(book);
+      } else {
+        out.book.copyTop(book, ANALYSIS_DEPTH);
+      }
+    }
+    if (stale & MetricSet::TRADES) {
+      pipeline->evaluate(out.values, now.window_end_ms);
+    }
+    out.time_ns = time_ns;
+    out.trades = trade_history.size();
+    out.rejected_trades = rejected_trades;
+    out.compute = pipeline->compute();
+    out.versions = now;
+  }
+
+  // Comprehensive analysis of a snapshot; safe on any thread
+  static LiquidityMetrics analyze(const Snapshot &snapshot) {
+    LiquidityMetrics metrics;
+    snapshot.compute(snapshot.book, snapshot.values, metrics, MetricSet::ALL);
+    return metrics;
+  }
+
+  // Same, recomputing only the groups of cache whose versions moved since
+  // its last snapshot, e.g. no book metric after trades alone and no
+  // spread after changes below the best level. The result lives in
+  // cache; safe on any thread that owns it.
+  static const LiquidityMetrics &analyze(const Snapshot &snapshot,
+                                         MetricCache &cache) {
+    uint32_t stale = snapshot.compute == cache.compute
+                         ? snapshot.versions.staleSince(cache.versions)
+                         : MetricSet::ALL;
+    if (stale) {
+      snapshot.compute(snapshot.book, snapshot.values, cache.metrics, stale);
+    }
+    cache.versions = snapshot.versions;
+    cache.compute = snapshot.compute;
+    cache.refreshed = stale & cache.metrics.computed.groups;
+    return cache.metrics;
+  }
+
+  // Print comprehensive analysis results
+  static void printAnalysis(std::ostream &out, const std::string &symbol,
+                            const LiquidityMetrics &metrics) {
+    out << "\n" << Repeat{'=', 80} << "\n";
+    out << "COMPREHENSIVE LIQUIDITY ANALYSIS FOR: " << symbol << "\n";
+    out << Repeat{'=', 80} << "\n";
+
+    out << std::fixed << std::setprecision(6);
+
+    // Sections and lines of groups that were not computed are left out
+    const MetricSet &computed = metrics.computed;
+    if (computed.has(MetricSet::SPREAD | MetricSet::DEPTH)) {
+      out << "\nORDER BOOK METRICS:\n";
+      out << Repeat{'-', 40} << "\n";
+    }
+    if (computed.has(MetricSet::SPREAD)) {
+      out << "  Spread:                $" << std::setprecision(2)
+          << metrics.spread << "\n";
+      out << "  Relative Spread:       " << std::setprecision(4)
+          << (metrics.relative_spread * 100) << "%\n";
+    }
+    if (computed.has(MetricSet::DEPTH)) {
+      out << "  Bid Depth:             " << std::setprecision(2)
+          << metrics.bid_depth << "\n";
+      out << "  Ask Depth:             " << std::setprecision(2)
+          << metrics.ask_depth << "\n";
+      out << "  Order Book Imbalance:  " << std::setprecision(4);
+      if (metrics.order_book_imbalance.has_value()) {
+        out << metrics.order_book_imbalance.value();
+      } else {
+        out << "N/A";
+      }
+      out << "\n";
+    }
+
+    if (computed.has(MetricSet::VWAP | MetricSet::SLOPE)) {
+      out << "\nVWAP & SLIPPAGE ANALYSIS:\n";
+      out << Repeat{'-', 40} << "\n";
+    }
+    if (computed.has(MetricSet::VWAP)) {
+      out << "  Bid VWAP:              $" << std::setprecision(2);
+      if (metrics.bid_vwap.has_value()) {
+        out << metrics.bid_vwap.value();
+      } else {
+        out << "N/A";
+      }
+      out << "\n";
+
+      out << "  Ask VWAP:              $" << std::setprecision(2);
+      if (metrics.ask_vwap.has_value()) {
+        out << metrics.ask_vwap.value();
+      } else {
+        out << "N/A";
+      }
+      out << "\n";
+
+      out << "  Bid Slippage:          " << std::setprecision(4);
+      if (metrics.bid_slippage.has_value()) {
+        out << (metrics.bid_slippage.value() * 100) << "%";
+      } else {
+        out << "N/A";
+      }
+      out << "\n";
+
+      out << "  Ask Slippage:          " << std::setprecision(4);
+      if (metrics.ask_slippage.has_value()) {
+        out << (metrics.ask_slippage.value() * 100) << "%";
+      } else {
+        out << "N/A";
+      }
+      out << "\n";
+    }
+    if (computed.has(MetricSet::SLOPE)) {
+      out << "  Bid Slope:             " << std::setprecision(6)
+          << metrics.bid_slope << "\n";
+      out << "  Ask Slope:             " << std::setprecision(6)
+          << metrics.ask_slope << "\n";
+    }
+
+    if (computed.has(MetricSet::IMPACT)) {
+      out << "\nMARKET MICROSTRUCTURE:\n";
+      out << Repeat{'-', 40} << "\n";
+    }
+    if (computed.has(MetricSet::KYLES_LAMBDA)) {
+      out << "  Kyle's Lambda:\n";
+      out << "    Daily:               " << std::setprecision(8)
+          << metrics.kyles_lambda.daily << "\n";
+      out << "    Hourly:              " << std::setprecision(8)
+          << metrics.kyles_lambda.hourly << "\n";
+    }
+    if (computed.has(MetricSet::AMIHUD)) {
+      out << "  Amihud Measures:\n";
+      out << "    1 Day:               " << std::setprecision(8)
+          << metrics.amihud_measures.one_day << "\n";
+      out << "    30 Days:             " << std::setprecision(8)
+          << metrics.amihud_measures.thirty_days << "\n";
+      out << "    90 Days:             " << std::setprecision(8)
+          << metrics.amihud_measures.ninety_days << "\n";
+    }
+
+    if (computed.has(MetricSet::RISK)) {
+      out << "\nRISK METRICS:\n";
+      out << Repeat{'-', 40} << "\n";
+      out << "  Realized Volatility:   " << std::setprecision(2)
+          << metrics.realized_volatility << "%\n";
+      out << "  Historical Volatility: ";
+      if (metrics.historical_volatility.has_value()) {
+        out << std::setprecision(2) << metrics.historical_volatility.value()
+            << "%";
+      } else {
+        out << "N/A";
+      }
+      out << "\n";
+      out << "  VaR (95%):             " << std::setprecision(4)
+          << metrics.var_95 << "%\n";
+      out << "  Expected Shortfall:    " << std::setprecision(4)
+          << metrics.expected_shortfall_95 << "%\n";
+    }
+
+    out << Repeat{'=', 80} << "\n";
+  }
+
+  size_t getTradeHistorySize() const {
+    return trade_history.size();
+  }
+
+private:
+  int64_t currentTimeMs() const {
+    if (event_time) return latest_trade_ms;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+  }
+
+  Trade decode(const TradeRecord &record) const {
+    return {record.timestamp, price_scale.decode(record.price),
+            size_scale.decode(record.amount), record.side};
+  }
+
+  // Bumps the versions of the depth bands the last finalized book update
+  // changed
+  void noteBookChange() {
+    size_t from = book.changedFrom();
+    if (from >= OrderBook::CAPACITY) return;
+    ++versions.book_any;
+    if (from < ANALYSIS_DEPTH) ++versions.book_top;
+    if (from == 0) ++versions.book_best;
+  }
+
+  // Book update without the prefix sum rebuild; see applyEvents()
+  void stageOrderBook(const BookEvent &update) {
+    if (update.snapshot) {
+      book.stageSnapshot(update.bid_price, update.bid_size, update.bid_count,
+                         update.ask_price, update.ask_size, update.ask_count);
+    } else {
+      book.stageDelta(update.bid_price, update.bid_size, update.bid_count,
+                      update.ask_price, update.ask_size, update.ask_count);
+    }
+  }
+
+  // Aggressor direction of signed volume
+  static double sideSign(TradeSide side) {
+    switch (side) {
+    case TradeSide::BUY:
+      return 1.0;
+    case TradeSide::SELL:
+      return -1.0;
+    default:
+      return 0.0;
+    }
+  }
+
+  // Contribution of a consecutive trade pair to the impact measures.
+  // Applies the same filters as the full-history scans.
+  static ImpactSample impactSample(const Trade &prev_trade,
+                                   const Trade &curr_trade) {
+    ImpactSample sample;
+    if (prev_trade.price > 0 && curr_trade.price > 0) {
+      double log_return = std::log(curr_trade.price / prev_trade.price);
+      if (std::isfinite(log_return) && std::abs(log_return) < 1.0) {
+        sample.log_return = log_return;
+        sample.signed_volume = curr_trade.amount * sideSign(curr_trade.side);
+        sample.kyle_valid = true;
+      }
+    }
+
+    if (curr_trade.timestamp / DAY_IN_MS == prev_trade.timestamp / DAY_IN_MS &&
+        prev_trade.price > 0) {
+      double return_i =
+          std::abs(curr_trade.price - prev_trade.price) / prev_trade.price;
+      double volume = curr_trade.amount * curr_trade.price;
+      if (std::isfinite(return_i) && std::isfinite(volume) && volume > 0) {
+        sample.abs_return = return_i;
+        sample.dollar_volume = volume;
+        sample.amihud_valid = true;
+      }
+    }
+    return sample;
+  }
+
+  // Full-history Kyle's lambda for windows without an accumulator
+  double scanKylesLambda(int64_t time_window_ms) const {
+    if (trade_history.size() < 2) {
+      return 0.0;
+    }
+
+    // Scratch from the thread's arena, released on return
+    ArenaScope scratch;
+    ArenaVector<double> log_returns;
+    ArenaVector<double> signed_volumes;
+    log_returns.reserve(trade_history.size() - 1);
+    signed_volumes.reserve(trade_history.size() - 1);
+
+    int64_t current_time = currentTimeMs();
+
+    for (size_t i = 1; i < trade_history.size(); ++i) {
+      Trade prev_trade = decode(trade_history[i - 1]);
+      Trade curr_trade = decode(trade_history[i]);
+
+      // Filter by time window
+      if (current_time - curr_trade.timestamp > time_window_ms) {
+        continue;
+      }
+
+      // Calculate log return with safety checks
+      if (prev_trade.price > 0 && curr_trade.price > 0) {
+        double log_return = std::log(curr_trade.price / prev_trade.price);
+
+        // Filter out extreme values that might be errors
+        if (std::isfinite(log_return) && std::abs(log_return) < 1.0) {
+          log_returns.push_back(log_return);
+
+          // Calculate signed volume
+          signed_volumes.push_back(curr_trade.amount *
+                                   sideSign(curr_trade.side));
+        }
+      }
+    }
+
+    if (log_returns.size() < 2) {
+      return 0.0;
+    }
+
+    // Linear regression to find lambda
+    return calculateLinearRegression(signed_volumes, log_returns);
+  }
+
+  // Full-history Amihud measure for periods without an accumulator
+  double scanAmihudMeasure(int period_days) const {
+    if (trade_history.size() < 2) {
+      return 0.0;
+    }
+
+    ArenaScope scratch;
+    std::map<int64_t, std::pair<double, double>, std::less<int64_t>,
+             ArenaAllocator<std::pair<const int64_t, std::pair<double, double>>>>
+        daily_data; // day -> (total_return, total_volume)
+
+    int64_t current_time = currentTimeMs();
+
+    int64_t period_ms = static_cast<int64_t>(period_days) * DAY_IN_MS;
+
+    for (size_t i = 1; i < trade_history.size(); ++i) {
+      Trade prev_trade = decode(trade_history[i - 1]);
+      Trade curr_trade = decode(trade_history[i]);
+
+      if (current_time - curr_trade.timestamp > period_ms) {
+        continue;
+      }
+
+      int64_t day = curr_trade.timestamp / DAY_IN_MS;
+      int64_t prev_day = prev_trade.timestamp / DAY_IN_MS;
+
+      if (day == prev_day && prev_trade.price > 0) {
+        double return_i =
+            std::abs(curr_trade.price - prev_trade.price) / prev_trade.price;
+        double volume = curr_trade.amount * curr_trade.price;
+
+        if (std::isfinite(return_i) && std::isfinite(volume) && volume > 0) {
+          daily_data[day].first += return_i;
+          daily_data[day].second += volume;
+        }
+      }
+    }
+
+    if (daily_data.empty()) {
+      return 0.0;
+    }
+
+    double total_amihud = 0.0;
+    int valid_days = 0;
+
+    for (const auto &[day, data] : daily_data) {
+      if (data.second > 0) { // Volume > 0
+        double amihud_day = data.first / data.second;
+        if (std::isfinite(amihud_day)) {
+          total_amihud += amihud_day;
+          valid_days++;
+        }
+      }
+    }
+
+    return valid_days > 0 ? total_amihud / valid_days : 0.0;
+  }
+
+  // Helper function for linear regression
+  double calculateLinearRegression(const ArenaVector<double> &x,
+                                   const ArenaVector<double> &y) const {
+    if (x.size() != y.size() || x.size() < 2) {
+      return 0.0;
+    }
+
+    double x_mean = std::accumulate(x.begin(), x.end(), 0.0) / x.size();
+    double y_mean = std::accumulate(y.begin(), y.end(), 0.0) / y.size();
+
+    double numerator = 0.0;
+    double denominator = 0.0;
+
+    for (size_t i = 0; i < x.size(); ++i) {
+      numerator += (x[i] - x_mean) * (y[i] - y_mean);
+      denominator += (x[i] - x_mean) * (x[i] - x_mean);
+    }
+
+    return (denominator != 0.0 && std::isfinite(numerator) &&
+            std::isfinite(denominator))
+               ? numerator / denominator
+               : 0.0;
+  }
+};
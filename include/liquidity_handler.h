@@ -0,0 +1,383 @@
+#pragma once
+#include "ccapi_cpp/ccapi_session.h"
+#include "event_log.h"
+#include "json_writer.h"
+#include "latency_monitor.h"
+#include "liquidity_analyzer.h"
+#include "liquidity_record.h"
+#include "market_data_parser.h"
+#include "market_events.h"
+#include "output_sink.h"
+#include "published_metrics.h"
+#include "runtime_tuning.h"
+#include "snapshot_buffer.h"
+#include "spsc_queue.h"
+#include "tick_store.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ccapi {
+
+// The ccapi callback thread only parses messages into MarketEvents and
+// enqueues them; a dedicated analyzer thread drains the queue in batches,
+// updates the LiquidityAnalyzer and prints the periodic analysis.
+class LiquidityEventHandler : public EventHandler {
+public:
+  using IngestQueue = SpscQueue<MarketEvent>;
+  using MessageParser = MarketDataParser<Message>;
+
+private:
+  static constexpr size_t CONSUMER_BATCH = 256;
+
+  LiquidityAnalyzer analyzer;
+  std::string current_symbol = "BTCUSDT"; // Fixed symbol
+  SymbolTable symbols;
+  MessageParser parser; // callback thread only
+  std::atomic<int> trade_count{0};
+  int analysis_interval = 100; // trades between published analyses
+  bool event_time = false;
+
+  std::unique_ptr<TickStoreWriter> tick_writer; // analyzer thread only
+  PipelineLatency latency = PipelineLatency::get();
+  LatencyHistogram *skew_latency = nullptr;
+
+  // The analyzer thread publishes a snapshot every analysis_interval
+  // trades; the report thread analyzes and prints it
+  SnapshotBuffer<LiquidityAnalyzer::Snapshot> snapshots;
+
+  // Report thread only: metrics are recomputed only for the groups a
+  // snapshot changed, and the JSON buffer is reused across reports and
+  // rewritten only when a group was
+  LiquidityAnalyzer::MetricCache metric_cache;
+  JsonWriter json_writer;
+  std::unique_ptr<LiquidityRecordWriter> record_writer;
+  std::unique_ptr<ShmMetricsPublisher<LiquidityRecord>> shm_publisher;
+  uint64_t analyses = 0;
+
+  IngestQueue ingest_queue;
+  std::atomic<bool> running{true};
+  std::thread consumer_thread;
+  std::atomic<bool> reporting{true};
+  std::thread report_thread;
+
+public:
+  explicit LiquidityEventHandler(
+      size_t queue_capacity = 65536,
+      IngestQueue::OverflowPolicy policy = IngestQueue::OverflowPolicy::DROP,
+      int analysis_interval_trades = 100)
+      : analysis_interval(std::max(1, analysis_interval_trades)),
+        ingest_queue(queue_capacity, policy),
+        consumer_thread([this] { consumeLoop(); }),
+        report_thread([this] { reportLoop(); }) {
+    setFixedPointDecimals(8, 8);
+  }
+
+  ~LiquidityEventHandler() override { stop(); }
+
+  // Stops the analyzer thread once the queued events are applied, then the
+  // report thread once the last snapshot is reported
+  void stop() {
+    running.store(false, std::memory_order_release);
+    if (consumer_thread.joinable()) {
+      consumer_thread.join();
+    }
+    if (tick_writer) tick_writer->flush();
+    reporting.store(false, std::memory_order_release);
+    if (report_thread.joinable()) {
+      report_thread.join();
+    }
+  }
+
+  IngestQueue::Stats getIngestStats() const { return ingest_queue.stats(); }
+
+  // Treat depth messages after the initial snapshot as level deltas. Call
+  // before subscribing.
+  void setDepthDiffMode(bool diff_mode) { parser.setDiffMode(diff_mode); }
+
+  // Decimals trade prices and sizes are kept to in the history; a trade
+  // quoting more is rounded. Call before subscribing.
+  void setFixedPointDecimals(int price_decimals, int size_decimals) {
+    analyzer.setInstrument(symbols.intern(current_symbol),
+                           FixedPointScale(price_decimals),
+                           FixedPointScale(size_decimals));
+  }
+
+  // Metric groups analyzed and reported (liq_metrics). Call before
+  // subscribing.
+  void setMetrics(MetricSet set) { analyzer.setMetrics(set); }
+
+  // Venue whose exchange-to-receipt skew is recorded. Call before
+  // subscribing.
+  void setExchange(const std::string &exchange) {
+    skew_latency = &LatencyMonitor::instance().skew(exchange);
+  }
+
+  // Append every applied event to a tick store. Call before subscribing.
+  void setTickStore(std::unique_ptr<TickStoreWriter> writer) {
+    tick_writer = std::move(writer);
+  }
+
+  // Append a binary LiquidityRecord per analysis. Call before subscribing.
+  void setRecordFile(const std::string &path) {
+    record_writer = std::make_unique<LiquidityRecordWriter>(path);
+  }
+
+  // Publish the latest analysis into the shared-memory segment name, in a
+  // slot named after the symbol. Call before subscribing.
+  void setSharedMemory(const std::string &name) {
+    shm_publisher = std::make_unique<ShmMetricsPublisher<LiquidityRecord>>(
+        name, ShmMetricsFormat::Tag::LIQUIDITY,
+        std::vector<std::string>{current_symbol});
+  }
+
+  // Feeds a tick store straight into the analyzer on the calling thread,
+  // in event time. The live queue must be idle.
+  TickStore::Summary replayTickStore(const TickStore &store, int64_t from_ns,
+                                     int64_t to_ns) {
+    setEventTimeMode(true);
+    return store.replay(
+        [this](int64_t time_ns, double price, double amount, TradeSide side) {
+          onTrade(time_ns, price, amount, side);
+        },
+        [this](int64_t, bool snapshot, const double *bid_price,
+               const double *bid_size, size_t bid_count,
+               const double *ask_price, const double *ask_size,
+               size_t ask_count) {
+          analyzer.updateOrderBook(snapshot, bid_price, bid_size, bid_count,
+                                   ask_price, ask_size, ask_count);
+        },
+        from_ns, to_ns);
+  }
+
+  // Replay: take receive times from the recorded messages and close the
+  // analysis windows at the latest trade rather than the wall clock.
+  void setEventTimeMode(bool enabled) {
+    event_time = enabled;
+    analyzer.setEventTimeMode(enabled);
+  }
+
+  // Queues an event decoded elsewhere, e.g. by a MarketDataBus shared with
+  // other modules, for the analyzer thread like one of our own
+  void onMarketEvent(const MarketEvent &ev) { ingest_queue.push(ev); }
+
+  void processEvent(const Event &event, Session *session) override {
+    RuntimeTuning::instance().pinCallbackThread();
+    try {
+      // Per-event tracing only at output_verbosity=debug
+      OutputLine(OutputLevel::DEBUG)
+          << "Received event type: " << static_cast<int>(event.getType())
+          << "\n";
+      if (event.getType() == Event::Type::SUBSCRIPTION_DATA) {
+        OutputLine(OutputLevel::DEBUG)
+            << "Processing " << event.getMessageList().size()
+            << " messages\n";
+        for (const auto &message : event.getMessageList()) {
+          processMarketData(message);
+        }
+      } else if (event.getType() == Event::Type::SUBSCRIPTION_STATUS) {
+        OutputLine() << "Subscription status event received\n";
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "Error processing event: " << e.what() << std::endl;
+    }
+  }
+
+private:
+  static int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+  }
+
+  void processMarketData(const Message &message) {
+    int64_t received_stamp = LatencyClock::stamp();
+    if (received_stamp != 0 && skew_latency) {
+      skew_latency->record(EventLog::toNanos(message.getTimeReceived()) -
+                           EventLog::toNanos(message.getTime()));
+    }
+    static int message_count = 0;
+    message_count++;
+
+    // Only print detailed info every 50 messages to avoid spam
+    bool verbose = message_count % 50 == 1;
+    std::optional<OutputLine> dump;
+    if (verbose) {
+      dump.emplace();
+      *dump << "\n=== Processing Message #" << message_count << " ===\n";
+      for (const auto &element : message.getElementList()) {
+        for (const auto &pair : element.getNameValueMap()) {
+          *dump << "  " << pair.first << " = " << pair.second << "\n";
+        }
+      }
+      const auto &stats = parser.stats();
+      if (stats.rejected > 0 || stats.field_errors > 0) {
+        *dump << "Parser: " << stats.rejected << " rejected messages, "
+              << stats.field_errors << " malformed fields\n";
+      }
+    }
+
+    MarketEvent::Type type;
+    if (!MessageParser::classify(message, type)) {
+      if (verbose) *dump << "Unknown message type\n";
+      return;
+    }
+    if (verbose) {
+      *dump << (type == MarketEvent::Type::TRADE
+                    ? "Processing as TRADE data"
+                    : "Processing as ORDER BOOK data")
+            << "\n";
+      dump.reset();
+    }
+
+    // Decode straight into queue slots; an unpublished slot is simply
+    // reused by the next claim, and a full queue is counted as a drop
+    parser.parse(
+        message, type, [this] { return ingest_queue.claimOrWait(); },
+        [this, &message, received_stamp](MarketEvent &ev) {
+          ev.receive_time_ns =
+              event_time ? EventLog::toNanos(message.getTimeReceived())
+                         : nowNanos();
+          ev.received_stamp = received_stamp;
+          ev.parsed_stamp = LatencyClock::stamp();
+          latency.parse->recordSpan(received_stamp, ev.parsed_stamp);
+          ingest_queue.publish();
+        });
+  }
+
+  // Analyzer thread: drain the queue in batches until stopped. Each batch
+  // is handed over in place and applied as a whole.
+  void consumeLoop() {
+    auto &tuning = RuntimeTuning::instance();
+    tuning.pinThisThread(RuntimeTuning::Role::ANALYZER);
+    auto apply = [this](const MarketEvent *events, size_t count) {
+      applyEvents(events, count);
+    };
+    while (running.load(std::memory_order_acquire)) {
+      if (ingest_queue.consumeRuns(apply, CONSUMER_BATCH) == 0) {
+        tuning.idle(std::chrono::microseconds(100));
+      }
+    }
+    ingest_queue.consumeRuns(apply); // drain what is left
+  }
+
+  void applyEvents(const MarketEvent *events, size_t count) {
+    AllocationSpan allocation_span(latency.allocations, events[0].received_stamp,
+                                   count);
+    try {
+      if (tick_writer) {
+        for (size_t i = 0; i < count; ++i) {
+          const MarketEvent &ev = events[i];
+          if (ev.type == MarketEvent::Type::TRADE) {
+            tick_writer->appendTrade(ev.exchange_time_ns, ev.trade.price,
+                                     ev.trade.amount, ev.trade.side);
+          } else {
+            tick_writer->appendBook(ev.exchange_time_ns, ev.book);
+          }
+        }
+      }
+      analyzer.applyEvents(events, count, [this](const MarketEvent &ev) {
+        countTrade(ev.exchange_time_ns, ev.received_stamp, ev.parsed_stamp);
+      });
+    } catch (const std::exception &e) {
+      std::cerr << "Error applying market events: " << e.what() << std::endl;
+    }
+  }
+
+  void onTrade(int64_t time_ns, double price, double amount, TradeSide side) {
+    if (!analyzer.addTrade(time_ns / 1000000, price, amount, side)) {
+      return; // counted and reported with the next analysis
+    }
+    countTrade(time_ns);
+  }
+
+  // After each accepted trade. received_stamp/parsed_stamp are LatencyClock
+  // stamps, 0 if untimed.
+  void countTrade(int64_t time_ns, int64_t received_stamp = 0,
+                  int64_t parsed_stamp = 0) {
+    // Hand a snapshot to the report thread every analysis_interval trades.
+    // Live, a report still in progress only means an intermediate snapshot
+    // is skipped; a replay waits so that every one is reported.
+    int current_count = trade_count.fetch_add(1) + 1;
+    if (current_count % analysis_interval == 0) {
+      if (event_time) {
+        while (snapshots.pending()) std::this_thread::yield();
+      }
+      auto &snapshot = snapshots.back();
+      analyzer.takeSnapshot(snapshot, time_ns);
+      snapshot.received_stamp = received_stamp;
+      snapshot.parsed_stamp = parsed_stamp;
+      snapshots.publish();
+    }
+  }
+
+  // Report thread: analyze snapshots as they are published until stopped
+  void reportLoop() {
+    RuntimeTuning::instance().pinThisThread(RuntimeTuning::Role::BACKGROUND);
+    while (reporting.load(std::memory_order_acquire)) {
+      if (const auto *snapshot = snapshots.acquire()) {
+        performAndPrintAnalysis(*snapshot);
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+    if (const auto *snapshot = snapshots.acquire()) {
+      performAndPrintAnalysis(*snapshot); // the last one before stop()
+    }
+  }
+
+  void performAndPrintAnalysis(const LiquidityAnalyzer::Snapshot &snapshot) {
+    // The report's allocations count toward the updates it summarizes
+    AllocationSpan allocation_span(latency.allocations, snapshot.received_stamp,
+                                   0);
+    try {
+      const auto &metrics = LiquidityAnalyzer::analyze(snapshot, metric_cache);
+      int64_t analyzed_stamp = LatencyClock::stamp();
+      latency.analyze->recordSpan(snapshot.parsed_stamp, analyzed_stamp);
+      // Output and total spans close after the report below is queued
+      LatencySpan output_span(latency.output, analyzed_stamp);
+      LatencySpan total_span(latency.total, snapshot.received_stamp);
+      ++analyses;
+      if (record_writer || shm_publisher) {
+        LiquidityRecord record = metrics.toRecord(snapshot.time_ns, analyses);
+        if (record_writer) record_writer->write(record);
+        if (shm_publisher) shm_publisher->publish(0, record);
+      }
+
+      // The whole report is queued as one block
+      OutputLine report;
+      if (!report.active()) return;
+      LiquidityAnalyzer::printAnalysis(report.stream(), current_symbol, metrics);
+
+      // Print JSON for easy integration
+      report << "\nJSON OUTPUT:\n";
+      report << Repeat{'-', 40} << "\n";
+      if (metric_cache.refreshed || json_writer.view().empty()) {
+        json_writer.clear();
+        metrics.writeJson(json_writer);
+      }
+      report << json_writer.view() << "\n";
+
+      auto stats = ingest_queue.stats();
+      report << "\nINGEST QUEUE: depth " << stats.depth << "/"
+             << stats.capacity << ", high watermark " << stats.high_watermark
+             << ", pushed " << stats.pushed << ", dropped " << stats.dropped
+             << ", backpressure waits " << stats.backpressure_waits;
+      if (snapshot.rejected_trades > 0) {
+        report << ", rejected trades " << snapshot.rejected_trades;
+      }
+      report << "\n";
+
+    } catch (const std::exception &e) {
+      std::cerr << "Error performing analysis: " << e.what() << std::endl;
+    }
+  }
+};
+
+} // namespace ccapi
@@ -0,0 +1,226 @@
+#pragma once
+#include "json_writer.h"
+#include "liquidity_record.h"
+#include "simple_config.h"
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Groups of liquidity metrics an analyzer maintains and computes. Left-out
+// groups cost nothing: their kernels are not compiled into the analyzer's
+// pipeline and the trade state behind them is never allocated.
+struct MetricSet {
+  enum Group : uint32_t {
+    SPREAD = 1u << 0,       // spread and relative spread
+    DEPTH = 1u << 1,        // bid/ask depth and imbalance
+    VWAP = 1u << 2,         // VWAP and slippage
+    SLOPE = 1u << 3,        // order book slopes
+    RISK = 1u << 4,         // volatilities, VaR and expected shortfall
+    KYLES_LAMBDA = 1u << 5, // daily and hourly
+    AMIHUD = 1u << 6,       // 1, 30 and 90 days
+  };
+  static constexpr uint32_t BOOK = SPREAD | DEPTH | VWAP | SLOPE;
+  static constexpr uint32_t IMPACT = KYLES_LAMBDA | AMIHUD;
+  static constexpr uint32_t TRADES = RISK | IMPACT;
+  static constexpr uint32_t ALL = BOOK | TRADES;
+
+  uint32_t groups = ALL;
+
+  constexpr bool has(uint32_t group) const { return (groups & group) != 0; }
+
+  // Names as in liq_metrics: spread, depth, vwap, slope, risk,
+  // kyles_lambda, amihud, or book, impact, trades, all. Throws
+  // std::invalid_argument on an unknown name or an empty selection.
+  static MetricSet fromNames(const std::vector<std::string> &names) {
+    static const std::pair<const char *, uint32_t> known[] = {
+        {"spread", SPREAD}, {"depth", DEPTH},   {"vwap", VWAP},
+        {"slope", SLOPE},   {"risk", RISK},     {"kyles_lambda", KYLES_LAMBDA},
+        {"amihud", AMIHUD}, {"book", BOOK},     {"impact", IMPACT},
+        {"trades", TRADES}, {"all", ALL}};
+    MetricSet set{0};
+    for (const auto &name : names) {
+      uint32_t groups = 0;
+      for (const auto &[known_name, known_groups] : known) {
+        if (name == known_name) groups = known_groups;
+      }
+      if (groups == 0) throw std::invalid_argument("Unknown metric: " + name);
+      set.groups |= groups;
+    }
+    if (set.groups == 0) throw std::invalid_argument("No metrics selected");
+    return set;
+  }
+
+  static MetricSet fromConfig(const SimpleConfig &cfg) {
+    return fromNames(cfg.getStringList("liq_metrics", {"all"}));
+  }
+};
+
+// Comprehensive liquidity metrics structure
+struct LiquidityMetrics {
+  // Groups that were computed; the others keep their defaults and are left
+  // out of the JSON and the report
+  MetricSet computed;
+
+  // Order book metrics
+  double spread = 0.0;
+  double relative_spread = 0.0;
+  double bid_depth = 0.0;
+  double ask_depth = 0.0;
+  std::optional<double> order_book_imbalance = std::nullopt;
+
+  // VWAP and slippage metrics
+  std::optional<double> bid_vwap = std::nullopt;
+  std::optional<double> ask_vwap = std::nullopt;
+  std::optional<double> bid_slippage = std::nullopt;
+  std::optional<double> ask_slippage = std::nullopt;
+
+  // Order book slopes
+  double bid_slope = 0.0;
+  double ask_slope = 0.0;
+
+  // Risk metrics
+  double realized_volatility = 0.0;
+  double var_95 = 0.0;
+  double expected_shortfall_95 = 0.0;
+  std::optional<double> historical_volatility = std::nullopt;
+
+  // Kyle's lambda (nested structure)
+  struct KylesLambda {
+    double daily = 0.0;
+    double hourly = 0.0;
+  } kyles_lambda;
+
+  // Amihud measures (nested structure)
+  struct AmihudMeasures {
+    double one_day = 0.0;
+    double thirty_days = 0.0;
+    double ninety_days = 0.0;
+  } amihud_measures;
+
+  // Returns the metrics of groups to their defaults, so they can be
+  // computed again in place
+  void reset(uint32_t groups) {
+    if (groups & MetricSet::SPREAD) {
+      spread = relative_spread = 0.0;
+    }
+    if (groups & MetricSet::DEPTH) {
+      bid_depth = ask_depth = 0.0;
+      order_book_imbalance.reset();
+    }
+    if (groups & MetricSet::VWAP) {
+      bid_vwap.reset();
+      ask_vwap.reset();
+      bid_slippage.reset();
+      ask_slippage.reset();
+    }
+    if (groups & MetricSet::SLOPE) {
+      bid_slope = ask_slope = 0.0;
+    }
+    if (groups & MetricSet::RISK) {
+      realized_volatility = var_95 = expected_shortfall_95 = 0.0;
+      historical_volatility.reset();
+    }
+    if (groups & MetricSet::KYLES_LAMBDA) kyles_lambda = {};
+    if (groups & MetricSet::AMIHUD) amihud_measures = {};
+  }
+
+  // Writes the computed metrics as one JSON object into json's reusable
+  // buffer; absent optionals are null
+  void writeJson(JsonWriter &json) const {
+    json.beginObject();
+    if (computed.has(MetricSet::SPREAD)) {
+      json.field("spread", spread);
+      json.field("relative_spread", relative_spread);
+    }
+    if (computed.has(MetricSet::DEPTH)) {
+      json.field("bid_depth", bid_depth);
+      json.field("ask_depth", ask_depth);
+      json.field("order_book_imbalance", order_book_imbalance);
+    }
+    if (computed.has(MetricSet::VWAP)) {
+      json.field("bid_vwap", bid_vwap);
+      json.field("ask_vwap", ask_vwap);
+      json.field("bid_slippage", bid_slippage);
+      json.field("ask_slippage", ask_slippage);
+    }
+    if (computed.has(MetricSet::SLOPE)) {
+      json.field("bid_slope", bid_slope);
+      json.field("ask_slope", ask_slope);
+    }
+    if (computed.has(MetricSet::RISK)) {
+      json.field("realized_volatility", realized_volatility);
+      json.field("var_95", var_95);
+      json.field("expected_shortfall_95", expected_shortfall_95);
+      json.field("historical_volatility", historical_volatility);
+    }
+    if (computed.has(MetricSet::KYLES_LAMBDA)) {
+      json.beginObject("kyles_lambda");
+      json.field("daily", kyles_lambda.daily);
+      json.field("hourly", kyles_lambda.hourly);
+      json.endObject();
+    }
+    if (computed.has(MetricSet::AMIHUD)) {
+      json.beginObject("amihud_measures");
+      json.field("1_day", amihud_measures.one_day);
+      json.field("30_days", amihud_measures.thirty_days);
+      json.field("90_days", amihud_measures.ninety_days);
+      json.endObject();
+    }
+    json.endObject();
+  }
+
+  // Fixed-layout binary image for consumers that read without parsing.
+  // Metrics of groups that were not computed hold NaN.
+  LiquidityRecord toRecord(int64_t time_ns, uint64_t sequence) const {
+    LiquidityRecord r = LiquidityRecord::blank();
+    r.time_ns = time_ns;
+    r.sequence = sequence;
+    auto optional = [&r](const std::optional<double> &value,
+                         LiquidityRecord::Field field, double &slot) {
+      if (!value) return;
+      slot = *value;
+      r.present |= field;
+    };
+    r.spread = spread;
+    r.relative_spread = relative_spread;
+    r.bid_depth = bid_depth;
+    r.ask_depth = ask_depth;
+    optional(order_book_imbalance, LiquidityRecord::ORDER_BOOK_IMBALANCE,
+             r.order_book_imbalance);
+    optional(bid_vwap, LiquidityRecord::BID_VWAP, r.bid_vwap);
+    optional(ask_vwap, LiquidityRecord::ASK_VWAP, r.ask_vwap);
+    optional(bid_slippage, LiquidityRecord::BID_SLIPPAGE, r.bid_slippage);
+    optional(ask_slippage, LiquidityRecord::ASK_SLIPPAGE, r.ask_slippage);
+    r.bid_slope = bid_slope;
+    r.ask_slope = ask_slope;
+    r.realized_volatility = realized_volatility;
+    r.var_95 = var_95;
+    r.expected_shortfall_95 = expected_shortfall_95;
+    optional(historical_volatility, LiquidityRecord::HISTORICAL_VOLATILITY,
+             r.historical_volatility);
+    r.kyles_lambda_daily = kyles_lambda.daily;
+    r.kyles_lambda_hourly = kyles_lambda.hourly;
+    r.amihud_one_day = amihud_measures.one_day;
+    r.amihud_thirty_days = amihud_measures.thirty_days;
+    r.amihud_ninety_days = amihud_measures.ninety_days;
+
+    double none = std::numeric_limits<double>::quiet_NaN();
+    if (!computed.has(MetricSet::SPREAD)) r.spread = r.relative_spread = none;
+    if (!computed.has(MetricSet::DEPTH)) r.bid_depth = r.ask_depth = none;
+    if (!computed.has(MetricSet::SLOPE)) r.bid_slope = r.ask_slope = none;
+    if (!computed.has(MetricSet::RISK)) {
+      r.realized_volatility = r.var_95 = r.expected_shortfall_95 = none;
+    }
+    if (!computed.has(MetricSet::KYLES_LAMBDA)) {
+      r.kyles_lambda_daily = r.kyles_lambda_hourly = none;
+    }
+    if (!computed.has(MetricSet::AMIHUD)) {
+      r.amihud_one_day = r.amihud_thirty_days = r.amihud_ninety_days = none;
+    }
+    return r;
+  }
+};
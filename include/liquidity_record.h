@@ -0,0 +1,125 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+// Fixed-layout binary image of one liquidity analysis, for downstream
+// consumers that cannot afford to parse JSON.
+//
+// A record is 192 bytes of little-endian, naturally aligned fields: a
+// 32-byte header followed by one f64 per metric in a fixed order. A
+// consumer maps the bytes (or a whole file of back-to-back records) onto
+// LiquidityRecord and reads the fields directly. Metrics that can be
+// absent have a bit in `present` and hold NaN when the bit is clear. New
+// fields are only ever appended and bump VERSION; `size` lets an old
+// reader step over records from a newer writer.
+struct LiquidityRecord {
+  static constexpr uint32_t MAGIC = 0x4d51494c; // "LIQM"
+  static constexpr uint16_t VERSION = 1;
+
+  // Bits of `present`
+  enum Field : uint32_t {
+    ORDER_BOOK_IMBALANCE = 1u << 0,
+    BID_VWAP = 1u << 1,
+    ASK_VWAP = 1u << 2,
+    BID_SLIPPAGE = 1u << 3,
+    ASK_SLIPPAGE = 1u << 4,
+    HISTORICAL_VOLATILITY = 1u << 5,
+  };
+
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;     // bytes in this record
+  uint32_t present;  // Field bits set for optional metrics that have values
+  uint32_t reserved;
+  int64_t time_ns;   // exchange time of the trade that closed the analysis
+  uint64_t sequence; // analyses written by this process, from 1
+
+  // Order book
+  double spread;
+  double relative_spread;
+  double bid_depth;
+  double ask_depth;
+  double order_book_imbalance;
+
+  // VWAP and slippage
+  double bid_vwap;
+  double ask_vwap;
+  double bid_slippage;
+  double ask_slippage;
+
+  // Order book slopes
+  double bid_slope;
+  double ask_slope;
+
+  // Risk
+  double realized_volatility;
+  double var_95;
+  double expected_shortfall_95;
+  double historical_volatility;
+
+  // Market impact
+  double kyles_lambda_daily;
+  double kyles_lambda_hourly;
+  double amihud_one_day;
+  double amihud_thirty_days;
+  double amihud_ninety_days;
+
+  bool has(Field field) const { return (present & field) != 0; }
+
+  // A header for this version with every optional metric absent
+  static LiquidityRecord blank() {
+    LiquidityRecord r{};
+    r.magic = MAGIC;
+    r.version = VERSION;
+    r.size = sizeof(LiquidityRecord);
+    double none = std::numeric_limits<double>::quiet_NaN();
+    r.order_book_imbalance = r.bid_vwap = r.ask_vwap = none;
+    r.bid_slippage = r.ask_slippage = r.historical_volatility = none;
+    return r;
+  }
+
+  // The record at data if it carries a known header; nullptr otherwise
+  static const LiquidityRecord *view(const void *data, size_t bytes) {
+    auto *r = static_cast<const LiquidityRecord *>(data);
+    if (bytes < sizeof(LiquidityRecord) || r->magic != MAGIC ||
+        r->version < 1 || r->size < sizeof(LiquidityRecord) ||
+        r->size > bytes) {
+      return nullptr;
+    }
+    return r;
+  }
+};
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "LiquidityRecord is written in host byte order and specified little-endian"
+#endif
+static_assert(std::is_trivially_copyable<LiquidityRecord>::value,
+              "LiquidityRecord must stay POD");
+static_assert(sizeof(LiquidityRecord) == 192, "LiquidityRecord layout");
+static_assert(offsetof(LiquidityRecord, spread) == 32,
+              "LiquidityRecord header layout");
+
+// Appends records to a file, one after another, flushing each so a reader
+// tailing the file only ever sees whole records.
+class LiquidityRecordWriter {
+ public:
+  explicit LiquidityRecordWriter(const std::string &path)
+      : out_(path, std::ios::binary | std::ios::app) {
+    if (!out_) {
+      throw std::runtime_error("Cannot open metrics record file: " + path);
+    }
+  }
+
+  void write(const LiquidityRecord &record) {
+    out_.write(reinterpret_cast<const char *>(&record), sizeof(record));
+    out_.flush();
+  }
+
+ private:
+  std::ofstream out_;
+};
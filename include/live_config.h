@@ -0,0 +1,203 @@
+#pragma once
+#include "output_sink.h"
+#include "runtime_tuning.h"
+#include "seqlock.h"
+#include "simple_config.h"
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Settings that change while a program runs.
+//
+// Typed settings structs are resolved from SimpleConfig once, at startup,
+// and held in LiveValues. A ConfigWatcher thread re-parses the file when it
+// changes or on SIGHUP and republishes them, so hot paths never parse
+// strings: they compare a version counter (one load) and copy the struct
+// only when it moved.
+
+// Latest value of a trivially copyable settings struct behind a seqlock.
+// One thread publishes at a time; any number read without waiting on it.
+template <typename T>
+class LiveValue {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "LiveValue holds plain settings structs");
+
+ public:
+  explicit LiveValue(const T &initial = T()) { publish(initial); }
+
+  LiveValue(const LiveValue &) = delete;
+  LiveValue &operator=(const LiveValue &) = delete;
+
+  // Grows with every publish
+  uint64_t version() const {
+    return sequence_.load(std::memory_order_acquire) / 2;
+  }
+
+  T load(uint64_t *version = nullptr) const {
+    T value;
+    uint64_t sequence = Seqlock::load(sequence_, words_, value);
+    if (version) *version = sequence / 2;
+    return value;
+  }
+
+  // Hot path: updates copy if a value newer than seen was published.
+  // Returns whether it did.
+  bool refresh(T &copy, uint64_t &seen) const {
+    if (version() == seen) return false;
+    copy = load(&seen);
+    return true;
+  }
+
+  void publish(const T &value) { Seqlock::store(sequence_, words_, value); }
+
+ private:
+  alignas(64) std::atomic<uint64_t> sequence_{0};
+  std::atomic<uint64_t> words_[Seqlock::words<T>()] = {};
+};
+
+// Re-parses a config file on a background thread when its modification
+// time or size changes, or on SIGHUP, and hands each successful parse to
+// the registered callbacks, which resolve and publish their typed values.
+// A file that fails to load, or a callback that throws (e.g. on an invalid
+// value), leaves the previous values in place.
+class ConfigWatcher {
+ public:
+  struct Options {
+    bool enabled = false;
+    long poll_interval_ms = 1000;
+
+    // config_reload (0/1), config_reload_interval_ms
+    static Options fromConfig(const SimpleConfig &cfg) {
+      Options o;
+      o.enabled = cfg.getInt("config_reload", 0) != 0;
+      o.poll_interval_ms =
+          std::max(10L, cfg.getLong("config_reload_interval_ms", o.poll_interval_ms));
+      return o;
+    }
+  };
+
+  using Callback = std::function<void(const SimpleConfig &)>;
+
+  ConfigWatcher(std::string path, const Options &options)
+      : path_(std::move(path)), options_(options) {}
+
+  ~ConfigWatcher() { stop(); }
+
+  ConfigWatcher(const ConfigWatcher &) = delete;
+  ConfigWatcher &operator=(const ConfigWatcher &) = delete;
+
+  bool enabled() const { return options_.enabled; }
+
+  // Register before start(); callbacks run on the watcher thread
+  void onReload(Callback callback) { callbacks_.push_back(std::move(callback)); }
+
+  // Starts watching if enabled
+  void start() {
+    if (!options_.enabled || running_.load(std::memory_order_acquire)) return;
+    stamp_ = fileStamp();
+    reloadRequested(); // initialized before the handler can run
+    std::signal(SIGHUP, [](int) {
+      reloadRequested().store(true, std::memory_order_relaxed);
+    });
+    running_.store(true, std::memory_order_release);
+    thread_ = std::thread([this] { watchLoop(); });
+    std::cout << "Watching " << path_ << " for changes (or SIGHUP)" << std::endl;
+  }
+
+  void stop() {
+    running_.store(false, std::memory_order_release);
+    if (thread_.joinable()) thread_.join();
+  }
+
+  // Re-parses now on the calling thread. Returns false if the file could
+  // not be loaded or a callback rejected it.
+  bool reload() {
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    SimpleConfig cfg;
+    if (!cfg.loadFromFile(path_)) {
+      OutputLine(OutputLevel::ERROR)
+          << "Config reload: cannot read " << path_ << ", keeping values\n";
+      return false;
+    }
+    try {
+      for (auto &callback : callbacks_) callback(cfg);
+    } catch (const std::exception &e) {
+      OutputLine(OutputLevel::ERROR)
+          << "Config reload: " << e.what() << ", keeping remaining values\n";
+      return false;
+    }
+    uint64_t n = reloads_.fetch_add(1, std::memory_order_relaxed) + 1;
+    OutputLine(OutputLevel::INFO)
+        << "Config reload #" << n << " applied from " << path_ << "\n";
+    return true;
+  }
+
+  uint64_t reloads() const { return reloads_.load(std::memory_order_relaxed); }
+
+ private:
+  struct FileStamp {
+    int64_t mtime_ns = -1;
+    int64_t size = -1;
+
+    bool operator==(const FileStamp &other) const {
+      return mtime_ns == other.mtime_ns && size == other.size;
+    }
+  };
+
+  static std::atomic<bool> &reloadRequested() {
+    static std::atomic<bool> requested{false};
+    return requested;
+  }
+
+  FileStamp fileStamp() const {
+    FileStamp stamp;
+    struct stat st;
+    if (::stat(path_.c_str(), &st) != 0) return stamp;
+#if defined(__APPLE__)
+    stamp.mtime_ns = int64_t(st.st_mtimespec.tv_sec) * 1000000000 +
+                     st.st_mtimespec.tv_nsec;
+#else
+    stamp.mtime_ns = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    stamp.size = st.st_size;
+    return stamp;
+  }
+
+  void watchLoop() {
+    RuntimeTuning::instance().pinThisThread(RuntimeTuning::Role::BACKGROUND);
+    auto interval = std::chrono::milliseconds(options_.poll_interval_ms);
+    auto next = std::chrono::steady_clock::now() + interval;
+    while (running_.load(std::memory_order_acquire)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(
+          std::min<long>(100, options_.poll_interval_ms)));
+      bool requested = reloadRequested().exchange(false, std::memory_order_relaxed);
+      if (!requested && std::chrono::steady_clock::now() < next) continue;
+      next = std::chrono::steady_clock::now() + interval;
+      FileStamp stamp = fileStamp();
+      if (!requested && stamp == stamp_) continue;
+      stamp_ = stamp;
+      reload();
+    }
+  }
+
+  std::string path_;
+  Options options_;
+  std::vector<Callback> callbacks_;
+  FileStamp stamp_; // watcher thread only
+  std::mutex reload_mutex_;
+  std::atomic<uint64_t> reloads_{0};
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
@@ -0,0 +1,188 @@
+#pragma once
+#include "ccapi_cpp/ccapi_session.h"
+#include "event_log.h"
+#include "latency_monitor.h"
+#include "live_config.h"
+#include "market_data_parser.h"
+#include "market_events.h"
+#include "output_sink.h"
+#include "runtime_tuning.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ccapi {
+
+// One market data stream: what a ccapi Subscription asks for
+struct StreamSpec {
+  std::string exchange;
+  std::string symbol;
+  std::string channel;
+  std::string options;
+
+  // Correlation id of the stream's subscription; equal keys share a stream
+  std::string key() const {
+    std::string id = exchange + ":" + symbol + ":" + channel;
+    if (!options.empty()) id += "?" + options;
+    return id;
+  }
+};
+
+// An analyzer fed by a MarketDataBus. It declares the streams it reads and
+// receives their decoded events by index into streams(), on the session's
+// callback thread.
+class MarketDataModule {
+ public:
+  virtual ~MarketDataModule() = default;
+
+  virtual const char *name() const = 0;
+  virtual std::vector<StreamSpec> streams() const = 0;
+
+  // Registers reload callbacks for the settings the module follows live
+  virtual void watchConfig(ConfigWatcher & /*watcher*/) {}
+  // Before the first event, e.g. to print a table header
+  virtual void start() {}
+  virtual void onMarketEvent(size_t stream, const MarketEvent &ev) = 0;
+  // After every ccapi event, once its messages are delivered
+  virtual void onBatchEnd() {}
+  // Drains any worker threads; no events arrive afterwards
+  virtual void stop() {}
+  virtual void printSummary(std::ostream & /*out*/) {}
+};
+
+// Single ccapi event handler fanning decoded events out to modules. Streams
+// requested by several modules are subscribed and decoded once: every
+// message is parsed into a MarketEvent with its receipt time and pipeline
+// stamps, then handed to each subscribed module in the order they were
+// added.
+class MarketDataBus : public EventHandler {
+ public:
+  struct Stats {
+    uint64_t messages = 0;
+    uint64_t events = 0;
+    uint64_t unrouted = 0; // messages of no known stream
+  };
+
+  // Registers module's streams. Call before subscribing or replaying.
+  void add(MarketDataModule &module) {
+    modules_.push_back(&module);
+    auto specs = module.streams();
+    for (size_t i = 0; i < specs.size(); ++i) {
+      auto key = specs[i].key();
+      auto it = index_.find(key);
+      if (it == index_.end()) {
+        it = index_.emplace(key, streams_.size()).first;
+        streams_.push_back(std::make_unique<Stream>(specs[i]));
+      }
+      streams_[it->second]->subscribers.push_back({&module, i});
+    }
+  }
+
+  size_t streamCount() const { return streams_.size(); }
+  const StreamSpec &stream(size_t index) const { return streams_[index]->spec; }
+  size_t subscriberCount(size_t index) const {
+    return streams_[index]->subscribers.size();
+  }
+  const Stats &stats() const { return stats_; }
+
+  // One subscription per distinct stream, tagged with the stream key
+  std::vector<Subscription> subscriptions() const {
+    std::vector<Subscription> out;
+    for (const auto &stream : streams_) {
+      out.emplace_back(stream->spec.exchange, stream->spec.symbol,
+                       stream->spec.channel, stream->spec.options,
+                       stream->spec.key());
+    }
+    return out;
+  }
+
+  void start() {
+    for (auto *module : modules_) module->start();
+  }
+
+  void stop() {
+    for (auto *module : modules_) module->stop();
+  }
+
+  void processEvent(const Event &event, Session * /*session*/) override {
+    RuntimeTuning::instance().pinCallbackThread();
+    if (event.getType() == Event::Type::SUBSCRIPTION_STATUS) {
+      OutputLine(OutputLevel::INFO)
+          << "Received an event of type SUBSCRIPTION_STATUS:\n"
+          << event.toPrettyString(2, 2) << "\n";
+      return;
+    }
+    if (event.getType() != Event::Type::SUBSCRIPTION_DATA) return;
+    int64_t received_stamp = LatencyClock::stamp();
+    for (const auto &message : event.getMessageList()) {
+      ++stats_.messages;
+      Stream *stream = route(message);
+      MarketEvent::Type type;
+      if (!stream || !Stream::Parser::classify(message, type)) {
+        ++stats_.unrouted;
+        continue;
+      }
+      if (received_stamp != 0) {
+        stream->skew->record(EventLog::toNanos(message.getTimeReceived()) -
+                             EventLog::toNanos(message.getTime()));
+      }
+      // Recorded receive times, so a replay sees the same clock as live
+      int64_t receive_time_ns = EventLog::toNanos(message.getTimeReceived());
+      stream->parser.parse(
+          message, type, [this] { return &scratch_; },
+          [&](MarketEvent &ev) {
+            ev.receive_time_ns = receive_time_ns;
+            ev.received_stamp = received_stamp;
+            ev.parsed_stamp = LatencyClock::stamp();
+            parse_latency_->recordSpan(received_stamp, ev.parsed_stamp);
+            ++stats_.events;
+            for (const auto &subscriber : stream->subscribers) {
+              subscriber.module->onMarketEvent(subscriber.stream, ev);
+            }
+          });
+    }
+    for (auto *module : modules_) module->onBatchEnd();
+  }
+
+ private:
+  struct Subscriber {
+    MarketDataModule *module;
+    size_t stream; // index into the module's streams()
+  };
+
+  struct Stream {
+    using Parser = MarketDataParser<Message>;
+
+    explicit Stream(const StreamSpec &stream_spec)
+        : spec(stream_spec),
+          skew(&LatencyMonitor::instance().skew(stream_spec.exchange)) {
+      parser.setDiffMode(spec.options.find("MARKET_DEPTH_RETURN_UPDATE=1") !=
+                         std::string::npos);
+    }
+
+    StreamSpec spec;
+    Parser parser;
+    LatencyHistogram *skew;
+    std::vector<Subscriber> subscribers;
+  };
+
+  Stream *route(const Message &message) const {
+    for (const auto &id : message.getCorrelationIdList()) {
+      auto it = index_.find(id);
+      if (it != index_.end()) return streams_[it->second].get();
+    }
+    return nullptr;
+  }
+
+  std::vector<MarketDataModule *> modules_;
+  std::vector<std::unique_ptr<Stream>> streams_;
+  std::unordered_map<std::string, size_t> index_;
+  MarketEvent scratch_; // decode target, delivered before the next claim
+  LatencyHistogram *parse_latency_ = PipelineLatency::get().parse;
+  Stats stats_;
+};
+
+} // namespace ccapi
@@ -0,0 +1,261 @@
+#pragma once
+#include "market_events.h"
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// Parses a decimal field value without allocating. Returns false on
+// malformed input or trailing characters.
+inline bool parseDouble(std::string_view text, double &out) {
+  if (text.empty()) return false;
+#if defined(__cpp_lib_to_chars)
+  auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+  return result.ec == std::errc() && result.ptr == text.data() + text.size();
+#else
+  // Field values are std::string contents, so they are NUL-terminated
+  char *end = nullptr;
+  out = std::strtod(text.data(), &end);
+  return end == text.data() + text.size();
+#endif
+}
+
+// A decoded market depth field name: BID_PRICE_<n>, BID_SIZE_<n>,
+// ASK_PRICE_<n>, ASK_SIZE_<n>, or the unindexed per-element BID_PRICE /
+// BID_SIZE / ASK_PRICE / ASK_SIZE form.
+struct DepthField {
+  bool is_bid;
+  bool is_price;
+  bool indexed;
+  size_t level;
+};
+
+// Classifies a depth field name with fixed-prefix compares and decodes the
+// level index from its digit suffix. Returns false for unrelated fields.
+inline bool decodeDepthField(std::string_view name, DepthField &field) {
+  static constexpr std::string_view PREFIXES[4] = {"BID_PRICE", "BID_SIZE",
+                                                  "ASK_PRICE", "ASK_SIZE"};
+  if (name.size() < 8 || (name[0] != 'B' && name[0] != 'A')) return false;
+  size_t first = name[0] == 'B' ? 0 : 2;
+  for (size_t p = first; p < first + 2; ++p) {
+    std::string_view prefix = PREFIXES[p];
+    if (name.compare(0, prefix.size(), prefix) != 0) continue;
+    field.is_bid = p < 2;
+    field.is_price = (p % 2) == 0;
+    if (name.size() == prefix.size()) {
+      field.indexed = false;
+      field.level = 0;
+      return true;
+    }
+    if (name[prefix.size()] != '_' || name.size() == prefix.size() + 1) {
+      return false;
+    }
+    size_t level = 0;
+    for (size_t i = prefix.size() + 1; i < name.size(); ++i) {
+      char c = name[i];
+      if (c < '0' || c > '9') return false;
+      level = level * 10 + static_cast<size_t>(c - '0');
+    }
+    field.indexed = true;
+    field.level = level;
+    return true;
+  }
+  return false;
+}
+
+// Decodes ccapi trade and market depth messages into MarketEvents without
+// heap allocation. Dispatches on Message::Type; fields are visited once in a
+// single pass over each element. Templated on the message type so it does
+// not pull ccapi headers into ccapi-independent code.
+template <typename MessageT>
+class MarketDataParser {
+ public:
+  struct Stats {
+    uint64_t trades = 0;
+    uint64_t books = 0;
+    uint64_t rejected = 0;     // messages that produced no usable event
+    uint64_t field_errors = 0; // malformed numeric fields
+  };
+
+  // Maps a message type to the event it decodes into.
+  static bool classify(const MessageT &message, MarketEvent::Type &type) {
+    switch (message.getType()) {
+    case MessageT::Type::MARKET_DATA_EVENTS_TRADE:
+      type = MarketEvent::Type::TRADE;
+      return true;
+    case MessageT::Type::MARKET_DATA_EVENTS_MARKET_DEPTH:
+      type = MarketEvent::Type::BOOK;
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // Decodes message into events obtained from claim() (returning
+  // MarketEvent*, nullptr to give up) and hands each filled event to
+  // commit(MarketEvent&). A depth message whose per-element levels overflow
+  // MAX_BOOK_DEPTH continues in further events that carry the remaining
+  // levels as deltas, so any depth is delivered. Returns the number of events
+  // committed; 0 means the message held no usable trade or book.
+  template <typename Claim, typename Commit>
+  size_t parse(const MessageT &message, MarketEvent::Type type, Claim &&claim,
+               Commit &&commit) {
+    int64_t exchange_time_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            message.getTime().time_since_epoch())
+            .count();
+    MarketEvent *ev = claim();
+    if (!ev) return 0;
+    ev->type = type;
+    ev->exchange_time_ns = exchange_time_ns;
+
+    if (type == MarketEvent::Type::TRADE) {
+      if (!parseTrade(message, ev->trade)) {
+        ++stats_.rejected;
+        return 0;
+      }
+      ++stats_.trades;
+      commit(*ev);
+      return 1;
+    }
+
+    bool snapshot = !diff_mode_ ||
+                    message.getRecapType() == MessageT::RecapType::SOLICITED;
+    size_t committed = parseBook(message, snapshot, ev, claim, commit);
+    if (committed == 0) {
+      ++stats_.rejected;
+    } else {
+      ++stats_.books;
+    }
+    return committed;
+  }
+
+  // In diff mode only the initial (solicited) depth message is a snapshot;
+  // the rest carry changed levels. Otherwise every depth message replaces
+  // the book.
+  void setDiffMode(bool diff_mode) { diff_mode_ = diff_mode; }
+
+  const Stats &stats() const { return stats_; }
+
+ private:
+  bool parseTrade(const MessageT &message, TradeEvent &trade) {
+    trade.price = 0.0;
+    trade.amount = 0.0;
+    trade.side = TradeSide::UNKNOWN;
+    for (const auto &element : message.getElementList()) {
+      for (const auto &pair : element.getNameValueMap()) {
+        std::string_view name = pair.first;
+        if (name == "LAST_PRICE") {
+          parseField(pair.second, trade.price);
+        } else if (name == "LAST_SIZE") {
+          parseField(pair.second, trade.amount);
+        } else if (name == "IS_BUYER_MAKER") {
+          trade.side = pair.second == "1" ? TradeSide::SELL : TradeSide::BUY;
+        }
+      }
+    }
+    return trade.price > 0 && trade.amount > 0;
+  }
+
+  static void startBook(MarketEvent &ev, bool snapshot) {
+    ev.book.bid_count = 0;
+    ev.book.ask_count = 0;
+    ev.book.snapshot = snapshot;
+  }
+
+  // Indexed fields (BID_PRICE_<n>) land at their level and are capped at
+  // MAX_BOOK_DEPTH since map order is lexicographic. Unindexed fields take
+  // one level per element, in element order, and spill into continuation
+  // events.
+  template <typename Claim, typename Commit>
+  size_t parseBook(const MessageT &message, bool snapshot, MarketEvent *ev,
+                   Claim &claim, Commit &commit) {
+    startBook(*ev, snapshot);
+    size_t committed = 0;
+    size_t bid_element = 0; // level of the next unindexed bid element
+    size_t ask_element = 0;
+    size_t bid_base = 0; // first unindexed level held by the current event
+    size_t ask_base = 0;
+    for (const auto &element : message.getElementList()) {
+      bool element_bid = false;
+      bool element_ask = false;
+      for (const auto &pair : element.getNameValueMap()) {
+        DepthField field;
+        if (!decodeDepthField(pair.first, field)) continue;
+        double value;
+        if (!parseField(pair.second, value)) continue;
+        size_t level = field.level;
+        if (!field.indexed) {
+          bool &touched = field.is_bid ? element_bid : element_ask;
+          touched = true;
+          level = (field.is_bid ? bid_element - bid_base
+                                : ask_element - ask_base);
+          if (level >= MAX_BOOK_DEPTH) {
+            // Current event is full on this side: publish and continue
+            MarketEvent *next = flush(*ev, claim, commit, committed);
+            if (!next) return committed;
+            ev = next;
+            bid_base = bid_element + (!field.is_bid && element_bid);
+            ask_base = ask_element + (field.is_bid && element_ask);
+            level = 0;
+          }
+        }
+        if (field.is_bid) {
+          setLevel(ev->book.bid_price, ev->book.bid_size, ev->book.bid_count,
+                   level, field.is_price, value);
+        } else {
+          setLevel(ev->book.ask_price, ev->book.ask_size, ev->book.ask_count,
+                   level, field.is_price, value);
+        }
+      }
+      bid_element += element_bid;
+      ask_element += element_ask;
+    }
+    if (ev->book.bid_count > 0 || ev->book.ask_count > 0) {
+      commit(*ev);
+      ++committed;
+    }
+    return committed;
+  }
+
+  // Commits ev and claims the continuation event (a delta on the same
+  // timestamp). Returns nullptr if no slot could be claimed.
+  template <typename Claim, typename Commit>
+  static MarketEvent *flush(MarketEvent &ev, Claim &claim, Commit &commit,
+                            size_t &committed) {
+    int64_t exchange_time_ns = ev.exchange_time_ns;
+    commit(ev);
+    ++committed;
+    MarketEvent *next = claim();
+    if (!next) return nullptr;
+    next->type = MarketEvent::Type::BOOK;
+    next->exchange_time_ns = exchange_time_ns;
+    startBook(*next, false);
+    return next;
+  }
+
+  // Writes one level, zero-filling any gap below it. Levels beyond
+  // MAX_BOOK_DEPTH are ignored.
+  static void setLevel(double *prices, double *sizes, uint16_t &count,
+                       size_t level, bool is_price, double value) {
+    if (level >= MAX_BOOK_DEPTH) return;
+    while (count <= level) {
+      prices[count] = 0.0;
+      sizes[count] = 0.0;
+      ++count;
+    }
+    (is_price ? prices : sizes)[level] = value;
+  }
+
+  bool parseField(const std::string &text, double &out) {
+    if (parseDouble(text, out)) return true;
+    ++stats_.field_errors;
+    return false;
+  }
+
+  Stats stats_;
+  bool diff_mode_ = false;
+};
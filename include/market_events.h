@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Compact, trivially copyable market data events passed between the ccapi
+// callback thread and analyzer threads.
+
+enum class TradeSide : uint8_t { UNKNOWN = 0, BUY = 1, SELL = 2 };
+
+inline const char *tradeSideName(TradeSide side) {
+  switch (side) {
+  case TradeSide::BUY:
+    return "buy";
+  case TradeSide::SELL:
+    return "sell";
+  default:
+    return "unknown";
+  }
+}
+
+constexpr size_t MAX_BOOK_DEPTH = 20;
+
+struct TradeEvent {
+  double price;
+  double amount;
+  TradeSide side;
+};
+
+// Book levels stored per side as parallel price/size arrays. A snapshot
+// replaces the book (levels best first); otherwise the levels are deltas to
+// apply by price, where size 0 removes the level.
+struct BookEvent {
+  uint16_t bid_count;
+  uint16_t ask_count;
+  bool snapshot;
+  double bid_price[MAX_BOOK_DEPTH];
+  double bid_size[MAX_BOOK_DEPTH];
+  double ask_price[MAX_BOOK_DEPTH];
+  double ask_size[MAX_BOOK_DEPTH];
+};
+
+struct MarketEvent {
+  enum class Type : uint8_t { TRADE = 0, BOOK = 1 };
+
+  Type type;
+  int64_t exchange_time_ns; // exchange timestamp of the message
+  int64_t receive_time_ns;  // local receipt time
+  int64_t received_stamp;   // LatencyClock stamps at receipt and after
+  int64_t parsed_stamp;     // decoding, 0 while instrumentation is off
+  union {
+    TradeEvent trade;
+    BookEvent book;
+  };
+};
+
+static_assert(std::is_trivially_copyable<MarketEvent>::value,
+              "MarketEvent must stay POD so it can be copied through rings");
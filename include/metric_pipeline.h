@@ -0,0 +1,328 @@
+#pragma once
+#include "bar_builder.h"
+#include "liquidity_metrics.h"
+#include "microstructure_stats.h"
+#include "rolling_stats.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+// The liquidity metrics as a pipeline specialized at compile time for the
+// MetricSet an analyzer was configured with (liq_metrics). Each metric
+// group is a kernel over the book or a window over the trades; a
+// StaticMetricPipeline<Set, ...> compiles in only the kernels of Set, with
+// the depth and window sizes as constants, and holds only their trade
+// state. makeMetricPipeline() picks the instantiation for a runtime set, so
+// a monitor that only wants spread and imbalance never maintains returns,
+// regressions or bars.
+
+// Window statistics of the trade-driven metrics, evaluated when a snapshot
+// is taken (O(1) each). Groups that are not selected leave theirs alone.
+struct MetricValues {
+  // Rolling returns
+  size_t returns = 0;
+  double variance = 0.0;
+  double value_at_risk = 0.0;
+  std::optional<double> expected_shortfall;
+  size_t short_window_returns = 0;
+  double short_window_variance = 0.0;
+
+  // Market impact windows, expired to the snapshot time
+  double kyles_daily = 0.0;
+  double kyles_hourly = 0.0;
+  double amihud_1d = 0.0;
+  double amihud_30d = 0.0;
+  double amihud_90d = 0.0;
+};
+
+// An accepted trade as the trade-driven metrics see it
+struct MetricTrade {
+  int64_t timestamp; // ms since epoch
+  double price;
+  double amount;
+  double signed_amount;
+  const ImpactSample *pair;         // with the previous trade, if any
+  std::optional<double> log_return; // from the previous trade, if finite
+};
+
+template <typename Book>
+class MetricPipeline {
+ public:
+  // Computes the selected metrics of groups from a snapshot into out,
+  // leaving its other metrics as they are; touches no pipeline state, so
+  // it runs on any thread
+  using Compute = void (*)(const Book &book, const MetricValues &values,
+                           LiquidityMetrics &out, uint32_t groups);
+
+  virtual ~MetricPipeline() = default;
+
+  virtual MetricSet metrics() const = 0;
+  virtual Compute compute() const = 0;
+
+  virtual void onTrade(const MetricTrade &trade) = 0;
+
+  // Expires the windows to now_ms and evaluates them into values
+  virtual void evaluate(MetricValues &values, int64_t now_ms) = 0;
+
+  // The window's value if this pipeline maintains it (the hourly and daily
+  // Kyle's lambda, the 1, 30 and 90 day Amihud measure); false otherwise
+  virtual bool kylesLambda(int64_t window_ms, int64_t now_ms, double &out) = 0;
+  virtual bool amihudMeasure(int period_days, int64_t now_ms, double &out) = 0;
+
+  // Bars behind the long impact windows; null without an impact metric
+  virtual const BarBuilder *bars() const = 0;
+};
+
+// State of a metric group that is not selected
+struct NoMetricState {
+  template <typename... Args>
+  explicit NoMetricState(Args &&...) {}
+};
+
+// Depth: book levels per side behind depth, imbalance and slopes. Samples:
+// consecutive trade pairs the returns and short impact windows hold, and
+// ShortWindow the returns behind the historical volatility.
+template <uint32_t Set, typename Book, size_t Depth, size_t Samples,
+          size_t ShortWindow>
+class StaticMetricPipeline final : public MetricPipeline<Book> {
+ public:
+  using Interface = MetricPipeline<Book>;
+  using Compute = typename Interface::Compute;
+
+  static constexpr MetricSet SET{Set};
+  static constexpr double SAMPLE_VOLUME = 1.0; // size the VWAP is taken for
+
+  MetricSet metrics() const override { return SET; }
+  Compute compute() const override { return &computeMetrics; }
+
+  static void computeMetrics(const Book &book, const MetricValues &values,
+                             LiquidityMetrics &out, uint32_t groups) {
+    // Unselected groups fold away; groups only narrows the selected ones
+    uint32_t stale = groups & Set;
+    out.computed = SET;
+    out.reset(stale);
+    if constexpr (selected(MetricSet::BOOK)) {
+      if (stale & MetricSet::BOOK) bookMetrics(book, out, stale);
+    }
+    if constexpr (selected(MetricSet::RISK)) {
+      if (stale & MetricSet::RISK) riskMetrics(values, out);
+    }
+    if constexpr (selected(MetricSet::KYLES_LAMBDA)) {
+      if (stale & MetricSet::KYLES_LAMBDA) {
+        out.kyles_lambda.daily = values.kyles_daily;
+        out.kyles_lambda.hourly = values.kyles_hourly;
+      }
+    }
+    if constexpr (selected(MetricSet::AMIHUD)) {
+      if (stale & MetricSet::AMIHUD) {
+        out.amihud_measures.one_day = values.amihud_1d;
+        out.amihud_measures.thirty_days = values.amihud_30d;
+        out.amihud_measures.ninety_days = values.amihud_90d;
+      }
+    }
+  }
+
+  void onTrade(const MetricTrade &trade) override {
+    if constexpr (selected(MetricSet::KYLES_LAMBDA)) {
+      if (trade.pair) {
+        kyles_hourly_.add(trade.timestamp, trade.pair->signed_volume,
+                          trade.pair->log_return, trade.pair->kyle_valid);
+      }
+    }
+    if constexpr (selected(MetricSet::AMIHUD)) {
+      if (trade.pair) {
+        amihud_1d_.add(trade.timestamp, trade.pair->abs_return,
+                       trade.pair->dollar_volume, trade.pair->amihud_valid);
+      }
+    }
+    if constexpr (selected(MetricSet::RISK)) {
+      if (trade.log_return) returns_.add(*trade.log_return);
+    }
+    if constexpr (selected(MetricSet::IMPACT)) {
+      bars_.add(trade.timestamp, trade.price, trade.amount,
+                trade.signed_amount, trade.pair);
+    }
+  }
+
+  void evaluate(MetricValues &values, int64_t now_ms) override {
+    if constexpr (selected(MetricSet::RISK)) {
+      values.returns = returns_.count();
+      if (values.returns > 0) {
+        values.variance = returns_.variance();
+        values.value_at_risk = returns_.valueAtRisk();
+        values.expected_shortfall = returns_.expectedShortfall();
+      }
+      values.short_window_returns = returns_.shortWindowCount();
+      if (values.short_window_returns > 1) {
+        values.short_window_variance = returns_.shortWindowVariance();
+      }
+    }
+    if constexpr (selected(MetricSet::KYLES_LAMBDA)) {
+      kylesLambda(BarBuilder::DAY_MS, now_ms, values.kyles_daily);
+      kylesLambda(BarBuilder::HOUR_MS, now_ms, values.kyles_hourly);
+    }
+    if constexpr (selected(MetricSet::AMIHUD)) {
+      amihudMeasure(1, now_ms, values.amihud_1d);
+      amihudMeasure(30, now_ms, values.amihud_30d);
+      amihudMeasure(90, now_ms, values.amihud_90d);
+    }
+  }
+
+  bool kylesLambda(int64_t window_ms, int64_t now_ms, double &out) override {
+    if constexpr (selected(MetricSet::KYLES_LAMBDA)) {
+      if (window_ms == BarBuilder::HOUR_MS) {
+        kyles_hourly_.expire(now_ms);
+        out = kyles_hourly_.slope();
+        return true;
+      }
+      if (window_ms == BarBuilder::DAY_MS) {
+        out = bars_.daily().kylesLambda(now_ms);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool amihudMeasure(int period_days, int64_t now_ms, double &out) override {
+    if constexpr (selected(MetricSet::AMIHUD)) {
+      if (period_days == 1) {
+        amihud_1d_.expire(now_ms);
+        out = amihud_1d_.value();
+        return true;
+      }
+      if (period_days == 30) {
+        out = bars_.thirtyDays().amihudMeasure(now_ms);
+        return true;
+      }
+      if (period_days == 90) {
+        out = bars_.ninetyDays().amihudMeasure(now_ms);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const BarBuilder *bars() const override {
+    if constexpr (selected(MetricSet::IMPACT)) {
+      return &bars_;
+    } else {
+      return nullptr;
+    }
+  }
+
+ private:
+  static constexpr bool selected(uint32_t groups) { return (Set & groups) != 0; }
+
+  template <uint32_t Groups, typename State>
+  using Keep = std::conditional_t<(Set & Groups) != 0, State, NoMetricState>;
+
+  // Spread, depth, VWAP and slopes of groups from the book's prefix sums
+  static void bookMetrics(const Book &book, LiquidityMetrics &metrics,
+                          uint32_t groups) {
+    const auto &bids = book.bids();
+    const auto &asks = book.asks();
+    if (bids.empty() || asks.empty()) {
+      return;
+    }
+
+    double best_bid = bids.best();
+    double best_ask = asks.best();
+
+    if (selected(MetricSet::SPREAD) && (groups & MetricSet::SPREAD)) {
+      metrics.spread = best_ask - best_bid;
+      double mid_price = (best_ask + best_bid) / 2.0;
+      if (mid_price > 0) {
+        metrics.relative_spread = metrics.spread / mid_price;
+      }
+    }
+
+    if (selected(MetricSet::DEPTH) && (groups & MetricSet::DEPTH)) {
+      metrics.bid_depth = bids.depth(Depth);
+      metrics.ask_depth = asks.depth(Depth);
+      if (metrics.bid_depth + metrics.ask_depth > 0) {
+        metrics.order_book_imbalance = (metrics.bid_depth - metrics.ask_depth) /
+                                       (metrics.bid_depth + metrics.ask_depth);
+      }
+    }
+
+    if (selected(MetricSet::VWAP) && (groups & MetricSet::VWAP)) {
+      double bid_vwap = bids.vwap(SAMPLE_VOLUME);
+      double ask_vwap = asks.vwap(SAMPLE_VOLUME);
+      if (bid_vwap > 0) {
+        metrics.bid_vwap = bid_vwap;
+        metrics.bid_slippage = (best_bid - bid_vwap) / best_bid;
+      }
+      if (ask_vwap > 0) {
+        metrics.ask_vwap = ask_vwap;
+        metrics.ask_slippage = (ask_vwap - best_ask) / best_ask;
+      }
+    }
+
+    if (selected(MetricSet::SLOPE) && (groups & MetricSet::SLOPE)) {
+      metrics.bid_slope = bids.slope(Depth);
+      metrics.ask_slope = asks.slope(Depth);
+    }
+  }
+
+  // Volatilities, VaR and expected shortfall from the rolling returns
+  static void riskMetrics(const MetricValues &values, LiquidityMetrics &metrics) {
+    if (values.returns == 0) {
+      return;
+    }
+
+    // Annualized volatility (assuming 24h trading)
+    if (values.variance >= 0 && std::isfinite(values.variance)) {
+      metrics.realized_volatility = std::sqrt(values.variance * 365 * 24) * 100;
+    }
+
+    // Value at Risk (5th percentile)
+    metrics.var_95 = values.value_at_risk * 100;
+
+    // Expected Shortfall (mean of worst 5%)
+    if (values.expected_shortfall) {
+      metrics.expected_shortfall_95 = *values.expected_shortfall * 100;
+    }
+
+    // Rolling historical volatility (last ShortWindow periods)
+    if (values.short_window_returns > 1) {
+      double window_variance = values.short_window_variance;
+      if (window_variance >= 0 && std::isfinite(window_variance)) {
+        metrics.historical_volatility =
+            std::sqrt(window_variance * 365 * 24) * 100;
+      }
+    }
+  }
+
+  Keep<MetricSet::RISK, RollingReturnStats> returns_{Samples, ShortWindow};
+  Keep<MetricSet::KYLES_LAMBDA, WindowedRegression> kyles_hourly_{
+      Samples, BarBuilder::HOUR_MS};
+  Keep<MetricSet::AMIHUD, AmihudAccumulator> amihud_1d_{Samples, 1};
+  // Shared by the daily Kyle's lambda and the 30/90 day Amihud measures
+  Keep<MetricSet::IMPACT, BarBuilder> bars_;
+};
+
+template <template <uint32_t> class Pipeline, uint32_t Set>
+std::unique_ptr<typename Pipeline<Set>::Interface> makeStaticMetricPipeline() {
+  return std::make_unique<Pipeline<Set>>();
+}
+
+template <template <uint32_t> class Pipeline, uint32_t... Sets>
+std::unique_ptr<typename Pipeline<MetricSet::ALL>::Interface>
+makeMetricPipeline(MetricSet set, std::integer_sequence<uint32_t, Sets...>) {
+  using Make = std::unique_ptr<typename Pipeline<MetricSet::ALL>::Interface> (*)();
+  static constexpr Make make[] = {&makeStaticMetricPipeline<Pipeline, Sets>...};
+  return make[set.groups & MetricSet::ALL]();
+}
+
+// The instantiation of Pipeline (a StaticMetricPipeline with its set left
+// open) for set
+template <template <uint32_t> class Pipeline>
+std::unique_ptr<typename Pipeline<MetricSet::ALL>::Interface>
+makeMetricPipeline(MetricSet set) {
+  return makeMetricPipeline<Pipeline>(
+      set, std::make_integer_sequence<uint32_t, MetricSet::ALL + 1>());
+}
@@ -0,0 +1,214 @@
+#pragma once
+#include "rolling_stats.h"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Streaming least-squares slope of y on x over the samples that are both
+// among the last `capacity` added and no older than `window_ms`. Keeps
+// running Σx, Σy, Σxy, Σx² so slope() is O(1); expire() is amortized O(1).
+// Samples added with valid = false occupy a slot (so count-based expiry
+// tracks the trade history) but never enter the fit.
+class WindowedRegression {
+ public:
+  WindowedRegression(size_t capacity, int64_t window_ms)
+      : samples_(capacity), window_ms_(window_ms) {}
+
+  void add(int64_t timestamp_ms, double x, double y, bool valid = true) {
+    expire(timestamp_ms);
+    if (samples_.full()) remove(samples_.pop_front());
+    samples_.push({timestamp_ms, x, y, valid});
+    if (valid) {
+      sx_ += x;
+      sy_ += y;
+      sxy_ += x * y;
+      sxx_ += x * x;
+      ++n_;
+    }
+  }
+
+  // Drops samples older than now_ms - window_ms.
+  void expire(int64_t now_ms) {
+    while (!samples_.empty() && now_ms - samples_.front().ts > window_ms_) {
+      remove(samples_.pop_front());
+    }
+  }
+
+  size_t count() const { return n_; }
+  int64_t windowMs() const { return window_ms_; }
+
+  double slope() const { return slopeOf(n_, sx_, sy_, sxy_, sxx_); }
+
+  // Least-squares slope from the sums of n samples
+  static double slopeOf(size_t count, double sx, double sy, double sxy,
+                        double sxx) {
+    if (count < 2) return 0.0;
+    double n = static_cast<double>(count);
+    double numerator = sxy - sx * sy / n;
+    double denominator = sxx - sx * sx / n;
+    // Treat a denominator lost in rounding noise as zero variance in x
+    if (!(denominator > 1e-12 * sxx) || !std::isfinite(numerator)) return 0.0;
+    return numerator / denominator;
+  }
+
+ private:
+  struct Sample {
+    int64_t ts;
+    double x;
+    double y;
+    bool valid;
+  };
+
+  void remove(const Sample &s) {
+    if (!s.valid) return;
+    if (--n_ == 0) {
+      sx_ = sy_ = sxy_ = sxx_ = 0.0;
+      removals_ = 0;
+      return;
+    }
+    sx_ -= s.x;
+    sy_ -= s.y;
+    sxy_ -= s.x * s.y;
+    sxx_ -= s.x * s.x;
+    if (++removals_ >= samples_.capacity()) resync();
+  }
+
+  void resync() {
+    sx_ = sy_ = sxy_ = sxx_ = 0.0;
+    for (size_t i = 0; i < samples_.size(); ++i) {
+      const Sample &s = samples_[i];
+      if (!s.valid) continue;
+      sx_ += s.x;
+      sy_ += s.y;
+      sxy_ += s.x * s.y;
+      sxx_ += s.x * s.x;
+    }
+    removals_ = 0;
+  }
+
+  RingBuffer<Sample> samples_;
+  int64_t window_ms_;
+  double sx_ = 0.0, sy_ = 0.0, sxy_ = 0.0, sxx_ = 0.0;
+  size_t n_ = 0;
+  size_t removals_ = 0;
+};
+
+// Streaming Amihud illiquidity over a trailing period: the mean across days
+// of Σ|return| / Σ dollar volume. Per-trade contributions live in a ring so
+// they can be expired by count or age; per-day totals live in a small ring
+// of day buckets indexed by day number, and the sum of daily ratios is kept
+// current so value() is O(1).
+class AmihudAccumulator {
+ public:
+  static constexpr int64_t DAY_IN_MS = 86400000LL;
+
+  AmihudAccumulator(size_t capacity, int period_days)
+      : samples_(capacity), period_ms_(period_days * DAY_IN_MS),
+        buckets_(static_cast<size_t>(period_days) + 2) {}
+
+  void add(int64_t timestamp_ms, double abs_return, double dollar_volume,
+           bool valid = true) {
+    expire(timestamp_ms);
+    if (samples_.full()) remove(samples_.pop_front());
+
+    int64_t day = timestamp_ms / DAY_IN_MS;
+    if (valid) {
+      // A slot still holding an older day can only contain samples that are
+      // out of the period relative to this one; drain them first
+      Bucket &slot = bucketFor(day);
+      while (slot.trades > 0 && slot.day != day && !samples_.empty()) {
+        remove(samples_.pop_front());
+      }
+      update(day, abs_return, dollar_volume, +1);
+    }
+    samples_.push({timestamp_ms, day, abs_return, dollar_volume, valid});
+  }
+
+  // Drops contributions older than now_ms - period.
+  void expire(int64_t now_ms) {
+    while (!samples_.empty() && now_ms - samples_.front().ts > period_ms_) {
+      remove(samples_.pop_front());
+    }
+  }
+
+  double value() const {
+    return valid_days_ > 0 ? ratio_sum_ / valid_days_ : 0.0;
+  }
+
+ private:
+  struct Sample {
+    int64_t ts;
+    int64_t day;
+    double abs_return;
+    double dollar_volume;
+    bool valid;
+  };
+
+  struct Bucket {
+    int64_t day = 0;
+    double abs_return = 0.0;
+    double dollar_volume = 0.0;
+    size_t trades = 0;
+  };
+
+  Bucket &bucketFor(int64_t day) {
+    int64_t n = static_cast<int64_t>(buckets_.size());
+    return buckets_[static_cast<size_t>(((day % n) + n) % n)];
+  }
+
+  static bool ratio(const Bucket &b, double &out) {
+    if (b.trades == 0 || !(b.dollar_volume > 0)) return false;
+    out = b.abs_return / b.dollar_volume;
+    return std::isfinite(out);
+  }
+
+  void update(int64_t day, double abs_return, double dollar_volume, int sign) {
+    Bucket &b = bucketFor(day);
+    double r;
+    if (ratio(b, r)) {
+      ratio_sum_ -= r;
+      --valid_days_;
+    }
+    if (sign > 0) {
+      if (b.trades == 0) b = Bucket{day};
+      b.abs_return += abs_return;
+      b.dollar_volume += dollar_volume;
+      ++b.trades;
+    } else if (--b.trades == 0) {
+      b = Bucket{day};
+    } else {
+      b.abs_return -= abs_return;
+      b.dollar_volume -= dollar_volume;
+    }
+    if (ratio(b, r)) {
+      ratio_sum_ += r;
+      ++valid_days_;
+    }
+    if (valid_days_ == 0) ratio_sum_ = 0.0;
+    if (++updates_ >= samples_.capacity()) resync();
+  }
+
+  void resync() {
+    ratio_sum_ = 0.0;
+    valid_days_ = 0;
+    for (const Bucket &b : buckets_) {
+      double r;
+      if (ratio(b, r)) {
+        ratio_sum_ += r;
+        ++valid_days_;
+      }
+    }
+    updates_ = 0;
+  }
+
+  void remove(const Sample &s) {
+    if (s.valid) update(s.day, s.abs_return, s.dollar_volume, -1);
+  }
+
+  RingBuffer<Sample> samples_;
+  int64_t period_ms_;
+  std::vector<Bucket> buckets_;
+  double ratio_sum_ = 0.0;
+  size_t valid_days_ = 0;
+  size_t updates_ = 0;
+};
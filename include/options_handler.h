@@ -0,0 +1,319 @@
+#pragma once
+#include "black_scholes.h"
+#include "black_scholes_batch.h"
+#include "ccapi_cpp/ccapi_session.h"
+#include "event_log.h"
+#include "latency_monitor.h"
+#include "market_events.h"
+#include "output_sink.h"
+#include "runtime_tuning.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ccapi {
+
+class OptionsEventHandler : public EventHandler {
+private:
+  double risk_free_rate_ = 0.0;
+  double days_to_expiry_ = 0.0;
+
+  // Synthetic chain repriced in one batch per spot update (empty = off)
+  std::vector<double> chain_expiry_days_;
+  int chain_strikes_per_side_ = 0;
+  double chain_strike_step_ = 0.01;
+  double chain_volatility_ = 0.80;
+  BatchBlackScholes batch_pricer_;
+  OptionChain chain_;
+  ChainGreeks chain_greeks_;
+  ImpliedVolSolver iv_solver_;
+  std::vector<double> chain_ivs_;
+
+  // Recompute throttling: spot updates are coalesced and a full reprice
+  // runs at most every reprice_interval_ms_ (0 = every update) unless spot
+  // moves reprice_move_ (fraction) from the last one. In between, the chain
+  // optionally follows spot by a delta/gamma Taylor update.
+  long reprice_interval_ms_ = 1000;
+  double reprice_move_ = 0.001;
+  bool taylor_updates_ = true;
+  bool priced_ = false;
+  double priced_spot_ = 0.0;
+  TimePoint priced_at_;
+  uint64_t updates_since_reprice_ = 0;
+  uint64_t coalesced_since_reprice_ = 0;
+  uint64_t taylor_since_reprice_ = 0;
+  ChainGreeks chain_base_;       // last full pricing of the chain
+  double chain_base_spot_ = 0.0; // spot it was priced at
+  std::vector<double> taylor_price_;
+
+  // Spot updates waiting to be priced; only the latest is
+  double pending_spot_ = 0.0;
+  TimePoint pending_received_;
+  uint64_t pending_updates_ = 0;
+  int64_t pending_received_ns_ = 0;
+  int64_t pending_parsed_ns_ = 0;
+
+  // Spot handling (pricing and its report lines) is timed as "analyze"
+  PipelineLatency latency_ = PipelineLatency::get();
+  LatencyHistogram *skew_latency_ = &LatencyMonitor::instance().skew("binance");
+
+public:
+  explicit OptionsEventHandler(double risk_free_rate, double default_days_to_expiry)
+      : risk_free_rate_(risk_free_rate), days_to_expiry_(default_days_to_expiry) {}
+
+  // Calls and puts at strikes_per_side strikes either side of the first
+  // spot, strike_step apart (as a fraction of spot), for each expiry.
+  void configureChain(const std::vector<double> &expiry_days,
+                      int strikes_per_side, double strike_step,
+                      double volatility, double cdf_tolerance) {
+    chain_expiry_days_ = expiry_days;
+    chain_strikes_per_side_ = strikes_per_side;
+    chain_strike_step_ = strike_step;
+    chain_volatility_ = volatility;
+    batch_pricer_ = BatchBlackScholes(cdf_tolerance);
+    chain_.clear();
+    iv_solver_.reset();
+  }
+
+  void configureThrottle(long interval_ms, double move, bool taylor_updates) {
+    reprice_interval_ms_ = interval_ms;
+    reprice_move_ = move;
+    taylor_updates_ = taylor_updates;
+  }
+
+  void processEvent(const Event &event, Session *session) override {
+    RuntimeTuning::instance().pinCallbackThread();
+    if (event.getType() == Event::Type::SUBSCRIPTION_DATA) {
+      // Only the latest spot of a batch is worth pricing
+      int64_t received_ns = LatencyClock::stamp();
+      for (const auto &message : event.getMessageList()) {
+        double price = extractPrice(message);
+        if (price > 0) {
+          addSpot(price, message.getTimeReceived());
+          if (received_ns != 0) {
+            skew_latency_->record(EventLog::toNanos(message.getTimeReceived()) -
+                                  EventLog::toNanos(message.getTime()));
+          }
+        }
+      }
+      if (pending_updates_ == 0) return;
+      int64_t parsed_ns = LatencyClock::stamp();
+      latency_.parse->recordSpan(received_ns, parsed_ns);
+      pricePending(received_ns, parsed_ns);
+    }
+  }
+
+  // Spot from an event decoded elsewhere, e.g. by a MarketDataBus shared
+  // with other modules: a trade's price or a book's best bid. Updates are
+  // coalesced until endBatch().
+  void onMarketEvent(const MarketEvent &ev) {
+    double price = 0.0;
+    if (ev.type == MarketEvent::Type::TRADE) {
+      price = ev.trade.price;
+    } else if (ev.book.bid_count > 0) {
+      price = ev.book.bid_price[0];
+    }
+    if (price <= 0) return;
+    if (pending_updates_ == 0) {
+      pending_received_ns_ = ev.received_stamp;
+      pending_parsed_ns_ = ev.parsed_stamp;
+    }
+    addSpot(price, TimePoint(std::chrono::nanoseconds(ev.receive_time_ns)));
+  }
+
+  // Prices the latest spot given to onMarketEvent() since the last call
+  void endBatch() { pricePending(pending_received_ns_, pending_parsed_ns_); }
+
+private:
+  void addSpot(double spot, const TimePoint &received) {
+    pending_spot_ = spot;
+    pending_received_ = received;
+    ++pending_updates_;
+  }
+
+  // received_ns/parsed_ns are LatencyClock stamps of the first pending
+  // update, 0 if untimed
+  void pricePending(int64_t received_ns, int64_t parsed_ns) {
+    if (pending_updates_ == 0) return;
+    AllocationSpan allocation_span(latency_.allocations, received_ns);
+    coalesced_since_reprice_ += pending_updates_ - 1;
+    pending_updates_ = 0;
+    onSpot(pending_spot_, pending_received_);
+    int64_t done_ns = LatencyClock::stamp();
+    latency_.analyze->recordSpan(parsed_ns, done_ns);
+    latency_.total->recordSpan(received_ns, done_ns);
+  }
+
+  static double extractPrice(const Message &message) {
+    double current_price = 0.0;
+    for (const auto &element : message.getElementList()) {
+      const std::map<std::string_view, std::string> &elementNameValueMap =
+          element.getNameValueMap();
+      for (const auto &pair : elementNameValueMap) {
+        if (pair.first == "LAST_PRICE" || pair.first == "BID_PRICE_0") {
+          current_price = std::stod(pair.second);
+          break;
+        }
+      }
+      if (current_price > 0)
+        break;
+    }
+    return current_price;
+  }
+
+  void onSpot(double spot, const TimePoint &now) {
+    ++updates_since_reprice_;
+    bool due = !priced_ || reprice_interval_ms_ <= 0 ||
+               std::chrono::duration_cast<std::chrono::milliseconds>(
+                   now - priced_at_)
+                       .count() >= reprice_interval_ms_ ||
+               (reprice_move_ > 0 &&
+                std::abs(spot / priced_spot_ - 1.0) >= reprice_move_);
+    if (!due) {
+      if (taylor_updates_) taylorChain(spot);
+      return;
+    }
+    priced_at_ = now;
+    // Nothing to reprice if the inputs have not changed since last time
+    if (priced_ && spot == priced_spot_) return;
+
+    OutputLine() << "\n" << Repeat{'-', 50} << "\n"
+                 << "Received market data for: BTCUSDT ("
+                 << updates_since_reprice_ << " updates since last reprice, "
+                 << coalesced_since_reprice_ << " coalesced)\n";
+
+    // Example: Calculate Greeks for a BTC option
+    // In practice, you'd get this data from Binance options API
+    calculateExampleGreeks("BTCUSDT", spot);
+    repriceChain(spot);
+
+    priced_ = true;
+    priced_spot_ = spot;
+    updates_since_reprice_ = 0;
+    coalesced_since_reprice_ = 0;
+    taylor_since_reprice_ = 0;
+  }
+
+  // Moves every expiry from its last full pricing to spot
+  void taylorChain(double spot) {
+    if (chain_base_.size() == 0) return;
+    const auto &expiries = chain_.expiries();
+    for (size_t e = 0; e < expiries.size(); ++e) {
+      chain_greeks_.taylorFrom(chain_base_, spot - chain_base_spot_,
+                               expiries[e].begin, expiries[e].end);
+    }
+    ++taylor_since_reprice_;
+  }
+
+  void buildChain(double spot) {
+    chain_.clear();
+    for (double days : chain_expiry_days_) {
+      chain_.addExpiry(days / 365.0);
+      for (int k = -chain_strikes_per_side_; k <= chain_strikes_per_side_;
+           ++k) {
+        double strike = spot * (1.0 + k * chain_strike_step_);
+        if (strike <= 0) continue;
+        chain_.addOption(strike, chain_volatility_, true);
+        chain_.addOption(strike, chain_volatility_, false);
+      }
+    }
+  }
+
+  void repriceChain(double spot) {
+    if (chain_expiry_days_.empty() || chain_strikes_per_side_ <= 0) return;
+    if (chain_.size() == 0) buildChain(spot);
+
+    // How far the Taylor updates drifted from the full pricing below
+    bool have_taylor = taylor_since_reprice_ > 0;
+    if (have_taylor) {
+      taylorChain(spot);
+      taylor_price_ = chain_greeks_.price;
+    }
+
+    // Every expiry shares the spot, so a reprice covers the whole chain
+    auto start = std::chrono::steady_clock::now();
+    for (size_t e = 0; e < chain_.expiries().size(); ++e) {
+      batch_pricer_.price(spot, risk_free_rate_, chain_, e, chain_base_);
+    }
+    chain_base_spot_ = spot;
+    chain_greeks_ = chain_base_;
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+    double taylor_error = 0.0;
+    if (have_taylor) {
+      for (size_t i = 0; i < taylor_price_.size(); ++i) {
+        taylor_error = std::max(
+            taylor_error, std::abs(taylor_price_[i] - chain_greeks_.price[i]));
+      }
+    }
+
+    // Round-trip the model prices through the IV solver; with warm starts
+    // from the previous tick this is the cost of a live vol surface
+    auto iv_stats = iv_solver_.solve(spot, risk_free_rate_, chain_,
+                                     chain_greeks_.price.data(), chain_ivs_);
+
+    double net_delta = 0.0, net_gamma = 0.0, net_vega = 0.0;
+    for (size_t i = 0; i < chain_greeks_.size(); ++i) {
+      net_delta += chain_greeks_.delta[i];
+      net_gamma += chain_greeks_.gamma[i];
+      net_vega += chain_greeks_.vega[i];
+    }
+    OutputLine out;
+    out << "\nCHAIN: " << chain_.size() << " options over "
+        << chain_.expiries().size() << " expiries repriced in " << elapsed
+        << " us ("
+        << (batch_pricer_.usesFastCdf() ? "fast" : "exact")
+        << " CDF) | sum delta " << std::setprecision(4) << net_delta
+        << " | sum gamma " << net_gamma << " | sum vega $" << net_vega << "\n";
+    out << "  IV: " << iv_stats.solved << " solved, " << iv_stats.failed
+        << " failed, " << std::setprecision(2)
+        << iv_stats.meanIterations() << " mean / "
+        << iv_stats.max_iterations << " max iterations\n";
+    if (have_taylor) {
+      out << "  TAYLOR: " << taylor_since_reprice_
+          << " updates since last reprice, max price error $"
+          << std::setprecision(6) << taylor_error << "\n";
+    }
+  }
+
+  void calculateExampleGreeks(const std::string &instrument,
+                              double spot_price) {
+    // Example option data - in practice, get this from Binance options API
+    BlackScholesCalculator::OptionData option_data;
+    option_data.spot_price = spot_price;
+    option_data.strike_price = spot_price * 1.05; // 5% OTM call
+    option_data.time_to_expiry = days_to_expiry_ / 365.0;    // days from config
+    option_data.risk_free_rate = risk_free_rate_;               // risk-free from config
+    option_data.volatility =
+        0.80;                   // 80% implied volatility (typical for crypto)
+    option_data.is_call = true; // Call option
+    option_data.option_price = spot_price * 0.02; // Example option price
+    option_data.volume = 1500;                    // Example volume
+    option_data.open_interest = 5000;             // Example open interest
+
+    BlackScholesCalculator::Greeks greeks =
+        BlackScholesCalculator::calculateGreeks(option_data);
+    BlackScholesCalculator::printGreeks(instrument, "Call Option", option_data,
+                                        greeks);
+
+    // Also calculate for a put option
+    option_data.is_call = false;
+    option_data.strike_price = spot_price * 0.95;  // 5% OTM put
+    option_data.option_price = spot_price * 0.015; // Example put price
+    option_data.time_to_expiry = days_to_expiry_ / 365.0; // days from config
+    option_data.risk_free_rate = risk_free_rate_;            // risk-free from config
+
+    BlackScholesCalculator::Greeks put_greeks =
+        BlackScholesCalculator::calculateGreeks(option_data);
+    BlackScholesCalculator::printGreeks(instrument, "Put Option", option_data,
+                                        put_greeks);
+  }
+};
+
+} // namespace ccapi
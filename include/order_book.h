@@ -0,0 +1,287 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+// Fixed-capacity L2 order book with structure-of-arrays levels per side.
+//
+// Levels are kept best first. Snapshots that arrive sorted (the normal case)
+// are appended without sorting; deltas are located by binary search and
+// applied in place. Each side maintains prefix sums of size, notional and
+// the regression terms of price on cumulative size, rebuilt only from the
+// first changed level, so depth, VWAP and slope reads never rescan.
+template <size_t Capacity>
+class BasicOrderBook {
+ public:
+  static constexpr size_t CAPACITY = Capacity;
+
+  class Side {
+   public:
+    explicit Side(bool is_bid) : is_bid_(is_bid) {}
+
+    size_t levels() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    double price(size_t i) const { return price_[i]; }
+    double size(size_t i) const { return size_[i]; }
+    double best() const { return count_ ? price_[0] : 0.0; }
+
+    // Total size of the best n levels.
+    double depth(size_t n) const {
+      n = std::min(n, count_);
+      return n ? cum_size_[n - 1] : 0.0;
+    }
+
+    // Average fill price for target_volume walked from the top of the book,
+    // or over the whole side if it holds less. 0 when empty.
+    double vwap(double target_volume) const {
+      if (count_ == 0 || target_volume <= 0.0) return 0.0;
+      const double *end = cum_size_.data() + count_;
+      const double *it = std::lower_bound(cum_size_.data(), end, target_volume);
+      if (it == end) {
+        double total = cum_size_[count_ - 1];
+        return total > 0 ? cum_notional_[count_ - 1] / total : 0.0;
+      }
+      size_t k = static_cast<size_t>(it - cum_size_.data());
+      double before = k ? cum_size_[k - 1] : 0.0;
+      double notional = (k ? cum_notional_[k - 1] : 0.0) +
+                        price_[k] * (target_volume - before);
+      return notional / target_volume;
+    }
+
+    // Least-squares slope of price on cumulative size over the best
+    // `depth` levels; 0 with fewer than two levels.
+    double slope(size_t depth) const {
+      size_t n = std::min(depth, count_);
+      if (n < 2) return 0.0;
+      double cnt = static_cast<double>(n);
+      double sx = sum_x_[n - 1], sy = sum_y_[n - 1];
+      double numerator = sum_xy_[n - 1] - sx * sy / cnt;
+      double denominator = sum_xx_[n - 1] - sx * sx / cnt;
+      if (!(denominator > 1e-12 * sum_xx_[n - 1]) ||
+          !std::isfinite(numerator)) {
+        return 0.0;
+      }
+      return numerator / denominator;
+    }
+
+    // Empties the side for a snapshot. Levels the snapshot appends as they
+    // were stay clean, so a repeated top of book keeps its prefix sums.
+    void clear() { count_ = 0; }
+
+    // Sets the size at price; size <= 0 removes the level. Levels that would
+    // rank beyond CAPACITY are dropped.
+    void apply(double price, double size) {
+      if (!(price > 0.0)) return;
+      size_t i = find(price);
+      bool exists = i < count_ && price_[i] == price;
+      if (!(size > 0.0)) {
+        if (exists) erase(i);
+        return;
+      }
+      if (exists) {
+        if (size_[i] != size) {
+          size_[i] = size;
+          markDirty(i);
+        }
+        return;
+      }
+      if (i >= Capacity) return;
+      size_t last = std::min(count_, Capacity - 1);
+      for (size_t j = last; j > i; --j) {
+        price_[j] = price_[j - 1];
+        size_[j] = size_[j - 1];
+      }
+      price_[i] = price;
+      size_[i] = size;
+      count_ = std::min(count_ + 1, Capacity);
+      markDirty(i);
+    }
+
+    // Appends a level during a snapshot. Falls back to apply() when the
+    // input is out of order or repeats a price.
+    void append(double price, double size) {
+      if (!(price > 0.0) || !(size > 0.0)) return;
+      if (count_ == 0 || better(price_[count_ - 1], price)) {
+        if (count_ == Capacity) return;
+        if (count_ >= finalized_count_ || price_[count_] != price ||
+            size_[count_] != size) {
+          price_[count_] = price;
+          size_[count_] = size;
+          markDirty(count_);
+        }
+        ++count_;
+      } else {
+        apply(price, size);
+      }
+    }
+
+    // Rebuilds the prefix sums from the first level changed since the last
+    // call.
+    void finalize() {
+      if (count_ != finalized_count_) {
+        markDirty(std::min(count_, finalized_count_));
+      }
+      for (size_t i = dirty_from_; i < count_; ++i) {
+        double prev_cum = i ? cum_size_[i - 1] : 0.0;
+        double x = prev_cum + size_[i];
+        double y = price_[i];
+        cum_size_[i] = x;
+        cum_notional_[i] = (i ? cum_notional_[i - 1] : 0.0) + y * size_[i];
+        sum_x_[i] = (i ? sum_x_[i - 1] : 0.0) + x;
+        sum_xx_[i] = (i ? sum_xx_[i - 1] : 0.0) + x * x;
+        sum_y_[i] = (i ? sum_y_[i - 1] : 0.0) + y;
+        sum_xy_[i] = (i ? sum_xy_[i - 1] : 0.0) + x * y;
+      }
+      changed_from_ = dirty_from_;
+      dirty_from_ = Capacity;
+      finalized_count_ = count_;
+    }
+
+    // First level the last finalize() found changed; the levels above it
+    // read as before. Capacity when nothing had changed.
+    size_t changedFrom() const { return changed_from_; }
+
+    // The best n levels of a finalized side, prefix sums included
+    void copyTop(const Side &other, size_t n) {
+      n = std::min(n, other.count_);
+      auto copy = [n](auto &to, const auto &from) {
+        std::copy_n(from.begin(), n, to.begin());
+      };
+      copy(price_, other.price_);
+      copy(size_, other.size_);
+      copy(cum_size_, other.cum_size_);
+      copy(cum_notional_, other.cum_notional_);
+      copy(sum_x_, other.sum_x_);
+      copy(sum_xx_, other.sum_xx_);
+      copy(sum_y_, other.sum_y_);
+      copy(sum_xy_, other.sum_xy_);
+      count_ = n;
+      changed_from_ = 0;
+      dirty_from_ = Capacity;
+      finalized_count_ = n;
+    }
+
+   private:
+    bool better(double a, double b) const { return is_bid_ ? a > b : a < b; }
+
+    // Index of the first level not better than price.
+    size_t find(double price) const {
+      size_t lo = 0, hi = count_;
+      while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (better(price_[mid], price)) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      return lo;
+    }
+
+    void erase(size_t i) {
+      for (size_t j = i + 1; j < count_; ++j) {
+        price_[j - 1] = price_[j];
+        size_[j - 1] = size_[j];
+      }
+      --count_;
+      markDirty(i);
+    }
+
+    void markDirty(size_t i) { dirty_from_ = std::min(dirty_from_, i); }
+
+    bool is_bid_;
+    size_t count_ = 0;
+    size_t dirty_from_ = 0;
+    size_t changed_from_ = 0;
+    size_t finalized_count_ = 0; // levels at the last finalize()
+    std::array<double, Capacity> price_{};
+    std::array<double, Capacity> size_{};
+    std::array<double, Capacity> cum_size_{};
+    std::array<double, Capacity> cum_notional_{};
+    std::array<double, Capacity> sum_x_{};  // Σ cumulative size
+    std::array<double, Capacity> sum_xx_{}; // Σ cumulative size²
+    std::array<double, Capacity> sum_y_{};  // Σ price
+    std::array<double, Capacity> sum_xy_{}; // Σ price × cumulative size
+  };
+
+  BasicOrderBook() : bids_(true), asks_(false) {}
+
+  const Side &bids() const { return bids_; }
+  const Side &asks() const { return asks_; }
+
+  // Replaces the book with the given levels (expected best first).
+  void applySnapshot(const double *bid_price, const double *bid_size,
+                     size_t bid_count, const double *ask_price,
+                     const double *ask_size, size_t ask_count) {
+    stageSnapshot(bid_price, bid_size, bid_count, ask_price, ask_size, ask_count);
+    finalize();
+  }
+
+  // Same as above for containers of levels exposing .price and .size.
+  template <typename Levels>
+  void applySnapshot(const Levels &bids, const Levels &asks) {
+    bids_.clear();
+    asks_.clear();
+    for (const auto &level : bids) bids_.append(level.price, level.size);
+    for (const auto &level : asks) asks_.append(level.price, level.size);
+    finalize();
+  }
+
+  // Applies price-level changes; size 0 deletes a level.
+  void applyDelta(const double *bid_price, const double *bid_size,
+                  size_t bid_count, const double *ask_price,
+                  const double *ask_size, size_t ask_count) {
+    stageDelta(bid_price, bid_size, bid_count, ask_price, ask_size, ask_count);
+    finalize();
+  }
+
+  // The two updates above without rebuilding the prefix sums, for batches:
+  // stage every update, then finalize() once before the book is read. The
+  // rebuild starts from the first level any staged update touched.
+  void stageSnapshot(const double *bid_price, const double *bid_size,
+                     size_t bid_count, const double *ask_price,
+                     const double *ask_size, size_t ask_count) {
+    bids_.clear();
+    asks_.clear();
+    for (size_t i = 0; i < bid_count; ++i) bids_.append(bid_price[i], bid_size[i]);
+    for (size_t i = 0; i < ask_count; ++i) asks_.append(ask_price[i], ask_size[i]);
+  }
+
+  void stageDelta(const double *bid_price, const double *bid_size,
+                  size_t bid_count, const double *ask_price,
+                  const double *ask_size, size_t ask_count) {
+    for (size_t i = 0; i < bid_count; ++i) bids_.apply(bid_price[i], bid_size[i]);
+    for (size_t i = 0; i < ask_count; ++i) asks_.apply(ask_price[i], ask_size[i]);
+  }
+
+  // Rebuilds the prefix sums after staged updates; cheap when none are
+  void finalize() {
+    bids_.finalize();
+    asks_.finalize();
+  }
+
+  void clear() {
+    bids_.clear();
+    asks_.clear();
+  }
+
+  // First level either side's last finalize() found changed; CAPACITY when
+  // neither had. Readers of the best n levels only need to look again when
+  // it is below n.
+  size_t changedFrom() const {
+    return std::min(bids_.changedFrom(), asks_.changedFrom());
+  }
+
+  // Copies the best levels per side of a finalized book; unlike assignment
+  // it touches only the occupied levels
+  void copyTop(const BasicOrderBook &other, size_t levels = Capacity) {
+    bids_.copyTop(other.bids_, levels);
+    asks_.copyTop(other.asks_, levels);
+  }
+
+ private:
+
+  Side bids_;
+  Side asks_;
+};
@@ -0,0 +1,536 @@
+#pragma once
+#include "runtime_tuning.h"
+#include "simple_config.h"
+#include "spsc_queue.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <netdb.h>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Asynchronous output for hot paths.
+//
+// Producers format a line into a thread-local buffer (OutputLine) and hand
+// it to OutputSink::write(), which copies it into that thread's own SPSC
+// ring of fixed-size records and returns. A background writer drains the
+// rings and issues one write() per batch to stdout, a file or a TCP
+// socket, so terminal and pipe latency never reach the tick callback.
+// A line is never split between writers: all of its records are reserved
+// up front and drained together. A thread's ring is closed when the thread
+// exits and freed by the writer once drained, so short-lived workers do
+// not leave rings behind.
+//
+// Lines carry a level; lines above the configured verbosity are skipped
+// before formatting, and INFO/DEBUG lines are rate limited per producing
+// thread (ERROR lines never are). Until configure() is called the sink
+// runs with the defaults: stdout, INFO, no rate limit.
+
+enum class OutputLevel : uint8_t { ERROR = 0, INFO = 1, DEBUG = 2 };
+
+class OutputSink {
+ public:
+  struct Options {
+    // "stdout", "stderr", "file:<path>" (appended) or "tcp:<host>:<port>"
+    std::string target = "stdout";
+    OutputLevel verbosity = OutputLevel::INFO;
+    double max_lines_per_second = 0.0; // per producing thread, 0 = unlimited
+    size_t queue_records = 8192;       // per producing thread
+    bool block_when_full = false;      // false: drop and count the line
+
+    // output_target, output_verbosity (error/info/debug),
+    // output_rate_limit, output_queue_records, output_overflow (drop/block)
+    static Options fromConfig(const SimpleConfig &cfg) {
+      Options o;
+      o.target = cfg.getString("output_target", o.target);
+      std::string verbosity = cfg.getString("output_verbosity", "info");
+      o.verbosity = verbosity == "error"   ? OutputLevel::ERROR
+                    : verbosity == "debug" ? OutputLevel::DEBUG
+                                           : OutputLevel::INFO;
+      o.max_lines_per_second = cfg.getDouble("output_rate_limit", 0.0);
+      o.queue_records = static_cast<size_t>(
+          std::max(16L, cfg.getLong("output_queue_records", 8192)));
+      o.block_when_full = cfg.getString("output_overflow", "drop") == "block";
+      return o;
+    }
+  };
+
+  struct Stats {
+    uint64_t lines = 0;
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;      // ring full
+    uint64_t rate_limited = 0; // over max_lines_per_second
+    uint64_t writes = 0;       // write() calls issued by the writer
+  };
+
+  static OutputSink &instance() {
+    static OutputSink sink;
+    return sink;
+  }
+
+  ~OutputSink() { stop(); }
+
+  // Drains and restarts the writer with new options. Throws
+  // std::runtime_error if the target cannot be opened.
+  void configure(const Options &options) {
+    int fd = openTarget(options.target);
+    std::lock_guard<std::mutex> lock(control_);
+    stopWriter();
+    closeTarget();
+    fd_ = fd;
+    owns_fd_ = fd > STDERR_FILENO;
+    verbosity_.store(options.verbosity, std::memory_order_relaxed);
+    max_lines_per_second_.store(options.max_lines_per_second,
+                                std::memory_order_relaxed);
+    block_when_full_.store(options.block_when_full, std::memory_order_relaxed);
+    queue_records_.store(options.queue_records, std::memory_order_relaxed);
+    startWriter();
+  }
+
+  bool enabled(OutputLevel level) const {
+    return level <= verbosity_.load(std::memory_order_relaxed);
+  }
+
+  // Rate limit check for one INFO/DEBUG line on the calling thread, so a
+  // producer can skip formatting a line that would be discarded anyway.
+  bool admit(OutputLevel level) {
+    if (!enabled(level)) return false;
+    if (level == OutputLevel::ERROR) return true;
+    double rate = max_lines_per_second_.load(std::memory_order_relaxed);
+    if (rate <= 0.0) return true;
+    Producer &p = producer();
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count();
+    // Token bucket holding up to one second of lines
+    p.tokens = std::min(rate, p.tokens + (now - p.refill_ns) * 1e-9 * rate);
+    p.refill_ns = now;
+    if (p.tokens < 1.0) {
+      bump(p.rate_limited);
+      return false;
+    }
+    p.tokens -= 1.0;
+    return true;
+  }
+
+  // Queues text (normally ending in '\n') for the writer. Returns false if
+  // the line was dropped because this thread's ring is full.
+  bool write(std::string_view text) {
+    if (text.empty()) return true;
+    Producer &p = producer();
+    size_t records = (text.size() + Record::CAPACITY - 1) / Record::CAPACITY;
+    // Reserve the whole line so it is never split or partially dropped
+    while (p.queue.capacity() - p.queue.depth() < records) {
+      if (!block_when_full_.load(std::memory_order_relaxed) ||
+          records > p.queue.capacity()) {
+        bump(p.dropped);
+        return false;
+      }
+      std::this_thread::yield();
+    }
+    for (size_t r = 0; r < records; ++r) {
+      Record *slot = p.queue.claim();
+      size_t offset = r * Record::CAPACITY;
+      size_t n = std::min(Record::CAPACITY, text.size() - offset);
+      std::memcpy(slot->text, text.data() + offset, n);
+      slot->length = static_cast<uint16_t>(n);
+      slot->more = r + 1 < records;
+      p.queue.publish();
+    }
+    return true;
+  }
+
+  // Blocks until everything queued so far has been written.
+  void flush() {
+    uint64_t target = requested_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    while (completed_.load(std::memory_order_acquire) < target &&
+           writer_.joinable()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+  Stats stats() const {
+    Stats s;
+    s.lines = lines_.load(std::memory_order_relaxed);
+    s.bytes = bytes_.load(std::memory_order_relaxed);
+    s.writes = writes_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(producers_mutex_);
+    s.dropped = retired_dropped_;
+    s.rate_limited = retired_rate_limited_;
+    for (const auto &p : producers_) {
+      s.dropped += p->dropped.load(std::memory_order_relaxed);
+      s.rate_limited += p->rate_limited.load(std::memory_order_relaxed);
+    }
+    return s;
+  }
+
+  // Drains the rings and stops the writer; later writes queue until the
+  // next configure().
+  void stop() {
+    std::lock_guard<std::mutex> lock(control_);
+    stopWriter();
+    closeTarget();
+  }
+
+ private:
+  struct Record {
+    static constexpr size_t CAPACITY = 252;
+    uint16_t length;
+    bool more; // the line continues in the next record
+    char text[CAPACITY];
+  };
+
+  using RecordQueue = SpscQueue<Record>;
+
+  struct Producer {
+    explicit Producer(size_t capacity) : queue(capacity) {}
+
+    RecordQueue queue;
+    double tokens = 0.0;
+    int64_t refill_ns = 0;
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> rate_limited{0};
+    std::atomic<bool> closed{false}; // the owning thread has exited
+    bool drained = false;            // closed and emptied; writer only
+  };
+
+  // A thread's ring; closes it when the thread exits
+  struct ProducerHandle {
+    Producer *producer = nullptr;
+    const OutputSink *owner = nullptr;
+
+    ~ProducerHandle() {
+      if (producer) producer->closed.store(true, std::memory_order_release);
+    }
+  };
+
+  static constexpr size_t WRITE_BATCH = 64 * 1024;
+
+  OutputSink() { startWriter(); }
+
+  // Single-writer counter
+  static void bump(std::atomic<uint64_t> &counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+  }
+
+  // The calling thread's ring, created on its first line
+  Producer &producer() {
+    thread_local ProducerHandle mine;
+    if (!mine.producer || mine.owner != this) {
+      auto p = std::make_unique<Producer>(
+          queue_records_.load(std::memory_order_relaxed));
+      mine.producer = p.get();
+      mine.owner = this;
+      std::lock_guard<std::mutex> lock(producers_mutex_);
+      producers_.push_back(std::move(p));
+      producer_count_.store(producers_.size(), std::memory_order_release);
+    }
+    return *mine.producer;
+  }
+
+  static int openTarget(const std::string &target) {
+    if (target.empty() || target == "stdout") return STDOUT_FILENO;
+    if (target == "stderr") return STDERR_FILENO;
+    if (target.rfind("file:", 0) == 0) {
+      std::string path = target.substr(5);
+      int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+      if (fd < 0) {
+        throw std::runtime_error("Cannot open output file: " + path + ": " +
+                                 std::strerror(errno));
+      }
+      return fd;
+    }
+    if (target.rfind("tcp:", 0) == 0) {
+      std::string address = target.substr(4);
+      auto colon = address.rfind(':');
+      if (colon == std::string::npos) {
+        throw std::runtime_error("Output target needs tcp:<host>:<port>: " +
+                                 target);
+      }
+      std::string host = address.substr(0, colon);
+      std::string port = address.substr(colon + 1);
+      addrinfo hints{};
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      addrinfo *result = nullptr;
+      if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0) {
+        throw std::runtime_error("Cannot resolve output host: " + host);
+      }
+      int fd = -1;
+      for (addrinfo *ai = result; ai && fd < 0; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd >= 0 && ::connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+          ::close(fd);
+          fd = -1;
+        }
+      }
+      ::freeaddrinfo(result);
+      if (fd < 0) {
+        throw std::runtime_error("Cannot connect output socket: " + address);
+      }
+      return fd;
+    }
+    throw std::runtime_error("Unknown output target: " + target);
+  }
+
+  void closeTarget() {
+    if (owns_fd_) ::close(fd_);
+    fd_ = STDOUT_FILENO;
+    owns_fd_ = false;
+  }
+
+  void startWriter() {
+    running_.store(true, std::memory_order_release);
+    writer_ = std::thread([this] { writerLoop(); });
+  }
+
+  void stopWriter() {
+    running_.store(false, std::memory_order_release);
+    if (writer_.joinable()) writer_.join();
+  }
+
+  void writerLoop() {
+    RuntimeTuning::instance().pinThisThread(RuntimeTuning::Role::BACKGROUND);
+    std::string batch;
+    batch.reserve(WRITE_BATCH);
+    bool stopping = false;
+    auto next_report = std::chrono::steady_clock::now();
+    while (true) {
+      uint64_t requested = requested_.load(std::memory_order_acquire);
+      bool idle = drainAll(batch) == 0;
+      // Say once a second how many lines the limits swallowed
+      auto now = std::chrono::steady_clock::now();
+      if (now >= next_report || stopping) {
+        next_report = now + std::chrono::seconds(1);
+        uint64_t total = suppressed();
+        if (total > reported_) {
+          batch += "[output] " + std::to_string(total - reported_) +
+                   " lines suppressed (rate limit or full queue)\n";
+          reported_ = total;
+        }
+      }
+      writeOut(batch);
+      if (requested > completed_.load(std::memory_order_relaxed)) {
+        completed_.store(requested, std::memory_order_release);
+      }
+      if (stopping) break;
+      if (!running_.load(std::memory_order_acquire)) {
+        stopping = true; // one more pass for lines queued meanwhile
+        continue;
+      }
+      if (idle) std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+  }
+
+  uint64_t suppressed() const {
+    Stats s = stats();
+    return s.dropped + s.rate_limited;
+  }
+
+  // Moves every queued line into batch, writing whenever it fills, and
+  // frees the rings of exited threads once drained. Returns the number of
+  // lines moved.
+  size_t drainAll(std::string &batch) {
+    size_t count = producer_count_.load(std::memory_order_acquire);
+    size_t lines = 0;
+    bool any_drained = false;
+    for (size_t i = 0; i < count; ++i) {
+      Producer *p;
+      {
+        std::lock_guard<std::mutex> lock(producers_mutex_);
+        p = producers_[i].get();
+      }
+      // Checked before draining: a ring closed by then gets no more lines,
+      // so it is empty afterwards
+      p->drained = p->closed.load(std::memory_order_acquire);
+      any_drained |= p->drained;
+      bool partial = false;
+      auto append = [&](const Record &r) {
+        batch.append(r.text, r.length);
+        partial = r.more;
+        if (!r.more) ++lines;
+      };
+      while (p->queue.consume(append, 256) > 0 || partial) {
+        // A line's records were reserved together, so the rest of a
+        // partial line is at most one publish away
+        if (batch.size() >= WRITE_BATCH && !partial) writeOut(batch);
+      }
+    }
+    lines_.fetch_add(lines, std::memory_order_relaxed);
+    if (any_drained) releaseDrained();
+    return lines;
+  }
+
+  // Frees drained rings, keeping their counters in the totals. Only the
+  // writer removes rings, so drainAll() can use them outside the lock.
+  void releaseDrained() {
+    std::lock_guard<std::mutex> lock(producers_mutex_);
+    size_t kept = 0;
+    for (auto &p : producers_) {
+      if (p->drained) {
+        retired_dropped_ += p->dropped.load(std::memory_order_relaxed);
+        retired_rate_limited_ += p->rate_limited.load(std::memory_order_relaxed);
+      } else {
+        producers_[kept++] = std::move(p);
+      }
+    }
+    producers_.resize(kept);
+    producer_count_.store(kept, std::memory_order_release);
+  }
+
+  void writeOut(std::string &batch) {
+    size_t done = 0;
+    while (done < batch.size()) {
+      ssize_t n = ::write(fd_, batch.data() + done, batch.size() - done);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        break; // target gone: discard rather than stall the producers
+      }
+      done += static_cast<size_t>(n);
+    }
+    if (!batch.empty()) {
+      bytes_.fetch_add(done, std::memory_order_relaxed);
+      writes_.fetch_add(1, std::memory_order_relaxed);
+    }
+    batch.clear();
+  }
+
+  std::mutex control_;
+  int fd_ = STDOUT_FILENO;
+  bool owns_fd_ = false;
+  std::atomic<OutputLevel> verbosity_{OutputLevel::INFO};
+  std::atomic<double> max_lines_per_second_{0.0};
+  std::atomic<bool> block_when_full_{false};
+  std::atomic<size_t> queue_records_{8192};
+
+  mutable std::mutex producers_mutex_;
+  std::vector<std::unique_ptr<Producer>> producers_;
+  std::atomic<size_t> producer_count_{0};
+  uint64_t retired_dropped_ = 0; // counters of freed rings
+  uint64_t retired_rate_limited_ = 0;
+
+  std::atomic<uint64_t> requested_{0};
+  std::atomic<uint64_t> completed_{0};
+  std::atomic<uint64_t> lines_{0};
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<uint64_t> writes_{0};
+  uint64_t reported_ = 0; // suppressed lines already reported; writer only
+  std::atomic<bool> running_{false};
+  std::thread writer_;
+};
+
+// Streams count copies of c without building a std::string, e.g. the
+// rules between report sections: out << Repeat{'=', 80}
+struct Repeat {
+  char c;
+  size_t count;
+};
+
+inline std::ostream &operator<<(std::ostream &out, const Repeat &r) {
+  for (size_t i = 0; i < r.count; ++i) out.put(r.c);
+  return out;
+}
+
+// One line (or block) of formatted output: an ostream over a reusable
+// thread-local buffer, submitted to the sink when the OutputLine goes out
+// of scope. Formatting state persists per thread, like std::cout's. When
+// the level is filtered or rate limited nothing is formatted.
+//
+//   OutputLine line;
+//   line << "Trade #" << n << " | Price: $" << price << "\n";
+class OutputLine {
+ public:
+  explicit OutputLine(OutputLevel level = OutputLevel::INFO)
+      : state_(threadState()),
+        active_(!state_.busy && OutputSink::instance().admit(level)) {
+    if (active_) {
+      state_.busy = true;
+      state_.buffer.clear();
+    }
+  }
+
+  ~OutputLine() {
+    if (!active_) return;
+    OutputSink::instance().write(state_.buffer.text());
+    state_.busy = false;
+  }
+
+  OutputLine(const OutputLine &) = delete;
+  OutputLine &operator=(const OutputLine &) = delete;
+
+  bool active() const { return active_; }
+
+  // The underlying stream, for code that takes an std::ostream&
+  std::ostream &stream() { return active_ ? state_.stream : nullStream(); }
+
+  template <typename T>
+  OutputLine &operator<<(const T &value) {
+    if (active_) state_.stream << value;
+    return *this;
+  }
+
+  // Manipulators such as std::endl, std::fixed and std::left
+  OutputLine &operator<<(std::ostream &(*manipulator)(std::ostream &)) {
+    if (active_) state_.stream << manipulator;
+    return *this;
+  }
+  OutputLine &operator<<(std::ios_base &(*manipulator)(std::ios_base &)) {
+    if (active_) state_.stream << manipulator;
+    return *this;
+  }
+
+ private:
+  // Appends into a string that keeps its capacity between lines
+  class LineBuffer : public std::streambuf {
+   public:
+    LineBuffer() { text_.reserve(1024); }
+    void clear() { text_.clear(); }
+    std::string_view text() const { return text_; }
+
+   protected:
+    int_type overflow(int_type ch) override {
+      if (ch != traits_type::eof()) text_.push_back(static_cast<char>(ch));
+      return ch;
+    }
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+      text_.append(s, static_cast<size_t>(n));
+      return n;
+    }
+
+   private:
+    std::string text_;
+  };
+
+  struct ThreadState {
+    LineBuffer buffer;
+    std::ostream stream{&buffer};
+    bool busy = false; // a nested OutputLine on this thread is dropped
+  };
+
+  static ThreadState &threadState() {
+    thread_local ThreadState state;
+    return state;
+  }
+
+  static std::ostream &nullStream() {
+    thread_local std::ostream null(nullptr);
+    return null;
+  }
+
+  ThreadState &state_;
+  bool active_;
+};
@@ -0,0 +1,146 @@
+#pragma once
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Parameter sweeps over data decoded once.
+//
+// ParameterGrid is the cartesian product of named value axes. A sweep cuts
+// the decoded events into immutable batches and runs one independent
+// instance per grid point over them on a WorkStealingPool. Each task takes
+// a group of instances through the batches together, so a batch is read
+// from memory once per group while it is hot in cache, instead of once per
+// instance.
+
+class ParameterGrid {
+ public:
+  // Appends an axis; the last axis added varies fastest
+  void addAxis(std::string name, std::vector<double> values) {
+    if (values.empty()) {
+      throw std::invalid_argument("Sweep axis " + name + " has no values");
+    }
+    axes_.push_back({std::move(name), std::move(values)});
+  }
+
+  size_t axisCount() const { return axes_.size(); }
+  const std::string &axisName(size_t axis) const { return axes_[axis].name; }
+
+  // Number of points, 1 for a grid without axes
+  size_t size() const {
+    size_t n = 1;
+    for (const auto &axis : axes_) n *= axis.values.size();
+    return n;
+  }
+
+  // Value of axis at point, in mixed radix order
+  double value(size_t point, size_t axis) const {
+    for (size_t a = axes_.size(); a-- > axis + 1;) point /= axes_[a].values.size();
+    return axes_[axis].values[point % axes_[axis].values.size()];
+  }
+
+  // Values from config entries, each a number or an inclusive
+  // "first:last:step" range. Throws std::invalid_argument on bad entries.
+  static std::vector<double> parseValues(const std::vector<std::string> &entries) {
+    std::vector<double> values;
+    for (const auto &entry : entries) {
+      auto first_colon = entry.find(':');
+      if (first_colon == std::string::npos) {
+        values.push_back(number(entry));
+        continue;
+      }
+      auto second_colon = entry.find(':', first_colon + 1);
+      if (second_colon == std::string::npos) {
+        throw std::invalid_argument("Expected first:last:step, got " + entry);
+      }
+      double first = number(entry.substr(0, first_colon));
+      double last = number(entry.substr(first_colon + 1,
+                                        second_colon - first_colon - 1));
+      double step = number(entry.substr(second_colon + 1));
+      if (!(step > 0) || last < first) {
+        throw std::invalid_argument("Empty or unbounded range " + entry);
+      }
+      // Counted steps, so rounding cannot add or lose the last value
+      auto steps = static_cast<size_t>(std::floor((last - first) / step + 1e-9));
+      for (size_t i = 0; i <= steps; ++i) values.push_back(first + i * step);
+    }
+    return values;
+  }
+
+ private:
+  struct Axis {
+    std::string name;
+    std::vector<double> values;
+  };
+
+  static double number(const std::string &text) {
+    size_t used = 0;
+    double value = 0.0;
+    try {
+      value = std::stod(text, &used);
+    } catch (const std::exception &) {
+      used = 0;
+    }
+    if (used == 0 || used != text.size()) {
+      throw std::invalid_argument("Not a number: " + text);
+    }
+    return value;
+  }
+
+  std::vector<Axis> axes_;
+};
+
+// Decoded events cut into fixed-size batches that sweeps share read-only
+template <typename Event>
+class EventBatches {
+ public:
+  explicit EventBatches(size_t batch_size = 4096)
+      : batch_size_(std::max<size_t>(1, batch_size)) {}
+
+  void push(const Event &event) {
+    if (batches_.empty() || batches_.back().size() == batch_size_) {
+      batches_.emplace_back();
+      batches_.back().reserve(batch_size_);
+    }
+    batches_.back().push_back(event);
+    ++size_;
+  }
+
+  size_t size() const { return size_; }
+  const std::vector<std::vector<Event>> &batches() const { return batches_; }
+
+ private:
+  size_t batch_size_;
+  size_t size_ = 0;
+  std::vector<std::vector<Event>> batches_;
+};
+
+// Runs instances 0..count-1, each obtained from make(index) as a pointer
+// (raw or owning), over every event of batches in order through
+// apply(instance, event), then hands it to finish(index, instance). make
+// and finish run on pool threads and must only touch slot index.
+// Instances share nothing but the batches.
+template <typename Event, typename Make, typename Apply, typename Finish>
+void runSweep(WorkStealingPool &pool, const EventBatches<Event> &batches,
+              size_t count, size_t group_size, Make make, Apply apply,
+              Finish finish) {
+  group_size = std::max<size_t>(1, group_size);
+  size_t groups = (count + group_size - 1) / group_size;
+  pool.run(groups, [&](size_t group, size_t) {
+    size_t begin = group * group_size;
+    size_t end = std::min(count, begin + group_size);
+    std::vector<decltype(make(begin))> instances;
+    instances.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i) instances.push_back(make(i));
+    for (const auto &batch : batches.batches()) {
+      for (auto &instance : instances) {
+        for (const Event &event : batch) apply(*instance, event);
+      }
+    }
+    for (size_t i = begin; i < end; ++i) finish(i, *instances[i - begin]);
+  });
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "liquidity_record.h"
+#include "shm_metrics.h"
+#include <cstdint>
+#include <type_traits>
+
+// Payloads the programs publish through shm_metrics.h segments, for risk
+// and execution processes on the same host:
+//
+//   liquidity_analyzer  liq_shm_name     one LiquidityRecord per symbol
+//   arbitrage           arb_shm_name     one ArbitrageSnapshot per
+//                                        "venue:symbol"
+//   trades              trades_shm_name  one TradeSnapshot per
+//                                        "exchange:symbol"
+//
+//   ShmMetricsReader<TradeSnapshot> trades("/trades",
+//                                          ShmMetricsFormat::Tag::TRADES);
+//   TradeSnapshot t;
+//   if (trades.read(trades.find("binance:BTCUSDT"), t)) ...
+
+// One venue's top of book for a symbol and the best cross against it, as
+// of that venue's last update.
+struct ArbitrageSnapshot {
+  int64_t time_ns;     // receive time of the newest quote in the row
+  int64_t max_age_ns;  // age of the stalest quote in the row
+  double bid;
+  double ask;
+  double bid_size;
+  double ask_size;
+  // Best cross involving this venue; slots index the same segment, and
+  // are -1 until a second venue quotes the symbol
+  int32_t buy_slot;
+  int32_t sell_slot;
+  double spread;       // sell bid - buy ask at the top of book
+  double quantity;     // profit-maximizing size after taker fees, or 0
+  double buy_vwap;
+  double sell_vwap;
+  double profit;       // net of taker fees over quantity
+};
+static_assert(std::is_trivially_copyable<ArbitrageSnapshot>::value,
+              "ArbitrageSnapshot must stay POD");
+static_assert(sizeof(ArbitrageSnapshot) == 96, "ArbitrageSnapshot layout");
+
+// Latest trade of an instrument with the detector state it was judged by.
+struct TradeSnapshot {
+  int64_t time_ns;
+  uint64_t trade_count;
+  double price;
+  double quantity;
+  double ewma_volatility;
+  double large_trade_threshold;    // size above which a trade is flagged
+  double price_movement_threshold; // price move above which it is flagged
+  uint8_t price_anomaly;
+  uint8_t size_anomaly;
+  uint8_t volatility_anomaly;
+  uint8_t reserved[5];
+};
+static_assert(std::is_trivially_copyable<TradeSnapshot>::value,
+              "TradeSnapshot must stay POD");
+static_assert(sizeof(TradeSnapshot) == 64, "TradeSnapshot layout");
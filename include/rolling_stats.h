@@ -0,0 +1,311 @@
+#pragma once
+#include "huge_pages.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <optional>
+#include <set>
+#include <vector>
+
+// Allocator for node-based containers that recycles freed nodes through a
+// per-thread free list, so a sliding window stops touching the heap once it
+// has filled: every erase hands its node to the next insert. Requests for
+// more than one object go straight to operator new.
+template <typename T>
+class NodePoolAllocator {
+ public:
+  using value_type = T;
+
+  NodePoolAllocator() = default;
+  template <typename U>
+  NodePoolAllocator(const NodePoolAllocator<U> &) {}
+
+  T *allocate(size_t n) {
+    if (n == 1) {
+      FreeList &list = freeList();
+      if (list.head) {
+        Node *node = list.head;
+        list.head = node->next;
+        return reinterpret_cast<T *>(node);
+      }
+    }
+    return static_cast<T *>(::operator new(n * sizeof(Slot)));
+  }
+
+  void deallocate(T *p, size_t n) {
+    if (n != 1) {
+      ::operator delete(p);
+      return;
+    }
+    FreeList &list = freeList();
+    Node *node = reinterpret_cast<Node *>(p);
+    node->next = list.head;
+    list.head = node;
+  }
+
+  template <typename U>
+  bool operator==(const NodePoolAllocator<U> &) const { return true; }
+  template <typename U>
+  bool operator!=(const NodePoolAllocator<U> &) const { return false; }
+
+ private:
+  struct Node {
+    Node *next;
+  };
+  union Slot {
+    Node node;
+    alignas(T) unsigned char value[sizeof(T)];
+  };
+  struct FreeList {
+    Node *head = nullptr;
+    ~FreeList() {
+      while (head) {
+        Node *next = head->next;
+        ::operator delete(head);
+        head = next;
+      }
+    }
+  };
+
+  static FreeList &freeList() {
+    thread_local FreeList list;
+    return list;
+  }
+};
+
+using PooledMultiset =
+    std::multiset<double, std::less<double>, NodePoolAllocator<double>>;
+
+// Fixed-capacity ring buffer. Once full, each push overwrites the oldest
+// element. Index 0 is the oldest element, size() - 1 the newest.
+template <typename T>
+class RingBuffer {
+ public:
+  explicit RingBuffer(size_t capacity) : buf_(std::max<size_t>(1, capacity)) {}
+
+  size_t capacity() const { return buf_.size(); }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  bool full() const { return size_ == buf_.size(); }
+
+  // Appends value. Returns the evicted element when the buffer was full.
+  std::optional<T> push(const T &value) {
+    std::optional<T> evicted;
+    if (full()) {
+      evicted = buf_[head_];
+      buf_[head_] = value;
+      head_ = next(head_);
+    } else {
+      buf_[wrap(head_ + size_)] = value;
+      ++size_;
+    }
+    return evicted;
+  }
+
+  // Removes and returns the oldest element. The buffer must not be empty.
+  T pop_front() {
+    T value = buf_[head_];
+    head_ = next(head_);
+    --size_;
+    return value;
+  }
+
+  const T &operator[](size_t i) const { return buf_[wrap(head_ + i)]; }
+  const T &front() const { return buf_[head_]; }
+  const T &back() const { return buf_[wrap(head_ + size_ - 1)]; }
+
+  void clear() {
+    head_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  size_t wrap(size_t i) const { return i >= buf_.size() ? i - buf_.size() : i; }
+  size_t next(size_t i) const { return wrap(i + 1); }
+
+  std::vector<T, HugePageAllocator<T>> buf_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+};
+
+// Mean and sample variance over the last `capacity` samples using running
+// sums. The sums are rebuilt from the window once per `capacity` evictions so
+// floating point drift stays bounded at amortized O(1) cost.
+class RollingMoments {
+ public:
+  explicit RollingMoments(size_t capacity) : window_(capacity) {}
+
+  // Adds x and returns the sample that fell out of the window, if any.
+  std::optional<double> push(double x) {
+    auto evicted = window_.push(x);
+    sum_ += x;
+    sum_sq_ += x * x;
+    if (evicted) {
+      sum_ -= *evicted;
+      sum_sq_ -= *evicted * *evicted;
+      if (++evictions_ >= window_.capacity()) resync();
+    }
+    return evicted;
+  }
+
+  size_t count() const { return window_.size(); }
+  size_t capacity() const { return window_.capacity(); }
+  const RingBuffer<double> &window() const { return window_; }
+
+  double mean() const { return count() ? sum_ / count() : 0.0; }
+
+  // Sample variance (n - 1 denominator), clamped at zero.
+  double variance() const {
+    size_t n = count();
+    if (n < 2) return 0.0;
+    double var = (sum_sq_ - sum_ * sum_ / n) / static_cast<double>(n - 1);
+    return var > 0.0 ? var : 0.0;
+  }
+
+  void clear() {
+    window_.clear();
+    sum_ = sum_sq_ = 0.0;
+    evictions_ = 0;
+  }
+
+ private:
+  void resync() {
+    sum_ = sum_sq_ = 0.0;
+    for (size_t i = 0; i < window_.size(); ++i) {
+      sum_ += window_[i];
+      sum_sq_ += window_[i] * window_[i];
+    }
+    evictions_ = 0;
+  }
+
+  RingBuffer<double> window_;
+  double sum_ = 0.0;
+  double sum_sq_ = 0.0;
+  size_t evictions_ = 0;
+};
+
+// Lower-tail order statistic over a sliding multiset of samples.
+// Keeps the k = ceil(n * fraction) smallest samples (clamped to n - 1) in
+// `tail_` with their running sum, the rest in `body_`. quantile() is then the
+// (k)th order statistic (0-based) and tailMean() the mean of the k smallest,
+// matching a full sort + index. Insert and erase are O(log n).
+// Rank::FLOOR uses k = floor(n * fraction) instead, i.e. sorted[n * q]
+// truncated as a plain percentile lookup would index it.
+class TailQuantile {
+ public:
+  enum class Rank { CEIL, FLOOR };
+
+  explicit TailQuantile(double fraction, Rank rank = Rank::CEIL)
+      : fraction_(fraction), rank_(rank) {}
+
+  void insert(double x) {
+    if (!body_.empty() && x < *body_.begin()) {
+      tail_.insert(x);
+      tail_sum_ += x;
+    } else {
+      body_.insert(x);
+    }
+    rebalance();
+  }
+
+  // Removes one sample equal to x. The sample must have been inserted.
+  void erase(double x) {
+    auto it = tail_.find(x);
+    if (it != tail_.end()) {
+      tail_.erase(it);
+      tail_sum_ -= x;
+    } else {
+      it = body_.find(x);
+      if (it != body_.end()) body_.erase(it);
+    }
+    rebalance();
+  }
+
+  size_t count() const { return tail_.size() + body_.size(); }
+  size_t tailCount() const { return tail_.size(); }
+
+  double quantile() const { return body_.empty() ? 0.0 : *body_.begin(); }
+
+  std::optional<double> tailMean() const {
+    if (tail_.empty()) return std::nullopt;
+    return tail_sum_ / tail_.size();
+  }
+
+  void clear() {
+    tail_.clear();
+    body_.clear();
+    tail_sum_ = 0.0;
+  }
+
+ private:
+  size_t targetTailSize() const {
+    size_t n = count();
+    if (n == 0) return 0;
+    double position = n * fraction_;
+    size_t k = static_cast<size_t>(rank_ == Rank::CEIL ? std::ceil(position)
+                                                       : position);
+    return std::min(k, n - 1);
+  }
+
+  void rebalance() {
+    size_t k = targetTailSize();
+    while (tail_.size() > k) {
+      auto it = std::prev(tail_.end());
+      tail_sum_ -= *it;
+      body_.insert(*it);
+      tail_.erase(it);
+    }
+    while (tail_.size() < k && !body_.empty()) {
+      auto it = body_.begin();
+      tail_sum_ += *it;
+      tail_.insert(*it);
+      body_.erase(it);
+    }
+    if (tail_.empty()) tail_sum_ = 0.0;
+  }
+
+  double fraction_;
+  Rank rank_;
+  PooledMultiset tail_;
+  PooledMultiset body_;
+  double tail_sum_ = 0.0;
+};
+
+// Incremental return statistics backing LiquidityAnalyzer's risk metrics:
+// full-window mean/variance, a short window for historical volatility and
+// lower-tail VaR/ES. Every add() is O(log n); every read is O(1).
+class RollingReturnStats {
+ public:
+  RollingReturnStats(size_t capacity, size_t short_window,
+                     double tail_fraction = 0.05)
+      : all_(capacity), recent_(short_window), tail_(tail_fraction) {}
+
+  void add(double r) {
+    recent_.push(r);
+    tail_.insert(r);
+    if (auto evicted = all_.push(r)) tail_.erase(*evicted);
+  }
+
+  size_t count() const { return all_.count(); }
+  double mean() const { return all_.mean(); }
+  double variance() const { return all_.variance(); }
+
+  size_t shortWindowCount() const { return recent_.count(); }
+  double shortWindowVariance() const { return recent_.variance(); }
+
+  double valueAtRisk() const { return tail_.quantile(); }
+  std::optional<double> expectedShortfall() const { return tail_.tailMean(); }
+
+  void clear() {
+    all_.clear();
+    recent_.clear();
+    tail_.clear();
+  }
+
+ private:
+  RollingMoments all_;
+  RollingMoments recent_;
+  TailQuantile tail_;
+};
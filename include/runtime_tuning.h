@@ -0,0 +1,242 @@
+#pragma once
+#include "huge_pages.h"
+#include "simple_config.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Low-latency runtime mode for hosts with isolated cores.
+//
+// Threads pin themselves by role when they start: the ccapi callback
+// thread on its first event (it is not ours to create), the analyzer
+// threads that drain the ingest queues, and the background threads
+// (report, output writer, config and latency reporters). IO and analyzer
+// threads take one CPU each from their role's list in start order;
+// background threads share their whole list.
+//
+// Busy polling keeps the analyzer threads spinning on empty queues instead
+// of sleeping. Locking memory pins every current and future page
+// (mlockall), so buffers allocated after configure() are faulted in when
+// they are created rather than on the hot path, and cannot be paged out.
+// Huge pages back the ingest rings and trade histories (huge_pages.h).
+//
+// Configure before any of these threads or buffers are created.
+struct RuntimeOptions {
+  bool busy_poll = false;
+  bool lock_memory = false;
+  bool huge_pages = false;
+  std::vector<int> io_cpus;
+  std::vector<int> analyzer_cpus;
+  std::vector<int> background_cpus;
+
+  bool any() const {
+    return busy_poll || lock_memory || huge_pages || !io_cpus.empty() ||
+           !analyzer_cpus.empty() || !background_cpus.empty();
+  }
+
+  // runtime_mode (default/low_latency, which turns on runtime_busy_poll
+  // and runtime_lock_memory), runtime_busy_poll, runtime_lock_memory,
+  // runtime_huge_pages (0/1), runtime_cpus_io, runtime_cpus_analyzer,
+  // runtime_cpus_background (CPU lists). Throws std::invalid_argument on
+  // an unknown mode or a malformed CPU.
+  static RuntimeOptions fromConfig(const SimpleConfig &cfg) {
+    RuntimeOptions o;
+    std::string mode = cfg.getString("runtime_mode", "default");
+    if (mode != "default" && mode != "low_latency") {
+      throw std::invalid_argument("Unknown runtime_mode: " + mode);
+    }
+    int low_latency = mode == "low_latency" ? 1 : 0;
+    o.busy_poll = cfg.getInt("runtime_busy_poll", low_latency) != 0;
+    o.lock_memory = cfg.getInt("runtime_lock_memory", low_latency) != 0;
+    o.huge_pages = cfg.getInt("runtime_huge_pages", 0) != 0;
+    o.io_cpus = cpuList(cfg, "runtime_cpus_io");
+    o.analyzer_cpus = cpuList(cfg, "runtime_cpus_analyzer");
+    o.background_cpus = cpuList(cfg, "runtime_cpus_background");
+    return o;
+  }
+
+ private:
+  static std::vector<int> cpuList(const SimpleConfig &cfg, const std::string &key) {
+    std::vector<int> cpus;
+    for (const auto &entry : cfg.getStringList(key)) {
+      size_t end = 0;
+      int cpu = -1;
+      try {
+        cpu = std::stoi(entry, &end);
+      } catch (const std::exception &) {
+        end = 0;
+      }
+      if (end != entry.size() || cpu < 0) {
+        throw std::invalid_argument(key + ": not a CPU number: " + entry);
+      }
+      cpus.push_back(cpu);
+    }
+    return cpus;
+  }
+};
+
+class RuntimeTuning {
+ public:
+  enum class Role : uint8_t {
+    IO,       // delivers ccapi events
+    ANALYZER, // drains an ingest queue
+    BACKGROUND
+  };
+
+  static constexpr size_t STACK_PREFAULT_BYTES = 256 * 1024;
+
+  static RuntimeTuning &instance() {
+    static RuntimeTuning tuning;
+    return tuning;
+  }
+
+  // Applies the memory settings and records the CPU lists. What the
+  // process is not allowed to do (e.g. mlockall over RLIMIT_MEMLOCK) is
+  // reported on stderr and skipped.
+  void configure(const RuntimeOptions &options) {
+    options_ = options;
+    busy_poll_.store(options.busy_poll, std::memory_order_relaxed);
+    HugePages::setEnabled(options.huge_pages);
+    if (options.lock_memory) {
+      if (::mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+        prefaultStack();
+      } else {
+        std::cerr << "runtime_lock_memory: mlockall failed: "
+                  << std::strerror(errno)
+                  << " (needs CAP_IPC_LOCK or a larger RLIMIT_MEMLOCK)"
+                  << std::endl;
+        options_.lock_memory = false;
+      }
+    }
+    if (options_.any()) std::cout << "Runtime: " << describe() << std::endl;
+  }
+
+  const RuntimeOptions &options() const { return options_; }
+
+  bool busyPoll() const { return busy_poll_.load(std::memory_order_relaxed); }
+
+  // Pins the calling thread for role and pre-faults its stack when memory
+  // is locked. Returns the CPU it was pinned to (the first of the set for
+  // background threads), or -1 if role has no CPUs or pinning failed.
+  int pinThisThread(Role role) {
+    if (options_.lock_memory) prefaultStack();
+    std::vector<int> cpus;
+    switch (role) {
+    case Role::IO:
+      cpus = nextOf(options_.io_cpus, next_io_);
+      break;
+    case Role::ANALYZER:
+      cpus = nextOf(options_.analyzer_cpus, next_analyzer_);
+      break;
+    case Role::BACKGROUND:
+      cpus = options_.background_cpus;
+      break;
+    }
+    if (cpus.empty() || !pin(cpus)) return -1;
+    return cpus.front();
+  }
+
+  // pinThisThread(Role::IO) on the first call from each thread, for
+  // callbacks on threads owned by the ccapi session
+  void pinCallbackThread() {
+    thread_local bool pinned = false;
+    if (pinned) return;
+    pinned = true;
+    pinThisThread(Role::IO);
+  }
+
+  // What a polling loop does when its queue is empty: spin with a CPU
+  // pause when busy polling, otherwise sleep for interval
+  void idle(std::chrono::microseconds interval) const {
+    if (busyPoll()) {
+      cpuRelax();
+    } else {
+      std::this_thread::sleep_for(interval);
+    }
+  }
+
+  static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+
+ private:
+  RuntimeTuning() = default;
+
+  static std::vector<int> nextOf(const std::vector<int> &cpus,
+                                 std::atomic<size_t> &next) {
+    if (cpus.empty()) return {};
+    return {cpus[next.fetch_add(1, std::memory_order_relaxed) % cpus.size()]};
+  }
+
+  static bool pin(const std::vector<int> &cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+      if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc == 0) return true;
+    std::cerr << "runtime_cpus: cannot pin thread to CPU " << cpus.front()
+              << (cpus.size() > 1 ? " and others" : "") << ": "
+              << std::strerror(rc) << std::endl;
+    return false;
+#else
+    std::cerr << "runtime_cpus: thread pinning is not supported here"
+              << std::endl;
+    return false;
+#endif
+  }
+
+  // Touches the calling thread's stack below this frame so deeper calls on
+  // the hot path do not fault
+  static void prefaultStack() {
+    volatile unsigned char stack[STACK_PREFAULT_BYTES];
+    for (size_t i = 0; i < sizeof(stack); i += 4096) stack[i] = 0;
+  }
+
+  static std::string cpuText(const std::vector<int> &cpus) {
+    std::ostringstream out;
+    for (size_t i = 0; i < cpus.size(); ++i) out << (i ? "," : "") << cpus[i];
+    return out.str();
+  }
+
+  std::string describe() const {
+    std::ostringstream out;
+    out << (options_.busy_poll ? "busy poll" : "sleeping poll");
+    if (options_.lock_memory) out << ", memory locked";
+    if (options_.huge_pages) out << ", huge pages";
+    if (!options_.io_cpus.empty()) out << ", io cpus " << cpuText(options_.io_cpus);
+    if (!options_.analyzer_cpus.empty()) {
+      out << ", analyzer cpus " << cpuText(options_.analyzer_cpus);
+    }
+    if (!options_.background_cpus.empty()) {
+      out << ", background cpus " << cpuText(options_.background_cpus);
+    }
+    return out.str();
+  }
+
+  RuntimeOptions options_;
+  std::atomic<bool> busy_poll_{false};
+  std::atomic<size_t> next_io_{0};
+  std::atomic<size_t> next_analyzer_{0};
+};
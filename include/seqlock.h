@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+// Seqlock over a trivially copyable payload kept as 8-byte words, shared by
+// LiveValue and the shared-memory metric slots.
+//
+// The writer makes the sequence odd, stores the payload and makes it even
+// again; a reader copies the payload and retries if the sequence was odd or
+// moved meanwhile. Only one thread writes at a time, and readers never make
+// it wait. The payload is copied as 8-byte relaxed atomics, so the torn
+// reads the sequence check discards are not data races.
+namespace Seqlock {
+
+template <typename T>
+constexpr size_t words() {
+  return (sizeof(T) + 7) / 8;
+}
+
+template <typename T>
+void store(std::atomic<uint64_t> &sequence, std::atomic<uint64_t> *words,
+           const T &value) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Seqlock payloads must be trivially copyable");
+  uint64_t buffer[Seqlock::words<T>()] = {};
+  std::memcpy(buffer, &value, sizeof(T));
+  uint64_t seq = sequence.load(std::memory_order_relaxed);
+  sequence.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = 0; i < Seqlock::words<T>(); ++i) {
+    words[i].store(buffer[i], std::memory_order_relaxed);
+  }
+  sequence.store(seq + 2, std::memory_order_release);
+}
+
+// Copies a consistent payload into out and returns the (even) sequence it
+// was stored under: 0 before the first store, then twice the store count
+template <typename T>
+uint64_t load(const std::atomic<uint64_t> &sequence,
+              const std::atomic<uint64_t> *words, T &out) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Seqlock payloads must be trivially copyable");
+  uint64_t buffer[Seqlock::words<T>()];
+  uint64_t before, after;
+  do {
+    before = sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      std::this_thread::yield(); // writer mid-store
+      after = before + 1;
+      continue;
+    }
+    for (size_t i = 0; i < Seqlock::words<T>(); ++i) {
+      buffer[i] = words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = sequence.load(std::memory_order_relaxed);
+  } while (before != after);
+  std::memcpy(&out, buffer, sizeof(T));
+  return before;
+}
+
+} // namespace Seqlock
@@ -0,0 +1,213 @@
+#pragma once
+#include "seqlock.h"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Latest-value metrics published through a POSIX shared-memory segment.
+//
+// A segment holds one slot per symbol (or instrument). Each slot is a
+// seqlock (seqlock.h) laid out in the segment. Readers in other processes
+// map the segment read-only and read the current snapshot with plain
+// loads, no syscalls and no serialization; a publisher never waits for
+// them.
+//
+//   <64-byte header> <slot 0> <slot 1> ...
+//   header: magic "CCSHM01", version, payload tag and size, slot count and
+//           stride
+//   slot:   u64 sequence | char name[56] | payload words, 64-byte aligned
+//
+// A slot has exactly one publishing thread.
+namespace ShmMetricsFormat {
+constexpr char MAGIC[8] = {'C', 'C', 'S', 'H', 'M', '0', '1', '\0'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t NAME_SIZE = 56;
+
+// Payload kinds, so a reader cannot map a segment onto the wrong struct
+enum class Tag : uint32_t { LIQUIDITY = 1, ARBITRAGE = 2, TRADES = 3 };
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t tag;
+  uint32_t payload_size;
+  uint32_t slot_count;
+  uint32_t slot_stride;
+  uint32_t reserved[9];
+};
+static_assert(sizeof(Header) == 64, "Header layout");
+
+constexpr size_t slotStride(size_t payload_size) {
+  return (64 + (payload_size + 7) / 8 * 8 + 63) / 64 * 64;
+}
+
+// "/name", as shm_open wants it
+inline std::string segmentName(const std::string &name) {
+  return name.empty() || name[0] == '/' ? name : "/" + name;
+}
+} // namespace ShmMetricsFormat
+
+template <typename T>
+class ShmMetricsSegment {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Published metrics must be trivially copyable");
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "Seqlock needs lock-free 64-bit atomics across processes");
+
+ public:
+  static constexpr size_t WORDS = Seqlock::words<T>();
+
+  size_t slots() const { return header().slot_count; }
+  std::string_view slotName(size_t i) const { return slotAt(i).name; }
+  const std::string &name() const { return name_; }
+
+  // Index of the slot called name, or slots() if there is none
+  size_t find(std::string_view name) const {
+    for (size_t i = 0; i < slots(); ++i) {
+      if (slotName(i) == name) return i;
+    }
+    return slots();
+  }
+
+ protected:
+  struct Slot {
+    std::atomic<uint64_t> sequence;
+    char name[ShmMetricsFormat::NAME_SIZE];
+    std::atomic<uint64_t> words[WORDS];
+  };
+  static_assert(offsetof(Slot, words) == 64, "Slot layout");
+
+  ShmMetricsSegment() = default;
+  ~ShmMetricsSegment() { unmap(); }
+
+  ShmMetricsSegment(const ShmMetricsSegment &) = delete;
+  ShmMetricsSegment &operator=(const ShmMetricsSegment &) = delete;
+
+  Slot &slotAt(size_t i) const {
+    return *reinterpret_cast<Slot *>(
+        base_ + sizeof(ShmMetricsFormat::Header) + i * header().slot_stride);
+  }
+
+  const ShmMetricsFormat::Header &header() const {
+    return *reinterpret_cast<const ShmMetricsFormat::Header *>(base_);
+  }
+
+  void map(int fd, size_t bytes, int prot) {
+    void *base = ::mmap(nullptr, bytes, prot, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+      throw std::runtime_error("Cannot map shared metrics segment " + name_);
+    }
+    base_ = static_cast<char *>(base);
+    bytes_ = bytes;
+  }
+
+  void unmap() {
+    if (base_) ::munmap(base_, bytes_);
+    base_ = nullptr;
+  }
+
+  std::string name_;
+  char *base_ = nullptr;
+  size_t bytes_ = 0;
+};
+
+// Creates (or replaces) the segment and publishes into it. The segment is
+// unlinked when the publisher goes away; readers that still have it mapped
+// keep the last values.
+template <typename T>
+class ShmMetricsPublisher : public ShmMetricsSegment<T> {
+ public:
+  ShmMetricsPublisher(const std::string &name, ShmMetricsFormat::Tag tag,
+                      const std::vector<std::string> &slot_names) {
+    this->name_ = ShmMetricsFormat::segmentName(name);
+    size_t stride = ShmMetricsFormat::slotStride(sizeof(T));
+    size_t bytes = sizeof(ShmMetricsFormat::Header) + stride * slot_names.size();
+    ::shm_unlink(this->name_.c_str());
+    int fd = ::shm_open(this->name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 || ::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+      if (fd >= 0) ::close(fd);
+      throw std::runtime_error("Cannot create shared metrics segment " +
+                               this->name_ + ": " + std::strerror(errno));
+    }
+    this->map(fd, bytes, PROT_READ | PROT_WRITE);
+
+    // ftruncate zero-fills, so every slot starts unpublished (sequence 0).
+    // The magic goes in last: readers treat a bad magic as not ready.
+    auto *header = reinterpret_cast<ShmMetricsFormat::Header *>(this->base_);
+    header->version = ShmMetricsFormat::VERSION;
+    header->tag = static_cast<uint32_t>(tag);
+    header->payload_size = sizeof(T);
+    header->slot_count = static_cast<uint32_t>(slot_names.size());
+    header->slot_stride = static_cast<uint32_t>(stride);
+    for (size_t i = 0; i < slot_names.size(); ++i) {
+      std::strncpy(this->slotAt(i).name, slot_names[i].c_str(),
+                   ShmMetricsFormat::NAME_SIZE - 1);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, ShmMetricsFormat::MAGIC, sizeof(header->magic));
+  }
+
+  ~ShmMetricsPublisher() { ::shm_unlink(this->name_.c_str()); }
+
+  // Publishes value into slot; only one thread may publish to a slot
+  void publish(size_t slot, const T &value) {
+    auto &s = this->slotAt(slot);
+    Seqlock::store(s.sequence, s.words, value);
+  }
+};
+
+// Read-only view of a segment published by another process.
+template <typename T>
+class ShmMetricsReader : public ShmMetricsSegment<T> {
+ public:
+  // Throws std::runtime_error if the segment does not exist or carries a
+  // different payload.
+  ShmMetricsReader(const std::string &name, ShmMetricsFormat::Tag tag) {
+    this->name_ = ShmMetricsFormat::segmentName(name);
+    int fd = ::shm_open(this->name_.c_str(), O_RDONLY, 0);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(ShmMetricsFormat::Header)) {
+      if (fd >= 0) ::close(fd);
+      throw std::runtime_error("No shared metrics segment " + this->name_);
+    }
+    this->map(fd, static_cast<size_t>(st.st_size), PROT_READ);
+    const auto &h = this->header();
+    if (std::memcmp(h.magic, ShmMetricsFormat::MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != ShmMetricsFormat::VERSION ||
+        h.tag != static_cast<uint32_t>(tag) || h.payload_size != sizeof(T) ||
+        sizeof(ShmMetricsFormat::Header) +
+                size_t(h.slot_count) * h.slot_stride >
+            this->bytes_) {
+      throw std::runtime_error("Unexpected shared metrics layout in " +
+                               this->name_);
+    }
+  }
+
+  // Copies the latest value of slot into out. Returns false if there is no
+  // such slot (e.g. find() missed) or nothing has been published there yet.
+  // version, if given, receives a counter that grows with every publish.
+  bool read(size_t slot, T &out, uint64_t *version = nullptr) const {
+    if (slot >= this->slots()) return false;
+    const auto &s = this->slotAt(slot);
+    T value;
+    uint64_t sequence = Seqlock::load(s.sequence, s.words, value);
+    if (sequence == 0) return false;
+    out = value;
+    if (version) *version = sequence / 2;
+    return true;
+  }
+};
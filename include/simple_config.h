@@ -4,6 +4,7 @@
 #include <string>
 #include <unordered_map>
 #include <stdexcept>
+#include <vector>
 
 class SimpleConfig {
  public:
@@ -54,6 +55,35 @@ class SimpleConfig {
     try { return std::stol(it->second); } catch (...) { return def; }
   }
 
+  // Comma-separated doubles, e.g. "7,30,90"; def if missing or invalid
+  std::vector<double> getDoubleList(const std::string& key, const std::vector<double>& def = {}) const {
+    auto it = data_.find(key);
+    if (it == data_.end()) return def;
+    std::vector<double> out;
+    std::stringstream ss(it->second);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      trim(item);
+      if (item.empty()) continue;
+      try { out.push_back(std::stod(item)); } catch (...) { return def; }
+    }
+    return out;
+  }
+
+  // Comma-separated strings with surrounding whitespace trimmed; def if missing
+  std::vector<std::string> getStringList(const std::string& key, const std::vector<std::string>& def = {}) const {
+    auto it = data_.find(key);
+    if (it == data_.end()) return def;
+    std::vector<std::string> out;
+    std::stringstream ss(it->second);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      trim(item);
+      if (!item.empty()) out.push_back(item);
+    }
+    return out;
+  }
+
   // Required accessors: throw if missing or invalid
  std::string requireString(const std::string& key) const {
    auto it = data_.find(key);
@@ -125,4 +155,14 @@ inline std::string resolveConfigPathFromArgs(int argc, char** argv, const std::s
   if (path.empty()) path = defaultPath;
   return path;
 }
+
+// Value of a "--name=value" or "--name value" argument, or def if absent.
+inline std::string argValue(int argc, char** argv, const std::string& name, const std::string& def = "") {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.rfind(name + "=", 0) == 0) return arg.substr(name.size() + 1);
+    if (arg == name && i + 1 < argc) return argv[i + 1];
+  }
+  return def;
+}
 }
@@ -0,0 +1,56 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free hand-off of the latest value from one writer thread to one
+// reader thread (a triple buffer).
+//
+// The writer fills back() and publish()es it; the reader acquire()s the
+// most recent published value and may keep reading it until its next
+// acquire(). Three buffers rotate through a single atomic index, so
+// neither side ever waits or sees a partially written value, and a slow
+// reader only skips intermediate values. pending() lets a writer that must
+// not skip any (e.g. during a replay) wait for the reader instead.
+template <typename T>
+class SnapshotBuffer {
+ public:
+  SnapshotBuffer() = default;
+  SnapshotBuffer(const SnapshotBuffer &) = delete;
+  SnapshotBuffer &operator=(const SnapshotBuffer &) = delete;
+
+  // Writer: the buffer to fill next. It is private to the writer until
+  // publish().
+  T &back() { return buffers_[write_]; }
+
+  // Writer: makes back() the latest value and hands the writer a free
+  // buffer, which holds stale contents.
+  void publish() {
+    uint8_t previous =
+        middle_.exchange(write_ | FRESH, std::memory_order_acq_rel);
+    write_ = previous & INDEX;
+  }
+
+  // Either side: whether a published value has not been acquired yet.
+  bool pending() const {
+    return (middle_.load(std::memory_order_acquire) & FRESH) != 0;
+  }
+
+  // Reader: the latest value published since the last acquire(), or
+  // nullptr if there is none. The pointer stays valid until the next call.
+  const T *acquire() {
+    if (!pending()) return nullptr;
+    uint8_t previous = middle_.exchange(read_, std::memory_order_acq_rel);
+    read_ = previous & INDEX;
+    return &buffers_[read_];
+  }
+
+ private:
+  static constexpr uint8_t INDEX = 0x3;
+  static constexpr uint8_t FRESH = 0x4;
+
+  std::array<T, 3> buffers_{};
+  uint8_t write_ = 0; // writer only
+  alignas(64) std::atomic<uint8_t> middle_{1};
+  alignas(64) uint8_t read_ = 2; // reader only
+};
@@ -0,0 +1,188 @@
+#pragma once
+#include "huge_pages.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Bounded lock-free single-producer/single-consumer ring.
+//
+// The producer thread calls tryPush()/push() or claim()/publish() to write a
+// slot in place; the consumer thread calls consume(). Capacity is rounded up
+// to a power of two. Indices are free-running, each side caches the other's
+// index and the two halves live on separate cache lines.
+template <typename T>
+class SpscQueue {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SpscQueue elements must be trivially copyable");
+
+ public:
+  enum class OverflowPolicy {
+    DROP, // discard the new element and count it
+    BLOCK // spin until the consumer frees a slot (backpressure)
+  };
+
+  struct Stats {
+    uint64_t pushed = 0;
+    uint64_t dropped = 0;
+    uint64_t backpressure_waits = 0;
+    size_t depth = 0;
+    size_t high_watermark = 0;
+    size_t capacity = 0;
+  };
+
+  explicit SpscQueue(size_t capacity,
+                     OverflowPolicy policy = OverflowPolicy::DROP)
+      : buf_(roundUpPow2(capacity)), mask_(buf_.size() - 1), policy_(policy) {}
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  // Producer: returns a slot to fill, or nullptr when the ring is full.
+  T *claim() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ > mask_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ > mask_) return nullptr;
+    }
+    return &buf_[tail & mask_];
+  }
+
+  // Producer: makes the slot returned by the last claim() visible.
+  void publish() {
+    size_t tail = tail_.load(std::memory_order_relaxed) + 1;
+    tail_.store(tail, std::memory_order_release);
+    pushed_.store(pushed_.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+    // Sample the queue depth every WATERMARK_SAMPLE pushes rather than
+    // touching the consumer's cache line on every publish
+    if ((tail & (WATERMARK_SAMPLE - 1)) == 0) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      size_t depth = tail - head_cache_;
+      if (depth > high_watermark_.load(std::memory_order_relaxed)) {
+        high_watermark_.store(depth, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Producer: claim() honoring the overflow policy. Returns nullptr only
+  // under DROP, after counting the drop.
+  T *claimOrWait() {
+    T *slot = claim();
+    if (slot) return slot;
+    if (policy_ == OverflowPolicy::DROP) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+      return nullptr;
+    }
+    backpressure_waits_.store(
+        backpressure_waits_.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+    while (!(slot = claim())) std::this_thread::yield();
+    return slot;
+  }
+
+  bool tryPush(const T &value) {
+    T *slot = claim();
+    if (!slot) return false;
+    *slot = value;
+    publish();
+    return true;
+  }
+
+  // Producer: push honoring the overflow policy. Returns false if dropped.
+  bool push(const T &value) {
+    T *slot = claimOrWait();
+    if (!slot) return false;
+    *slot = value;
+    publish();
+    return true;
+  }
+
+  // Consumer: hands up to max_batch queued elements to fn(const T&) and
+  // releases their slots in one step. Returns the number consumed.
+  template <typename Fn>
+  size_t consume(Fn &&fn, size_t max_batch = SIZE_MAX) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t n = available(head, max_batch);
+    for (size_t i = 0; i < n; ++i) fn(buf_[(head + i) & mask_]);
+    if (n) head_.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  // Consumer: the same batch handed to fn(const T *first, size_t count) in
+  // place, as one contiguous run or two where the ring wraps, so the
+  // consumer can process it as a whole. Returns the number consumed.
+  template <typename Fn>
+  size_t consumeRuns(Fn &&fn, size_t max_batch = SIZE_MAX) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t n = available(head, max_batch);
+    if (n == 0) return 0;
+    size_t first = head & mask_;
+    size_t run = std::min(n, buf_.size() - first);
+    fn(&buf_[first], run);
+    if (run < n) fn(&buf_[0], n - run);
+    head_.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  // Approximate number of queued elements; safe from any thread.
+  size_t depth() const {
+    size_t tail = tail_.load(std::memory_order_acquire);
+    size_t head = head_.load(std::memory_order_acquire);
+    return tail >= head ? tail - head : 0;
+  }
+
+  size_t capacity() const { return buf_.size(); }
+
+  Stats stats() const {
+    Stats s;
+    s.pushed = pushed_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.backpressure_waits = backpressure_waits_.load(std::memory_order_relaxed);
+    s.depth = depth();
+    s.high_watermark = high_watermark_.load(std::memory_order_relaxed);
+    s.capacity = capacity();
+    return s;
+  }
+
+ private:
+  static constexpr size_t WATERMARK_SAMPLE = 64;
+
+  // Elements ready for the consumer at head, at most max_batch. Refreshes
+  // the cached tail unless it already covers a full batch, so a final
+  // drain sees everything published so far.
+  size_t available(size_t head, size_t max_batch) {
+    size_t ready = tail_cache_ - head;
+    if (ready < max_batch) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      ready = tail_cache_ - head;
+    }
+    return ready < max_batch ? ready : max_batch;
+  }
+
+  static size_t roundUpPow2(size_t n) {
+    size_t p = 2;
+    while (p < n) p <<= 1;
+    return p;
+  }
+
+  std::vector<T, HugePageAllocator<T>> buf_;
+  const size_t mask_;
+  const OverflowPolicy policy_;
+
+  // Consumer-owned
+  alignas(64) std::atomic<size_t> head_{0};
+  size_t tail_cache_ = 0;
+
+  // Producer-owned; counters are single-writer so plain load+store suffices
+  alignas(64) std::atomic<size_t> tail_{0};
+  size_t head_cache_ = 0;
+  std::atomic<uint64_t> pushed_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> backpressure_waits_{0};
+  std::atomic<size_t> high_watermark_{0};
+};
@@ -0,0 +1,242 @@
+#pragma once
+#include "market_events.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Seeded synthetic trade and depth streams, for benchmarks and offline
+// runs without an exchange connection.
+//
+// A common mid price follows geometric Brownian motion. Each venue quotes
+// around it with its own mean-reverting basis, so cross-venue spreads open
+// and close, and a spread of one to three ticks. Trades and book updates
+// arrive per venue as independent Poisson processes at the configured
+// rates. A trade lifts the ask or hits the bid with a log-normal size and
+// nudges the mid in its direction; a book is a full snapshot of
+// depth_levels per side whose sizes grow away from the touch. Receipt lags
+// the exchange time by an exponential delay. The same options and seed
+// give the same stream on the same standard library.
+struct SyntheticMarketOptions {
+  uint64_t seed = 1;
+  size_t venues = 1;
+  double trades_per_second = 50.0; // per venue
+  double books_per_second = 10.0;  // per venue
+  size_t depth_levels = 20;        // per side, at most MAX_BOOK_DEPTH
+  double start_price = 50000.0;
+  double tick_size = 0.01;
+  double volatility = 0.6;         // annualized
+  double mean_trade_size = 0.05;
+  double basis_bps = 2.0;          // typical venue deviation from the mid
+  double impact_bps = 0.05;        // mid move per mean-sized trade
+  double latency_us = 500.0;       // mean exchange-to-receipt delay
+  int64_t start_ns = 1700000000000000000LL;
+};
+
+class SyntheticMarket {
+ public:
+  explicit SyntheticMarket(const SyntheticMarketOptions &options)
+      : options_(options), rng_(options.seed), mid_(options.start_price),
+        time_ns_(options.start_ns), venues_(std::max<size_t>(1, options.venues)) {
+    options_.depth_levels =
+        std::min(std::max<size_t>(1, options_.depth_levels), MAX_BOOK_DEPTH);
+    for (auto &venue : venues_) {
+      venue.next_trade_ns = time_ns_ + arrival(options_.trades_per_second);
+      venue.next_book_ns = time_ns_ + arrival(options_.books_per_second);
+      venue.spread_ticks = 1 + static_cast<int>(uniform_(rng_) * 3.0);
+    }
+  }
+
+  size_t venues() const { return venues_.size(); }
+  double mid() const { return mid_; }
+  int64_t timeNanos() const { return time_ns_; }
+
+  // The next event of any venue, in exchange time order. venue receives
+  // its index. The reference stays valid until the next call.
+  const MarketEvent &next(size_t &venue) {
+    venue = 0;
+    bool trade = true;
+    int64_t at = venues_[0].next_trade_ns;
+    for (size_t v = 0; v < venues_.size(); ++v) {
+      if (venues_[v].next_trade_ns < at) {
+        at = venues_[v].next_trade_ns;
+        venue = v;
+        trade = true;
+      }
+      if (venues_[v].next_book_ns < at) {
+        at = venues_[v].next_book_ns;
+        venue = v;
+        trade = false;
+      }
+    }
+    advance(at);
+    Venue &state = venues_[venue];
+    event_.exchange_time_ns = at;
+    event_.receive_time_ns =
+        at + static_cast<int64_t>(exponential(options_.latency_us * 1e3));
+    event_.received_stamp = 0;
+    event_.parsed_stamp = 0;
+    if (trade) {
+      makeTrade(state);
+      state.next_trade_ns = at + arrival(options_.trades_per_second);
+    } else {
+      makeBook(state);
+      state.next_book_ns = at + arrival(options_.books_per_second);
+    }
+    return event_;
+  }
+
+  // Converts an event into the ccapi message the feed would have sent:
+  // LAST_PRICE/LAST_SIZE/IS_BUYER_MAKER for trades, one BID_PRICE/BID_SIZE
+  // or ASK_PRICE/ASK_SIZE element per level for books, the first book of a
+  // venue marked as the solicited snapshot. Templated on the message type so
+  // ccapi stays out of ccapi-independent code.
+  template <typename MessageT>
+  void toMessage(const MarketEvent &ev, const std::string &correlation_id,
+                 bool first_book, MessageT &message) const {
+    using Element =
+        typename std::decay_t<decltype(message.getElementList())>::value_type;
+    using Time = std::decay_t<decltype(message.getTime())>;
+    message = MessageT();
+    message.setTime(Time(std::chrono::nanoseconds(ev.exchange_time_ns)));
+    message.setTimeReceived(Time(std::chrono::nanoseconds(ev.receive_time_ns)));
+    message.setCorrelationIdList({correlation_id});
+    std::vector<Element> elements;
+    if (ev.type == MarketEvent::Type::TRADE) {
+      message.setType(MessageT::Type::MARKET_DATA_EVENTS_TRADE);
+      message.setRecapType(MessageT::RecapType::NONE);
+      Element element;
+      element.insert("LAST_PRICE", format(ev.trade.price, priceDecimals()));
+      element.insert("LAST_SIZE", format(ev.trade.amount, SIZE_DECIMALS));
+      element.insert("IS_BUYER_MAKER",
+                     ev.trade.side == TradeSide::SELL ? "1" : "0");
+      elements.push_back(std::move(element));
+    } else {
+      message.setType(MessageT::Type::MARKET_DATA_EVENTS_MARKET_DEPTH);
+      message.setRecapType(first_book ? MessageT::RecapType::SOLICITED
+                                      : MessageT::RecapType::NONE);
+      for (size_t i = 0; i < ev.book.bid_count; ++i) {
+        Element element;
+        element.insert("BID_PRICE", format(ev.book.bid_price[i], priceDecimals()));
+        element.insert("BID_SIZE", format(ev.book.bid_size[i], SIZE_DECIMALS));
+        elements.push_back(std::move(element));
+      }
+      for (size_t i = 0; i < ev.book.ask_count; ++i) {
+        Element element;
+        element.insert("ASK_PRICE", format(ev.book.ask_price[i], priceDecimals()));
+        element.insert("ASK_SIZE", format(ev.book.ask_size[i], SIZE_DECIMALS));
+        elements.push_back(std::move(element));
+      }
+    }
+    message.setElementList(elements);
+  }
+
+ private:
+  static constexpr int SIZE_DECIMALS = 5;
+  static constexpr double SECONDS_PER_YEAR = 365.0 * 24 * 3600;
+  static constexpr double BASIS_REVERSION = 1.0; // per second
+
+  struct Venue {
+    int64_t next_trade_ns = 0;
+    int64_t next_book_ns = 0;
+    double basis = 0.0; // fractional deviation from the common mid
+    int spread_ticks = 1;
+  };
+
+  // Nanoseconds to the next arrival of a Poisson process at rate per second
+  int64_t arrival(double rate) {
+    if (rate <= 0) return INT64_MAX / 4;
+    return 1 + static_cast<int64_t>(exponential(1e9 / rate));
+  }
+
+  double exponential(double mean) {
+    return -mean * std::log(1.0 - uniform_(rng_));
+  }
+
+  double logNormal(double mean, double sigma) {
+    return mean * std::exp(sigma * normal_(rng_) - 0.5 * sigma * sigma);
+  }
+
+  // Moves the mid and every venue's basis forward to at
+  void advance(int64_t at) {
+    double dt = static_cast<double>(at - time_ns_) * 1e-9;
+    time_ns_ = at;
+    if (dt <= 0) return;
+    double sigma = options_.volatility * std::sqrt(dt / SECONDS_PER_YEAR);
+    mid_ *= std::exp(sigma * normal_(rng_) - 0.5 * sigma * sigma);
+    // Ornstein-Uhlenbeck basis with stationary deviation basis_bps
+    double decay = std::exp(-BASIS_REVERSION * dt);
+    double spread = options_.basis_bps * 1e-4 * std::sqrt(1.0 - decay * decay);
+    for (auto &venue : venues_) {
+      venue.basis = venue.basis * decay + spread * normal_(rng_);
+    }
+  }
+
+  double bestBid(const Venue &venue) const {
+    double tick = options_.tick_size;
+    double half = 0.5 * venue.spread_ticks * tick;
+    return std::floor((mid_ * (1.0 + venue.basis) - half) / tick) * tick;
+  }
+
+  double roundSize(double size) const {
+    double lot = std::pow(10.0, -SIZE_DECIMALS);
+    return std::max(lot, std::round(size / lot) * lot);
+  }
+
+  void makeTrade(const Venue &venue) {
+    event_.type = MarketEvent::Type::TRADE;
+    double size = roundSize(logNormal(options_.mean_trade_size, 1.0));
+    bool buy = uniform_(rng_) < 0.5;
+    double bid = bestBid(venue);
+    event_.trade.price = buy ? bid + venue.spread_ticks * options_.tick_size : bid;
+    event_.trade.amount = size;
+    event_.trade.side = buy ? TradeSide::BUY : TradeSide::SELL;
+    double impact = options_.impact_bps * 1e-4 * size / options_.mean_trade_size;
+    mid_ *= buy ? 1.0 + impact : 1.0 - impact;
+  }
+
+  void makeBook(const Venue &venue) {
+    event_.type = MarketEvent::Type::BOOK;
+    BookEvent &book = event_.book;
+    book.snapshot = true;
+    book.bid_count = book.ask_count = static_cast<uint16_t>(options_.depth_levels);
+    double tick = options_.tick_size;
+    double bid = bestBid(venue);
+    double ask = bid + venue.spread_ticks * tick;
+    for (size_t i = 0; i < options_.depth_levels; ++i) {
+      double depth = options_.mean_trade_size * (1.0 + 0.5 * i);
+      book.bid_price[i] = bid - i * tick;
+      book.ask_price[i] = ask + i * tick;
+      book.bid_size[i] = roundSize(logNormal(depth, 0.5));
+      book.ask_size[i] = roundSize(logNormal(depth, 0.5));
+    }
+  }
+
+  int priceDecimals() const {
+    int decimals = 0;
+    for (double t = options_.tick_size; decimals < 12 && t < 0.999999; t *= 10) {
+      ++decimals;
+    }
+    return decimals;
+  }
+
+  static std::string format(double value, int decimals) {
+    char buf[64];
+    int n = std::snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    return std::string(buf, static_cast<size_t>(std::max(0, n)));
+  }
+
+  SyntheticMarketOptions options_;
+  std::mt19937_64 rng_;
+  std::uniform_real_distribution<double> uniform_{0.0, 1.0};
+  std::normal_distribution<double> normal_{0.0, 1.0};
+  double mid_;
+  int64_t time_ns_;
+  std::vector<Venue> venues_;
+  MarketEvent event_{};
+};
@@ -0,0 +1,653 @@
+#pragma once
+#include "market_events.h"
+#include "simple_config.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Append-only columnar tick files, one per symbol, day and kind:
+//
+//   <root>/<SYMBOL>/<YYYYMMDD>.trades
+//   <root>/<SYMBOL>/<YYYYMMDD>.book
+//
+// A file is a 64-byte header followed by blocks. Each block starts with a
+// 32-byte header (row count, first/last timestamp, byte size) and stores its
+// rows column by column, every column padded to 8 bytes:
+//
+//   trades: i64 time_ns | f64 price | f64 size | u8 side
+//   book:   i64 time_ns | f64 bid_price[depth] | f64 bid_size[depth] |
+//           f64 ask_price[depth] | f64 ask_size[depth] |
+//           u16 bid_count | u16 ask_count | u8 snapshot
+//
+// Book rows are the BookEvents as applied (snapshots and deltas), so a
+// replay rebuilds the same book. The block headers form the sparse time
+// index; readers mmap the file and hand out pointers into the columns.
+namespace TickStoreFormat {
+constexpr char MAGIC[8] = {'C', 'C', 'T', 'I', 'C', 'K', '0', '1'};
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t BLOCK_MAGIC = 0x314b4c42; // "BLK1"
+
+enum class Kind : uint32_t { TRADES = 1, BOOK = 2 };
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t kind;
+  uint32_t depth; // book levels per side; 0 for trades
+  uint32_t reserved;
+  char symbol[40];
+};
+static_assert(sizeof(FileHeader) == 64, "FileHeader layout");
+
+struct BlockHeader {
+  uint32_t magic;
+  uint32_t rows;
+  int64_t first_time_ns;
+  int64_t last_time_ns;
+  uint64_t bytes; // header included
+};
+static_assert(sizeof(BlockHeader) == 32, "BlockHeader layout");
+
+inline size_t pad8(size_t n) { return (n + 7) & ~size_t(7); }
+
+constexpr int64_t NANOS_PER_DAY = 86400LL * 1000000000LL;
+
+// UTC day number -> YYYYMMDD (civil-from-days, proleptic Gregorian)
+inline uint32_t dayToDate(int64_t day) {
+  int64_t z = day + 719468;
+  int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  int64_t doe = z - era * 146097;
+  int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int64_t mp = (5 * doy + 2) / 153;
+  int64_t d = doy - (153 * mp + 2) / 5 + 1;
+  int64_t m = mp < 10 ? mp + 3 : mp - 9;
+  int64_t y = yoe + era * 400 + (m <= 2);
+  return static_cast<uint32_t>(y * 10000 + m * 100 + d);
+}
+
+// YYYYMMDD -> UTC day number (days-from-civil)
+inline int64_t dateToDay(uint32_t date) {
+  int64_t y = date / 10000, m = (date / 100) % 100, d = date % 100;
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  int64_t yoe = y - era * 400;
+  int64_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+inline int64_t dayOf(int64_t time_ns) {
+  return time_ns >= 0 ? time_ns / NANOS_PER_DAY
+                      : (time_ns - NANOS_PER_DAY + 1) / NANOS_PER_DAY;
+}
+
+inline const char *extension(Kind kind) {
+  return kind == Kind::TRADES ? ".trades" : ".book";
+}
+
+inline std::filesystem::path filePath(const std::string &root,
+                                      const std::string &symbol,
+                                      uint32_t date, Kind kind) {
+  return std::filesystem::path(root) / symbol /
+         (std::to_string(date) + extension(kind));
+}
+} // namespace TickStoreFormat
+
+// Zero-copy view of one trade block.
+struct TradeBlock {
+  size_t rows;
+  const int64_t *time_ns;
+  const double *price;
+  const double *size;
+  const uint8_t *side; // TradeSide values
+};
+
+// Zero-copy view of one book block. Level arrays are row-major with
+// `depth` entries per row.
+struct BookBlock {
+  size_t rows;
+  size_t depth;
+  const int64_t *time_ns;
+  const double *bid_price;
+  const double *bid_size;
+  const double *ask_price;
+  const double *ask_size;
+  const uint16_t *bid_count;
+  const uint16_t *ask_count;
+  const uint8_t *snapshot;
+};
+
+// Read-only mmap of one tick file. A truncated trailing block (e.g. from a
+// crash mid-write) is ignored.
+class TickFile {
+ public:
+  TickFile(const std::string &path, TickStoreFormat::Kind kind) {
+    using namespace TickStoreFormat;
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) throw std::runtime_error("Cannot open tick file: " + path);
+    struct stat st;
+    if (::fstat(fd_, &st) != 0 || st.st_size < 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+      close();
+      throw std::runtime_error("Not a tick file: " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void *base = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (base == MAP_FAILED) {
+      close();
+      throw std::runtime_error("Cannot map tick file: " + path);
+    }
+    base_ = static_cast<const uint8_t *>(base);
+    ::madvise(base, size_, MADV_SEQUENTIAL);
+
+    const auto *header = reinterpret_cast<const FileHeader *>(base_);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header->version != VERSION ||
+        header->kind != static_cast<uint32_t>(kind)) {
+      close();
+      throw std::runtime_error("Unsupported tick file: " + path);
+    }
+    kind_ = kind;
+    depth_ = header->depth;
+
+    size_t offset = sizeof(FileHeader);
+    while (offset + sizeof(BlockHeader) <= size_) {
+      const auto *block = reinterpret_cast<const BlockHeader *>(base_ + offset);
+      if (block->magic != BLOCK_MAGIC || block->bytes < sizeof(BlockHeader) ||
+          block->bytes > size_ - offset ||
+          block->bytes < blockBytes(block->rows)) {
+        break;
+      }
+      blocks_.push_back(block);
+      rows_ += block->rows;
+      offset += block->bytes;
+    }
+  }
+
+  TickFile(const TickFile &) = delete;
+  TickFile &operator=(const TickFile &) = delete;
+
+  ~TickFile() { close(); }
+
+  size_t blocks() const { return blocks_.size(); }
+  size_t rows() const { return rows_; }
+  size_t depth() const { return depth_; }
+  int64_t firstTime() const {
+    return blocks_.empty() ? 0 : blocks_.front()->first_time_ns;
+  }
+  int64_t lastTime() const {
+    return blocks_.empty() ? 0 : blocks_.back()->last_time_ns;
+  }
+
+  TradeBlock tradeBlock(size_t b) const {
+    const TickStoreFormat::BlockHeader *block = blocks_[b];
+    size_t n = block->rows;
+    const uint8_t *p = columns(block);
+    TradeBlock view;
+    view.rows = n;
+    view.time_ns = take<int64_t>(p, n);
+    view.price = take<double>(p, n);
+    view.size = take<double>(p, n);
+    view.side = take<uint8_t>(p, n);
+    return view;
+  }
+
+  BookBlock bookBlock(size_t b) const {
+    const TickStoreFormat::BlockHeader *block = blocks_[b];
+    size_t n = block->rows;
+    const uint8_t *p = columns(block);
+    BookBlock view;
+    view.rows = n;
+    view.depth = depth_;
+    view.time_ns = take<int64_t>(p, n);
+    view.bid_price = take<double>(p, n * depth_);
+    view.bid_size = take<double>(p, n * depth_);
+    view.ask_price = take<double>(p, n * depth_);
+    view.ask_size = take<double>(p, n * depth_);
+    view.bid_count = take<uint16_t>(p, n);
+    view.ask_count = take<uint16_t>(p, n);
+    view.snapshot = take<uint8_t>(p, n);
+    return view;
+  }
+
+  // First block whose last timestamp is >= time_ns (blocks() if none).
+  size_t seekBlock(int64_t time_ns) const {
+    auto it = std::lower_bound(
+        blocks_.begin(), blocks_.end(), time_ns,
+        [](const TickStoreFormat::BlockHeader *block, int64_t t) {
+          return block->last_time_ns < t;
+        });
+    return static_cast<size_t>(it - blocks_.begin());
+  }
+
+ private:
+  size_t blockBytes(size_t rows) const {
+    using TickStoreFormat::pad8;
+    size_t bytes = sizeof(TickStoreFormat::BlockHeader) + pad8(rows * 8);
+    if (kind_ == TickStoreFormat::Kind::TRADES) {
+      bytes += 2 * pad8(rows * 8) + pad8(rows);
+    } else {
+      bytes += 4 * pad8(rows * depth_ * 8) + 2 * pad8(rows * 2) + pad8(rows);
+    }
+    return bytes;
+  }
+
+  static const uint8_t *columns(const TickStoreFormat::BlockHeader *block) {
+    return reinterpret_cast<const uint8_t *>(block) +
+           sizeof(TickStoreFormat::BlockHeader);
+  }
+
+  template <typename T>
+  static const T *take(const uint8_t *&p, size_t count) {
+    const T *column = reinterpret_cast<const T *>(p);
+    p += TickStoreFormat::pad8(count * sizeof(T));
+    return column;
+  }
+
+  void close() {
+    if (base_) ::munmap(const_cast<uint8_t *>(base_), size_);
+    if (fd_ >= 0) ::close(fd_);
+    base_ = nullptr;
+    fd_ = -1;
+  }
+
+  int fd_ = -1;
+  const uint8_t *base_ = nullptr;
+  size_t size_ = 0;
+  TickStoreFormat::Kind kind_ = TickStoreFormat::Kind::TRADES;
+  size_t depth_ = 0;
+  size_t rows_ = 0;
+  std::vector<const TickStoreFormat::BlockHeader *> blocks_;
+};
+
+// Appends trades and book events for one symbol, rolling to a new file at
+// each UTC day. Rows are buffered per column and written a block at a time;
+// flush() writes a short block. Not thread-safe.
+class TickStoreWriter {
+ public:
+  static constexpr size_t TRADE_BLOCK_ROWS = 4096;
+  static constexpr size_t BOOK_BLOCK_ROWS = 1024;
+
+  TickStoreWriter(const std::string &root, const std::string &symbol)
+      : root_(root), symbol_(symbol) {
+    if (symbol.size() >= sizeof(TickStoreFormat::FileHeader::symbol)) {
+      throw std::invalid_argument("Symbol too long for tick store: " + symbol);
+    }
+    std::filesystem::create_directories(std::filesystem::path(root) / symbol);
+  }
+
+  TickStoreWriter(const TickStoreWriter &) = delete;
+  TickStoreWriter &operator=(const TickStoreWriter &) = delete;
+
+  ~TickStoreWriter() { flush(); }
+
+  void appendTrade(int64_t time_ns, double price, double size, TradeSide side) {
+    rollDay(trades_, time_ns, TickStoreFormat::Kind::TRADES);
+    trades_.time_ns.push_back(time_ns);
+    trades_.price.push_back(price);
+    trades_.size.push_back(size);
+    trades_.side.push_back(static_cast<uint8_t>(side));
+    if (trades_.time_ns.size() >= TRADE_BLOCK_ROWS) writeTrades();
+  }
+
+  void appendBook(int64_t time_ns, const BookEvent &book) {
+    rollDay(books_, time_ns, TickStoreFormat::Kind::BOOK);
+    books_.time_ns.push_back(time_ns);
+    appendLevels(books_.bid_price, book.bid_price, book.bid_count);
+    appendLevels(books_.bid_size, book.bid_size, book.bid_count);
+    appendLevels(books_.ask_price, book.ask_price, book.ask_count);
+    appendLevels(books_.ask_size, book.ask_size, book.ask_count);
+    books_.bid_count.push_back(book.bid_count);
+    books_.ask_count.push_back(book.ask_count);
+    books_.snapshot.push_back(book.snapshot ? 1 : 0);
+    if (books_.time_ns.size() >= BOOK_BLOCK_ROWS) writeBooks();
+  }
+
+  void flush() {
+    writeTrades();
+    writeBooks();
+    trades_.out.flush();
+    books_.out.flush();
+  }
+
+ private:
+  struct Columns {
+    std::ofstream out;
+    int64_t day = INT64_MIN;
+    std::vector<int64_t> time_ns;
+  };
+
+  struct TradeColumns : Columns {
+    std::vector<double> price, size;
+    std::vector<uint8_t> side;
+  };
+
+  struct BookColumns : Columns {
+    std::vector<double> bid_price, bid_size, ask_price, ask_size;
+    std::vector<uint16_t> bid_count, ask_count;
+    std::vector<uint8_t> snapshot;
+  };
+
+  static void appendLevels(std::vector<double> &column, const double *values,
+                           size_t count) {
+    count = std::min(count, MAX_BOOK_DEPTH);
+    column.insert(column.end(), values, values + count);
+    column.insert(column.end(), MAX_BOOK_DEPTH - count, 0.0);
+  }
+
+  // Switches cols to the file of time_ns's day, writing out the previous
+  // day's pending rows first.
+  void rollDay(Columns &cols, int64_t time_ns, TickStoreFormat::Kind kind) {
+    int64_t day = TickStoreFormat::dayOf(time_ns);
+    if (day == cols.day) return;
+    if (kind == TickStoreFormat::Kind::TRADES) {
+      writeTrades();
+    } else {
+      writeBooks();
+    }
+    cols.out.close();
+    cols.out.clear();
+    cols.day = day;
+    openFile(cols.out, TickStoreFormat::dayToDate(day), kind);
+  }
+
+  // Opens a day file for appending, writing the header if it is new.
+  void openFile(std::ofstream &out, uint32_t date, TickStoreFormat::Kind kind) {
+    using namespace TickStoreFormat;
+    std::string path = filePath(root_, symbol_, date, kind).string();
+    std::error_code ec;
+    bool fresh = !std::filesystem::exists(path, ec) ||
+                 std::filesystem::file_size(path, ec) == 0;
+    if (!fresh) {
+      FileHeader existing{};
+      std::ifstream in(path, std::ios::binary);
+      in.read(reinterpret_cast<char *>(&existing), sizeof(existing));
+      if (!in || std::memcmp(existing.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+          existing.kind != static_cast<uint32_t>(kind)) {
+        throw std::runtime_error("Refusing to append to foreign file: " + path);
+      }
+    }
+    out.open(path, std::ios::binary | std::ios::app);
+    if (!out) throw std::runtime_error("Cannot open tick file: " + path);
+    if (fresh) {
+      FileHeader header{};
+      std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+      header.version = VERSION;
+      header.kind = static_cast<uint32_t>(kind);
+      header.depth = kind == Kind::BOOK ? MAX_BOOK_DEPTH : 0;
+      std::memcpy(header.symbol, symbol_.data(), symbol_.size());
+      out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+  }
+
+  template <typename T>
+  static size_t columnBytes(const std::vector<T> &column) {
+    return TickStoreFormat::pad8(column.size() * sizeof(T));
+  }
+
+  template <typename T>
+  static void writeColumn(std::ofstream &out, const std::vector<T> &column) {
+    static const char zeros[8] = {};
+    size_t bytes = column.size() * sizeof(T);
+    out.write(reinterpret_cast<const char *>(column.data()),
+              static_cast<std::streamsize>(bytes));
+    out.write(zeros, static_cast<std::streamsize>(
+                         TickStoreFormat::pad8(bytes) - bytes));
+  }
+
+  static void writeHeader(Columns &cols, size_t bytes) {
+    TickStoreFormat::BlockHeader header{};
+    header.magic = TickStoreFormat::BLOCK_MAGIC;
+    header.rows = static_cast<uint32_t>(cols.time_ns.size());
+    header.first_time_ns = cols.time_ns.front();
+    header.last_time_ns = cols.time_ns.back();
+    header.bytes = sizeof(header) + bytes;
+    cols.out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  }
+
+  void writeTrades() {
+    TradeColumns &c = trades_;
+    if (c.time_ns.empty()) return;
+    writeHeader(c, columnBytes(c.time_ns) + columnBytes(c.price) +
+                       columnBytes(c.size) + columnBytes(c.side));
+    writeColumn(c.out, c.time_ns);
+    writeColumn(c.out, c.price);
+    writeColumn(c.out, c.size);
+    writeColumn(c.out, c.side);
+    c.time_ns.clear();
+    c.price.clear();
+    c.size.clear();
+    c.side.clear();
+  }
+
+  void writeBooks() {
+    BookColumns &c = books_;
+    if (c.time_ns.empty()) return;
+    writeHeader(c, columnBytes(c.time_ns) + columnBytes(c.bid_price) +
+                       columnBytes(c.bid_size) + columnBytes(c.ask_price) +
+                       columnBytes(c.ask_size) + columnBytes(c.bid_count) +
+                       columnBytes(c.ask_count) + columnBytes(c.snapshot));
+    writeColumn(c.out, c.time_ns);
+    writeColumn(c.out, c.bid_price);
+    writeColumn(c.out, c.bid_size);
+    writeColumn(c.out, c.ask_price);
+    writeColumn(c.out, c.ask_size);
+    writeColumn(c.out, c.bid_count);
+    writeColumn(c.out, c.ask_count);
+    writeColumn(c.out, c.snapshot);
+    c.time_ns.clear();
+    c.bid_price.clear();
+    c.bid_size.clear();
+    c.ask_price.clear();
+    c.ask_size.clear();
+    c.bid_count.clear();
+    c.ask_count.clear();
+    c.snapshot.clear();
+  }
+
+  std::string root_;
+  std::string symbol_;
+  TradeColumns trades_;
+  BookColumns books_;
+};
+
+// Reads a symbol's stored days and replays them in timestamp order.
+class TickStore {
+ public:
+  struct Summary {
+    uint64_t trades = 0;
+    uint64_t books = 0;
+    size_t days = 0;
+  };
+
+  TickStore(const std::string &root, const std::string &symbol)
+      : root_(root), symbol_(symbol) {}
+
+  // Stored dates (YYYYMMDD) within [from_date, to_date], ascending.
+  std::vector<uint32_t> dates(uint32_t from_date = 0,
+                              uint32_t to_date = UINT32_MAX) const {
+    std::vector<uint32_t> result;
+    std::error_code ec;
+    std::filesystem::directory_iterator it(
+        std::filesystem::path(root_) / symbol_, ec);
+    if (ec) return result;
+    for (const auto &entry : it) {
+      const auto path = entry.path();
+      auto ext = path.extension().string();
+      if (ext != ".trades" && ext != ".book") continue;
+      auto stem = path.stem().string();
+      if (stem.size() != 8 ||
+          !std::all_of(stem.begin(), stem.end(), [](unsigned char c) {
+            return std::isdigit(c) != 0;
+          })) {
+        continue;
+      }
+      auto date = static_cast<uint32_t>(std::stoul(stem));
+      if (date >= from_date && date <= to_date) result.push_back(date);
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+  }
+
+  // Calls on_trade(time_ns, price, size, TradeSide) and
+  // on_book(time_ns, snapshot, bid_price*, bid_size*, bid_count, ask_price*,
+  // ask_size*, ask_count) for every row in [from_ns, to_ns), merged by
+  // time. Book level pointers point into the mapped file.
+  template <typename OnTrade, typename OnBook>
+  Summary replay(OnTrade &&on_trade, OnBook &&on_book,
+                 int64_t from_ns = INT64_MIN,
+                 int64_t to_ns = INT64_MAX) const {
+    using namespace TickStoreFormat;
+    uint32_t from_date = from_ns == INT64_MIN ? 0 : dayToDate(dayOf(from_ns));
+    uint32_t to_date =
+        to_ns == INT64_MAX ? UINT32_MAX : dayToDate(dayOf(to_ns - 1));
+    Summary summary;
+    for (uint32_t date : dates(from_date, to_date)) {
+      ++summary.days;
+      auto trades = open(date, TickStoreFormat::Kind::TRADES);
+      auto books = open(date, TickStoreFormat::Kind::BOOK);
+      Cursor<TradeBlock> t(trades.get(), from_ns);
+      Cursor<BookBlock> b(books.get(), from_ns);
+      while (true) {
+        int64_t tt = t.time(), bt = b.time();
+        int64_t next = std::min(tt, bt);
+        if (next == INT64_MAX || next >= to_ns) break;
+        if (tt <= bt) {
+          const TradeBlock &v = t.view;
+          on_trade(tt, v.price[t.row], v.size[t.row],
+                   static_cast<TradeSide>(v.side[t.row]));
+          ++summary.trades;
+          t.advance();
+        } else {
+          const BookBlock &v = b.view;
+          size_t r = b.row, d = v.depth;
+          on_book(bt, v.snapshot[r] != 0, v.bid_price + r * d,
+                  v.bid_size + r * d, std::min<size_t>(v.bid_count[r], d),
+                  v.ask_price + r * d, v.ask_size + r * d,
+                  std::min<size_t>(v.ask_count[r], d));
+          ++summary.books;
+          b.advance();
+        }
+      }
+    }
+    return summary;
+  }
+
+ private:
+  std::unique_ptr<TickFile> open(uint32_t date,
+                                 TickStoreFormat::Kind kind) const {
+    auto path = TickStoreFormat::filePath(root_, symbol_, date, kind);
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) return nullptr;
+    return std::make_unique<TickFile>(path.string(), kind);
+  }
+
+  // Row position within one file, starting at the first row >= from_ns.
+  template <typename View>
+  struct Cursor {
+    const TickFile *file;
+    size_t block = 0;
+    size_t row = 0;
+    View view{};
+
+    Cursor(const TickFile *f, int64_t from_ns) : file(f) {
+      if (!file) return;
+      block = file->seekBlock(from_ns);
+      if (!load()) return;
+      row = static_cast<size_t>(
+          std::lower_bound(view.time_ns, view.time_ns + view.rows, from_ns) -
+          view.time_ns);
+      if (row == view.rows) advance();
+    }
+
+    int64_t time() const {
+      return file && block < file->blocks() ? view.time_ns[row] : INT64_MAX;
+    }
+
+    void advance() {
+      if (++row < view.rows) return;
+      row = 0;
+      ++block;
+      load();
+    }
+
+    bool load() {
+      while (block < file->blocks()) {
+        if constexpr (std::is_same<View, TradeBlock>::value) {
+          view = file->tradeBlock(block);
+        } else {
+          view = file->bookBlock(block);
+        }
+        if (view.rows > 0) return true;
+        ++block;
+      }
+      return false;
+    }
+  };
+
+  std::string root_;
+  std::string symbol_;
+};
+
+// Tick store switches shared by the executables:
+//   --tick-store=DIR      append every applied trade/book event under DIR
+//   --replay-ticks=DIR    replay DIR instead of connecting
+//   --from=YYYYMMDD, --to=YYYYMMDD
+//                         inclusive UTC day range for --replay-ticks
+// fromArgs() throws std::invalid_argument on a malformed date.
+struct TickStoreOptions {
+  std::string record_dir;
+  std::string replay_dir;
+  int64_t from_ns = INT64_MIN;
+  int64_t to_ns = INT64_MAX;
+
+  static TickStoreOptions fromArgs(int argc, char **argv) {
+    using namespace TickStoreFormat;
+    TickStoreOptions options;
+    options.record_dir = RovoConfig::argValue(argc, argv, "--tick-store");
+    options.replay_dir = RovoConfig::argValue(argc, argv, "--replay-ticks");
+    std::string from = RovoConfig::argValue(argc, argv, "--from");
+    std::string to = RovoConfig::argValue(argc, argv, "--to");
+    if (!from.empty()) {
+      options.from_ns = dateToDay(parseDate("--from", from)) * NANOS_PER_DAY;
+    }
+    if (!to.empty()) {
+      options.to_ns = (dateToDay(parseDate("--to", to)) + 1) * NANOS_PER_DAY;
+    }
+    return options;
+  }
+
+  // YYYYMMDD with a month 1-12 and a day 1-31
+  static uint32_t parseDate(const char *flag, const std::string &value) {
+    uint32_t date = 0;
+    auto [end, ec] =
+        std::from_chars(value.data(), value.data() + value.size(), date);
+    uint32_t month = date / 100 % 100, day = date % 100;
+    if (ec != std::errc() || end != value.data() + value.size() ||
+        value.size() != 8 || month < 1 || month > 12 || day < 1 || day > 31) {
+      throw std::invalid_argument(std::string("Invalid ") + flag + "=" + value +
+                                  ", expected YYYYMMDD");
+    }
+    return date;
+  }
+
+  bool recording() const { return !record_dir.empty(); }
+  bool replaying() const { return !replay_dir.empty(); }
+};
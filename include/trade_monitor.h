@@ -0,0 +1,462 @@
+#pragma once
+#include "event_log.h"
+#include "latency_monitor.h"
+#include "live_config.h"
+#include "market_events.h"
+#include "output_sink.h"
+#include "published_metrics.h"
+#include "rolling_stats.h"
+#include "simple_config.h"
+#include "tick_store.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace ccapi {
+
+// Anomaly detector state for one exchange/symbol. Owned by exactly one
+// worker thread, so nothing in here is shared or locked.
+class TradeMonitor {
+public:
+  static constexpr size_t MAX_AVERAGE_WINDOW_SIZE = 100000;
+
+  // Detector tuning
+  struct Params {
+    double lambda = 0.92; // EWMA decay (0.92 good for high-freq crypto data)
+    double trade_size_multiplier = 3.0;      // 3x average trade size
+    double price_deviation_multiplier = 2.5; // 2.5x average price deviation
+    double volatility_threshold = 0.02;      // 2% volatility
+
+    // trades_ewma_lambda, trades_size_multiplier,
+    // trades_price_deviation_multiplier, trades_volatility_threshold; a
+    // missing key keeps its default. Throws on a value that does not parse
+    // or is out of range (lambda in (0, 1), the others > 0), so a reload
+    // with one keeps the previous params.
+    static Params fromConfig(const SimpleConfig &cfg) {
+      auto read = [&cfg](const char *key, double def) {
+        return cfg.has(key) ? cfg.requireDouble(key) : def;
+      };
+      Params p;
+      p.lambda = read("trades_ewma_lambda", p.lambda);
+      p.trade_size_multiplier =
+          read("trades_size_multiplier", p.trade_size_multiplier);
+      p.price_deviation_multiplier = read("trades_price_deviation_multiplier",
+                                          p.price_deviation_multiplier);
+      p.volatility_threshold =
+          read("trades_volatility_threshold", p.volatility_threshold);
+      p.validate();
+      return p;
+    }
+
+    // Throws std::invalid_argument unless lambda is in (0, 1) and the
+    // others are > 0
+    void validate() const {
+      if (!(lambda > 0.0 && lambda < 1.0)) {
+        throw std::invalid_argument("trades_ewma_lambda must be in (0, 1)");
+      }
+      if (!(trade_size_multiplier > 0.0)) {
+        throw std::invalid_argument("trades_size_multiplier must be > 0");
+      }
+      if (!(price_deviation_multiplier > 0.0)) {
+        throw std::invalid_argument(
+            "trades_price_deviation_multiplier must be > 0");
+      }
+      if (!(volatility_threshold > 0.0)) {
+        throw std::invalid_argument("trades_volatility_threshold must be > 0");
+      }
+    }
+  };
+
+  struct Anomalies {
+    bool price = false;
+    bool size = false;
+    bool volatility = false;
+
+    bool any() const { return price || size || volatility; }
+  };
+
+  // window_size trades back the averages and percentile thresholds. A
+  // non-empty label prefixes the output lines.
+  explicit TradeMonitor(std::string label = "", size_t window_size = 50)
+      : TradeMonitor(std::move(label), window_size, Params()) {}
+
+  TradeMonitor(std::string label, size_t window_size, const Params &params)
+      : label(std::move(label)),
+        AVERAGE_WINDOW_SIZE(
+            std::min(std::max<size_t>(window_size, 2), MAX_AVERAGE_WINDOW_SIZE)),
+        price_stats(AVERAGE_WINDOW_SIZE), volume_stats(AVERAGE_WINDOW_SIZE),
+        price_change_stats(AVERAGE_WINDOW_SIZE - 1),
+        volume_percentile(0.90, TailQuantile::Rank::FLOOR),
+        price_change_percentile(0.95, TailQuantile::Rank::FLOOR),
+        params(params) {}
+
+  size_t windowSize() const { return AVERAGE_WINDOW_SIZE; }
+  size_t tradeCount() const { return trade_count; }
+
+  // Append every trade to a tick store
+  void setTickStore(std::unique_ptr<TickStoreWriter> writer) {
+    tick_writer = std::move(writer);
+  }
+
+  // Publish every trade's snapshot into slot of a shared-memory segment
+  void setPublisher(ShmMetricsPublisher<TradeSnapshot> *publisher,
+                    size_t slot) {
+    shm_publisher = publisher;
+    shm_slot = slot;
+  }
+
+  // Follow tuning republished by a ConfigWatcher: the detector picks up a
+  // new version before its next trade, keeping its windows and EWMA state.
+  // live must outlive the monitor.
+  void setLiveParams(const LiveValue<Params> *live) {
+    live_params = live;
+    params_version = 0;
+  }
+
+  const Params &currentParams() const { return params; }
+
+  void record(int64_t time_ns, double price, double quantity, TradeSide side) {
+    if (tick_writer) tick_writer->appendTrade(time_ns, price, quantity, side);
+  }
+
+  void flush() {
+    if (tick_writer) tick_writer->flush();
+  }
+
+  // Slides the window over one trade and runs the detectors, without
+  // output; onTrade() reports on top of this
+  Anomalies analyze(double price, double quantity) {
+    if (live_params) live_params->refresh(params, params_version);
+    return slide(price, quantity);
+  }
+
+  // received_ns/parsed_ns are LatencyClock stamps of the tick, 0 if untimed
+  void onTrade(double price, double quantity, const TimePoint &time,
+               int64_t received_ns = 0, int64_t parsed_ns = 0) {
+    AllocationSpan allocation_span(latency.allocations, received_ns);
+    Anomalies anomalies = analyze(price, quantity);
+    report(price, quantity, time, anomalies, received_ns, parsed_ns, true);
+  }
+
+  // Consecutive trades of this instrument, each analyzed and reported like
+  // onTrade(), but the tuning is refreshed once per batch and the
+  // shared-memory snapshot published once, for the last trade. Tick has
+  // time_ns, price, quantity, received_ns and parsed_ns members, like
+  // TradesEventHandler::TradeTick.
+  template <typename Tick>
+  void onTrades(const Tick *ticks, size_t count) {
+    if (count == 0) return;
+    AllocationSpan allocation_span(latency.allocations, ticks[0].received_ns,
+                                   count);
+    if (live_params) live_params->refresh(params, params_version);
+    for (size_t i = 0; i < count; ++i) {
+      const Tick &tick = ticks[i];
+      Anomalies anomalies = slide(tick.price, tick.quantity);
+      report(tick.price, tick.quantity,
+             TimePoint(std::chrono::nanoseconds(tick.time_ns)), anomalies,
+             tick.received_ns, tick.parsed_ns, i + 1 == count);
+    }
+  }
+
+private:
+  std::string label;
+
+  // Window sizes for calculations
+  const size_t VOLATILITY_WINDOW_SIZE = 20;
+  const size_t AVERAGE_WINDOW_SIZE;
+  const size_t MIN_TRADES_FOR_ANALYSIS = 10;
+
+  // Sliding window over the last AVERAGE_WINDOW_SIZE trades: running sums
+  // for the averages, order statistics for the thresholds. O(log W) per
+  // trade with no allocation once the window has filled.
+  RollingMoments price_stats;
+  RollingMoments volume_stats;
+  RollingMoments price_change_stats; // |price - previous price|
+  TailQuantile volume_percentile;
+  TailQuantile price_change_percentile;
+  double last_trade_price = 0.0;
+  double previous_trade_price = 0.0;
+  size_t trade_count = 0; // Counter for total trades processed
+
+  // Adaptive thresholds based on market conditions
+  double large_trade_threshold = 1.0; // Will be updated based on market data
+  double price_movement_threshold =
+      100.0; // Will be updated based on market data
+
+  // EWMA volatility state
+  bool ewma_initialized = false;
+  double ewma_variance = 0.0;
+  double previous_price = 0.0;
+
+  // EWMA decay, volatility threshold and the multipliers of the averages
+  // behind the relative thresholds; refreshed from live_params if set
+  Params params;
+  const LiveValue<Params> *live_params = nullptr;
+  uint64_t params_version = 0;
+
+  std::unique_ptr<TickStoreWriter> tick_writer;
+  ShmMetricsPublisher<TradeSnapshot> *shm_publisher = nullptr;
+  size_t shm_slot = 0;
+  PipelineLatency latency = PipelineLatency::get();
+
+  // Slides the window; evicted samples leave the order statistics too
+  Anomalies slide(double price, double quantity) {
+    if (price_stats.count() > 0) {
+      double change = std::abs(price - last_trade_price);
+      price_change_percentile.insert(change);
+      if (auto evicted = price_change_stats.push(change)) {
+        price_change_percentile.erase(*evicted);
+      }
+    }
+    volume_percentile.insert(quantity);
+    if (auto evicted = volume_stats.push(quantity)) {
+      volume_percentile.erase(*evicted);
+    }
+    price_stats.push(price);
+    previous_trade_price = last_trade_price;
+    last_trade_price = price;
+    trade_count++;
+
+    // Update EWMA volatility with new trade
+    updateEWMAVolatility(price);
+
+    // Update adaptive thresholds based on recent data
+    updateAdaptiveThresholds();
+
+    // Perform anomaly detection
+    Anomalies anomalies;
+    anomalies.price = detectPriceAnomaly(price);
+    anomalies.size = detectSizeAnomaly(quantity);
+    anomalies.volatility = detectVolatilityAnomaly();
+    return anomalies;
+  }
+
+  // Queues the trade's line (and the periodic statistics), publishing its
+  // snapshot too if publish is set
+  void report(double price, double quantity, const TimePoint &time,
+              const Anomalies &anomalies, int64_t received_ns,
+              int64_t parsed_ns, bool publish) {
+    int64_t analyzed_ns = LatencyClock::stamp();
+    latency.analyze->recordSpan(parsed_ns, analyzed_ns);
+    // Output and total spans close after the line below is queued
+    LatencySpan output_span(latency.output, analyzed_ns);
+    LatencySpan total_span(latency.total, received_ns);
+
+    if (shm_publisher && publish) {
+      TradeSnapshot snapshot{};
+      snapshot.time_ns = EventLog::toNanos(time);
+      snapshot.trade_count = trade_count;
+      snapshot.price = price;
+      snapshot.quantity = quantity;
+      snapshot.ewma_volatility = getEWMAVolatility();
+      snapshot.large_trade_threshold = large_trade_threshold;
+      snapshot.price_movement_threshold = price_movement_threshold;
+      snapshot.price_anomaly = anomalies.price;
+      snapshot.size_anomaly = anomalies.size;
+      snapshot.volatility_anomaly = anomalies.volatility;
+      shm_publisher->publish(shm_slot, snapshot);
+    }
+
+    // Each report is queued in one piece so shards on other workers
+    // cannot interleave with it
+    OutputLine out;
+    if (!out.active()) return;
+    if (!label.empty()) out << "[" << label << "] ";
+    char timestamp[32];
+
+    // Print current trade information with anomaly flags
+    out << "Trade #" << trade_count << " | Price: $" << std::fixed
+        << std::setprecision(2) << price
+        << " | Size: " << std::fixed << std::setprecision(4)
+        << quantity << " BTC"
+        << " | Price Anomaly: "
+        << (anomalies.price ? "true" : "false")
+        << " | Size Anomaly: "
+        << (anomalies.size ? "true" : "false")
+        << " | Volatility Anomaly: "
+        << (anomalies.volatility ? "true" : "false")
+        << " | Time: " << getFormattedTimestamp(time, timestamp)
+        << "\n";
+
+    // Print statistics every 20 and 50 trades
+    if (trade_count == 20 || trade_count == 50 ||
+        (trade_count > 50 && trade_count % 50 == 0)) {
+      printStatistics(out.stream());
+    }
+  }
+
+  // Helper function to format timestamp into buf, without allocating
+  template <typename Duration>
+  static const char *
+  getFormattedTimestamp(const std::chrono::time_point<std::chrono::system_clock,
+                                                      Duration> &time_point,
+                        char (&buf)[32]) {
+    auto converted_time_point =
+        std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+            time_point);
+    auto time_t = std::chrono::system_clock::to_time_t(converted_time_point);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  time_point.time_since_epoch()) %
+              1000;
+
+    // gmtime_r: monitors format on several worker threads at once
+    std::tm utc{};
+    gmtime_r(&time_t, &utc);
+    size_t n = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &utc);
+    std::snprintf(buf + n, sizeof(buf) - n, ".%03dZ",
+                  static_cast<int>(ms.count()));
+    return buf;
+  }
+
+  // Detect price movement anomalies
+  bool detectPriceAnomaly(double current_price) {
+    if (price_stats.count() < 2) {
+      return false; // Need at least 2 trades to detect price movements
+    }
+
+    // Calculate average price deviation
+    double avg_price_deviation = calculateAveragePriceDeviation();
+    if (avg_price_deviation <= 0) {
+      return false;
+    }
+
+    double price_change = std::abs(current_price - previous_trade_price);
+
+    // Check both absolute and relative thresholds
+    bool absolute_anomaly = price_change > price_movement_threshold;
+    bool relative_anomaly =
+        price_change > (avg_price_deviation * params.price_deviation_multiplier);
+
+    return absolute_anomaly || relative_anomaly;
+  }
+
+  // Detect trade size anomalies
+  bool detectSizeAnomaly(double current_volume) {
+    if (volume_stats.count() < MIN_TRADES_FOR_ANALYSIS) {
+      // For early trades, use absolute threshold only
+      return current_volume > large_trade_threshold;
+    }
+
+    // Calculate average trade size
+    double avg_trade_size = calculateAverageTradeSize();
+    if (avg_trade_size <= 0) {
+      return current_volume > large_trade_threshold;
+    }
+
+    // Check both absolute and relative thresholds
+    bool absolute_anomaly = current_volume > large_trade_threshold;
+    bool relative_anomaly =
+        current_volume > (avg_trade_size * params.trade_size_multiplier);
+
+    return absolute_anomaly || relative_anomaly;
+  }
+
+  // Detect volatility anomalies using EWMA
+  bool detectVolatilityAnomaly() {
+    if (!ewma_initialized) {
+      return false; // Need EWMA to be initialized
+    }
+
+    double current_ewma_volatility = std::sqrt(ewma_variance);
+    return current_ewma_volatility > params.volatility_threshold;
+  }
+
+  // Calculate average trade size
+  double calculateAverageTradeSize() const { return volume_stats.mean(); }
+
+  // Calculate average price deviation
+  double calculateAveragePriceDeviation() const {
+    return price_change_stats.mean();
+  }
+
+  // Calculate average price
+  double calculateAveragePrice() const { return price_stats.mean(); }
+
+  // Update EWMA volatility with new price
+  void updateEWMAVolatility(double current_price) {
+    if (!ewma_initialized) {
+      // Initialize with first price
+      previous_price = current_price;
+      ewma_variance = 0.0001; // Small initial variance (1% daily vol squared)
+      ewma_initialized = true;
+      return;
+    }
+
+    // Calculate return (log return)
+    double return_value = std::log(current_price / previous_price);
+
+    // Update EWMA variance: σ²(t) = λ × σ²(t-1) + (1-λ) × r²(t-1)
+    ewma_variance =
+        params.lambda * ewma_variance +
+        (1.0 - params.lambda) * (return_value * return_value);
+
+    // Update previous price for next iteration
+    previous_price = current_price;
+  }
+
+  // Get current EWMA volatility (standard deviation)
+  double getEWMAVolatility() {
+    if (!ewma_initialized) {
+      return 0.0;
+    }
+    return std::sqrt(ewma_variance);
+  }
+  void updateAdaptiveThresholds() {
+    if (volume_stats.count() < MIN_TRADES_FOR_ANALYSIS) {
+      return;
+    }
+
+    // Set threshold at 90th percentile
+    large_trade_threshold = std::max(1.0, volume_percentile.quantile());
+
+    // Set threshold at 95th percentile
+    if (price_change_percentile.count() > 0) {
+      price_movement_threshold =
+          std::max(10.0, price_change_percentile.quantile());
+    }
+  }
+
+  // Calculate volatility using EWMA method
+  double calculateVolatility() { return getEWMAVolatility(); }
+
+  // Print statistics summary
+  void printStatistics(std::ostream &out) {
+    out << "\n" << Repeat{'=', 80} << "\n";
+    out << label << (label.empty() ? "" : " ") << "STATISTICS AFTER "
+        << trade_count << " TRADES:\n";
+    out << Repeat{'=', 80} << "\n";
+
+    double avg_price = calculateAveragePrice();
+    double avg_trade_size = calculateAverageTradeSize();
+    double current_volatility = calculateVolatility();
+
+    out << "Average Price: $" << std::fixed << std::setprecision(2)
+        << avg_price << "\n";
+    out << "Average Trade Size: " << std::fixed << std::setprecision(4)
+        << avg_trade_size << " BTC\n";
+    out << "EWMA Volatility: " << std::fixed << std::setprecision(4)
+        << (current_volatility * 100) << "%\n";
+    out << "EWMA Variance: " << std::fixed << std::setprecision(8)
+        << ewma_variance << "\n";
+
+    // Additional statistics
+    out << "Current Thresholds:\n";
+    out << "  - Large Trade Threshold: " << std::fixed
+        << std::setprecision(4) << large_trade_threshold << " BTC\n";
+    out << "  - Price Movement Threshold: $" << std::fixed
+        << std::setprecision(2) << price_movement_threshold << "\n";
+    out << "  - Volatility Threshold: " << std::fixed
+        << std::setprecision(2) << (params.volatility_threshold * 100) << "%\n";
+
+    out << "Data Window Size: " << volume_stats.count() << " trades\n";
+    out << Repeat{'=', 80} << "\n\n";
+  }
+};
+
+} // namespace ccapi
@@ -0,0 +1,112 @@
+#pragma once
+#include "market_events.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Compact trade history entries: fixed-point price and size, an enum side
+// and an interned symbol id, 32 bytes with no heap storage.
+
+// Small ids for instrument names, assigned on first sight. Lookups by
+// name hash a string, so intern once at setup and keep the id.
+class SymbolTable {
+ public:
+  static constexpr uint16_t NONE = 0xffff;
+
+  uint16_t intern(std::string_view name) {
+    auto it = ids_.find(std::string(name));
+    if (it != ids_.end()) return it->second;
+    if (names_.size() >= NONE) {
+      throw std::length_error("Too many symbols to intern");
+    }
+    auto id = static_cast<uint16_t>(names_.size());
+    names_.emplace_back(name);
+    ids_.emplace(names_.back(), id);
+    return id;
+  }
+
+  // The id of name, or NONE if it was never interned
+  uint16_t find(std::string_view name) const {
+    auto it = ids_.find(std::string(name));
+    return it == ids_.end() ? NONE : it->second;
+  }
+
+  const std::string &name(uint16_t id) const { return names_.at(id); }
+  size_t size() const { return names_.size(); }
+
+ private:
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, uint16_t> ids_;
+};
+
+// Decimal places an instrument's prices and sizes are kept to. Values are
+// stored as integer multiples of 10^-decimals, so a feed quoting no more
+// decimals than that round-trips exactly.
+class FixedPointScale {
+ public:
+  static constexpr int MAX_DECIMALS = 12;
+
+  explicit FixedPointScale(int decimals = 8)
+      : decimals_(std::clamp(decimals, 0, MAX_DECIMALS)),
+        scale_(std::pow(10.0, decimals_)),
+        limit_(static_cast<double>(std::numeric_limits<int64_t>::max()) /
+               scale_) {}
+
+  int decimals() const { return decimals_; }
+
+  // False, leaving units untouched, for values that are not finite or do
+  // not fit in 64 bits at this scale
+  bool encode(double value, int64_t &units) const {
+    if (!std::isfinite(value) || std::abs(value) >= limit_) return false;
+    units = std::llround(value * scale_);
+    return true;
+  }
+
+  double decode(int64_t units) const {
+    return static_cast<double>(units) / scale_;
+  }
+
+ private:
+  int decimals_;
+  double scale_;
+  double limit_;
+};
+
+struct TradeRecord {
+  int64_t timestamp; // ms since epoch
+  int64_t price;     // in units of the instrument's price scale
+  int64_t amount;    // in units of its size scale
+  uint16_t symbol;   // SymbolTable id
+  TradeSide side;
+  uint8_t reserved[5];
+
+  // Fills out from a decoded trade. Returns false, without throwing, if
+  // price or amount is not positive or does not fit the scales.
+  static bool make(int64_t timestamp_ms, double price, double amount,
+                   TradeSide side, uint16_t symbol,
+                   const FixedPointScale &price_scale,
+                   const FixedPointScale &size_scale, TradeRecord &out) {
+    TradeRecord r{};
+    if (!(price > 0.0) || !(amount > 0.0) ||
+        !price_scale.encode(price, r.price) ||
+        !size_scale.encode(amount, r.amount) || r.price <= 0 ||
+        r.amount <= 0) {
+      return false;
+    }
+    r.timestamp = timestamp_ms;
+    r.symbol = symbol;
+    r.side = side;
+    out = r;
+    return true;
+  }
+};
+static_assert(std::is_trivially_copyable<TradeRecord>::value,
+              "TradeRecord must stay POD");
+static_assert(sizeof(TradeRecord) == 32, "TradeRecord layout");
@@ -0,0 +1,327 @@
+#pragma once
+#include "ccapi_cpp/ccapi_session.h"
+#include "event_log.h"
+#include "latency_monitor.h"
+#include "live_config.h"
+#include "market_events.h"
+#include "output_sink.h"
+#include "published_metrics.h"
+#include "runtime_tuning.h"
+#include "spsc_queue.h"
+#include "tick_store.h"
+#include "trade_monitor.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ccapi {
+
+// Routes trades to one TradeMonitor per exchange/symbol. Monitors are
+// sharded over a fixed pool of worker threads, each monitor pinned to one
+// worker, so a monitor's state is only ever touched by that thread. The
+// ccapi callback thread only decodes trades and enqueues them on the
+// owning worker's ring.
+class TradesEventHandler : public EventHandler {
+public:
+  struct Instrument {
+    std::string exchange;
+    std::string symbol;
+
+    // Correlation id of the subscription and output label
+    std::string key() const { return exchange + ":" + symbol; }
+  };
+
+  struct TradeTick {
+    uint32_t shard;
+    TradeSide side;
+    int64_t time_ns;
+    double price;
+    double quantity;
+    int64_t received_ns; // LatencyClock stamps, 0 while untimed
+    int64_t parsed_ns;
+  };
+
+  using TradeQueue = SpscQueue<TradeTick>;
+
+  struct WorkerStats {
+    size_t shards = 0;
+    uint64_t trades = 0;
+    TradeQueue::Stats queue;
+  };
+
+  TradesEventHandler(const std::vector<Instrument> &instruments, size_t window_size,
+                     const TradeMonitor::Params &params, size_t workers,
+                     size_t queue_capacity = 65536,
+                     TradeQueue::OverflowPolicy policy =
+                         TradeQueue::OverflowPolicy::DROP)
+      : instruments(instruments) {
+    bool labelled = instruments.size() > 1;
+    for (size_t i = 0; i < instruments.size(); ++i) {
+      const auto key = instruments[i].key();
+      shard_index.emplace(key, i);
+      skew_latency.push_back(
+          &LatencyMonitor::instance().skew(instruments[i].exchange));
+      monitors.push_back(
+          std::make_unique<TradeMonitor>(labelled ? key : "", window_size, params));
+    }
+    workers = std::max<size_t>(1, std::min(workers, instruments.size()));
+    for (size_t w = 0; w < workers; ++w) {
+      pool.push_back(std::make_unique<Worker>(queue_capacity, policy));
+    }
+    for (size_t i = 0; i < monitors.size(); ++i) {
+      pool[i % workers]->shards.push_back(monitors[i].get());
+    }
+    for (size_t w = 0; w < workers; ++w) {
+      pool[w]->thread = std::thread([this, w] { workerLoop(*pool[w]); });
+    }
+  }
+
+  ~TradesEventHandler() override { stop(); }
+
+  // Stops the workers once the queued trades are applied
+  void stop() {
+    running.store(false, std::memory_order_release);
+    for (auto &worker : pool) {
+      if (worker->thread.joinable()) worker->thread.join();
+    }
+    for (auto &monitor : monitors) monitor->flush();
+  }
+
+  size_t workerCount() const { return pool.size(); }
+
+  std::vector<WorkerStats> getWorkerStats() const {
+    std::vector<WorkerStats> stats;
+    for (const auto &worker : pool) {
+      WorkerStats s;
+      s.shards = worker->shards.size();
+      s.trades = worker->trades.load(std::memory_order_relaxed);
+      s.queue = worker->queue.stats();
+      stats.push_back(s);
+    }
+    return stats;
+  }
+
+  // One subscription per instrument, tagged with its shard's correlation id
+  std::vector<Subscription> subscriptions(const std::string &channel) const {
+    std::vector<Subscription> out;
+    for (const auto &instrument : instruments) {
+      out.emplace_back(instrument.exchange, instrument.symbol, channel, "",
+                       instrument.key());
+    }
+    return out;
+  }
+
+  // Tick store stream name: the symbol, qualified by exchange when the
+  // same symbol is monitored on several venues
+  std::string storeName(size_t shard) const {
+    const auto &instrument = instruments[shard];
+    size_t same = std::count_if(
+        instruments.begin(), instruments.end(),
+        [&](const Instrument &other) { return other.symbol == instrument.symbol; });
+    return same > 1 ? instrument.exchange + "_" + instrument.symbol
+                    : instrument.symbol;
+  }
+
+  size_t shardCount() const { return monitors.size(); }
+
+  // Publish each instrument's latest trade into the shared-memory segment
+  // name, one slot per "exchange:symbol". Call before subscribing.
+  void setSharedMemory(const std::string &name) {
+    std::vector<std::string> slots;
+    for (const auto &instrument : instruments) slots.push_back(instrument.key());
+    shm_publisher = std::make_unique<ShmMetricsPublisher<TradeSnapshot>>(
+        name, ShmMetricsFormat::Tag::TRADES, slots);
+    for (size_t i = 0; i < monitors.size(); ++i) {
+      monitors[i]->setPublisher(shm_publisher.get(), i);
+    }
+  }
+
+  // Every shard follows the detector tuning published in live. Call before
+  // subscribing; live must outlive the handler.
+  void setLiveParams(const LiveValue<TradeMonitor::Params> *live) {
+    for (auto &monitor : monitors) monitor->setLiveParams(live);
+  }
+
+  // Append every trade to per-shard tick stores under root
+  void setTickStore(const std::string &root) {
+    for (size_t i = 0; i < monitors.size(); ++i) {
+      monitors[i]->setTickStore(
+          std::make_unique<TickStoreWriter>(root, storeName(i)));
+    }
+  }
+
+  // Runs each shard's detector over its tick store on the calling thread,
+  // instead of the live feed
+  TickStore::Summary replayTickStore(const std::string &root, int64_t from_ns,
+                                     int64_t to_ns) {
+    TickStore::Summary total;
+    for (size_t i = 0; i < monitors.size(); ++i) {
+      TradeMonitor &monitor = *monitors[i];
+      auto summary = TickStore(root, storeName(i))
+                         .replay(
+                             [&monitor](int64_t time_ns, double price,
+                                        double quantity, TradeSide) {
+                               monitor.onTrade(
+                                   price, quantity,
+                                   TimePoint(std::chrono::nanoseconds(time_ns)));
+                             },
+                             [](int64_t, bool, const double *, const double *,
+                                size_t, const double *, const double *, size_t) {},
+                             from_ns, to_ns);
+      total.trades += summary.trades;
+      total.books += summary.books;
+      total.days = std::max(total.days, summary.days);
+    }
+    return total;
+  }
+
+  // Queues a trade of shard decoded elsewhere, e.g. by a MarketDataBus
+  // shared with other modules, on the shard's worker
+  void onTrade(size_t shard, const MarketEvent &ev) {
+    if (shard >= monitors.size() || ev.type != MarketEvent::Type::TRADE) return;
+    TradeTick tick;
+    tick.shard = static_cast<uint32_t>(shard);
+    tick.side = ev.trade.side;
+    tick.time_ns = ev.exchange_time_ns;
+    tick.price = ev.trade.price;
+    tick.quantity = ev.trade.amount;
+    tick.received_ns = ev.received_stamp;
+    tick.parsed_ns = ev.parsed_stamp;
+    pool[shard % pool.size()]->queue.push(tick);
+  }
+
+  void processEvent(const Event &event, Session *session) override {
+    RuntimeTuning::instance().pinCallbackThread();
+    if (event.getType() == Event::Type::SUBSCRIPTION_STATUS) {
+      OutputLine(OutputLevel::INFO)
+          << "Received an event of type SUBSCRIPTION_STATUS:\n"
+          << event.toPrettyString(2, 2) << "\n";
+    } else if (event.getType() == Event::Type::SUBSCRIPTION_DATA) {
+      int64_t received_ns = LatencyClock::stamp();
+      for (const auto &message : event.getMessageList()) {
+        // Process trade data
+        if (message.getType() == Message::Type::MARKET_DATA_EVENTS_TRADE) {
+          size_t shard;
+          if (!route(message, shard)) continue;
+          if (received_ns != 0) {
+            skew_latency[shard]->record(
+                EventLog::toNanos(message.getTimeReceived()) -
+                EventLog::toNanos(message.getTime()));
+          }
+          for (const auto &element : message.getElementList()) {
+            const std::map<std::string_view, std::string> &elementNameValueMap =
+                element.getNameValueMap();
+
+            // Extract price and quantity from trade
+            auto priceIt = elementNameValueMap.find("LAST_PRICE");
+            auto quantityIt = elementNameValueMap.find("LAST_SIZE");
+
+            if (priceIt == elementNameValueMap.end() ||
+                quantityIt == elementNameValueMap.end()) {
+              OutputLine error(OutputLevel::ERROR);
+              error << "Error: Missing required fields. Available fields: ";
+              for (const auto &pair : elementNameValueMap) {
+                error << pair.first << " ";
+              }
+              error << "\n";
+              continue;
+            }
+
+            TradeTick tick;
+            tick.shard = static_cast<uint32_t>(shard);
+            tick.time_ns = EventLog::toNanos(message.getTime());
+            tick.price = std::stod(priceIt->second);
+            tick.quantity = std::stod(quantityIt->second);
+
+            // Aggressor side, when the feed reports the maker flag
+            auto makerIt = elementNameValueMap.find("IS_BUYER_MAKER");
+            tick.side = makerIt == elementNameValueMap.end()
+                            ? TradeSide::UNKNOWN
+                        : makerIt->second == "1" ? TradeSide::SELL
+                                                 : TradeSide::BUY;
+            tick.received_ns = received_ns;
+            tick.parsed_ns = LatencyClock::stamp();
+            parse_latency->recordSpan(received_ns, tick.parsed_ns);
+            pool[shard % pool.size()]->queue.push(tick);
+          }
+        }
+      }
+    }
+  }
+
+private:
+  static constexpr size_t CONSUMER_BATCH = 256;
+
+  struct Worker {
+    Worker(size_t queue_capacity, TradeQueue::OverflowPolicy policy)
+        : queue(queue_capacity, policy) {}
+
+    TradeQueue queue;
+    std::vector<TradeMonitor *> shards; // fixed before the thread starts
+    std::atomic<uint64_t> trades{0};
+    std::thread thread;
+  };
+
+  // Shard of the message's correlation id. With a single instrument every
+  // message belongs to it, so sessions recorded before ids were assigned
+  // still replay.
+  bool route(const Message &message, size_t &shard) const {
+    if (monitors.size() == 1) {
+      shard = 0;
+      return true;
+    }
+    for (const auto &id : message.getCorrelationIdList()) {
+      auto it = shard_index.find(id);
+      if (it != shard_index.end()) {
+        shard = it->second;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Drains the worker's ring in batches; each run of consecutive ticks of
+  // one shard reaches its monitor as one batch
+  void workerLoop(Worker &worker) {
+    auto &tuning = RuntimeTuning::instance();
+    tuning.pinThisThread(RuntimeTuning::Role::ANALYZER);
+    auto apply = [this, &worker](const TradeTick *ticks, size_t count) {
+      for (size_t i = 0; i < count;) {
+        size_t end = i + 1;
+        while (end < count && ticks[end].shard == ticks[i].shard) ++end;
+        TradeMonitor &monitor = *monitors[ticks[i].shard];
+        for (size_t k = i; k < end; ++k) {
+          monitor.record(ticks[k].time_ns, ticks[k].price, ticks[k].quantity,
+                         ticks[k].side);
+        }
+        monitor.onTrades(ticks + i, end - i);
+        i = end;
+      }
+      worker.trades.store(worker.trades.load(std::memory_order_relaxed) + count,
+                          std::memory_order_relaxed);
+    };
+    while (running.load(std::memory_order_acquire)) {
+      if (worker.queue.consumeRuns(apply, CONSUMER_BATCH) == 0) {
+        tuning.idle(std::chrono::microseconds(100));
+      }
+    }
+    worker.queue.consumeRuns(apply); // drain what is left
+  }
+
+  std::vector<Instrument> instruments;
+  std::unordered_map<std::string, size_t> shard_index;
+  std::unique_ptr<ShmMetricsPublisher<TradeSnapshot>> shm_publisher;
+  std::vector<std::unique_ptr<TradeMonitor>> monitors;
+  std::vector<std::unique_ptr<Worker>> pool;
+  std::atomic<bool> running{true};
+  LatencyHistogram *parse_latency = PipelineLatency::get().parse;
+  std::vector<LatencyHistogram *> skew_latency; // per shard, by exchange
+};
+
+} // namespace ccapi
@@ -0,0 +1,142 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads running batches of independent tasks.
+// run() deals the task indices out as contiguous ranges, one per worker;
+// a worker takes its own tasks from the front of its deque and, once that
+// is empty, steals from the back of the others', so uneven tasks still
+// finish together. Tasks are coarse (milliseconds and up), so each deque
+// is guarded by a plain mutex.
+class WorkStealingPool {
+ public:
+  // threads 0 = one per core
+  explicit WorkStealingPool(size_t threads = 0) {
+    if (threads == 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t w = 0; w < threads; ++w) {
+      queues_.push_back(std::make_unique<Queue>());
+    }
+    for (size_t w = 0; w < threads; ++w) {
+      workers_.emplace_back([this, w] { workerLoop(w); });
+    }
+  }
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    start_.notify_all();
+    for (auto &worker : workers_) worker.join();
+  }
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  size_t threads() const { return workers_.size(); }
+
+  // Runs task(index, worker) for every index in [0, count) and returns
+  // once all have finished. The first exception a task throws is
+  // rethrown here after the rest have run. Not reentrant.
+  void run(size_t count, const std::function<void(size_t, size_t)> &task) {
+    if (count == 0) return;
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_ = &task;
+    remaining_ = count;
+    error_ = nullptr;
+    size_t n = queues_.size();
+    for (size_t w = 0; w < n; ++w) {
+      std::lock_guard<std::mutex> queue_lock(queues_[w]->mutex);
+      for (size_t i = w * count / n; i < (w + 1) * count / n; ++i) {
+        queues_[w]->tasks.push_back(i);
+      }
+    }
+    ++generation_;
+    start_.notify_all();
+    // Also wait out workers still looking for work, so none can pick up
+    // the next run's tasks with this run's function
+    done_.wait(lock, [this] { return remaining_ == 0 && active_ == 0; });
+    task_ = nullptr;
+    if (error_) std::rethrow_exception(error_);
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+
+  bool take(size_t worker, size_t &index) {
+    {
+      Queue &own = *queues_[worker];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+        index = own.tasks.front();
+        own.tasks.pop_front();
+        return true;
+      }
+    }
+    for (size_t k = 1; k < queues_.size(); ++k) {
+      Queue &victim = *queues_[(worker + k) % queues_.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        index = victim.tasks.back();
+        victim.tasks.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void workerLoop(size_t worker) {
+    uint64_t seen = 0;
+    while (true) {
+      const std::function<void(size_t, size_t)> *task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+        if (stopping_) return;
+        seen = generation_;
+        task = task_;
+        if (!task) continue; // woke after the run had finished
+        ++active_;
+      }
+      size_t index;
+      while (take(worker, index)) {
+        try {
+          (*task)(index, worker);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (!error_) error_ = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--remaining_ == 0) done_.notify_one();
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--active_ == 0) done_.notify_one();
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  const std::function<void(size_t, size_t)> *task_ = nullptr;
+  size_t remaining_ = 0; // tasks not yet finished
+  size_t active_ = 0;    // workers inside the current run
+  uint64_t generation_ = 0;
+  bool stopping_ = false;
+  std::exception_ptr error_;
+};
@@ -0,0 +1,125 @@
+#include "allocation_counter_operators.h"
+#include "analytics_modules.h"
+#include "ccapi_cpp/ccapi_session.h"
+#include "event_log.h"
+#include "latency_monitor.h"
+#include "live_config.h"
+#include "market_data_bus.h"
+#include "output_sink.h"
+#include "runtime_tuning.h"
+#include "simple_config.h"
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ccapi {
+Logger *Logger::logger = nullptr; // This line is needed.
+} // namespace ccapi
+
+// Liquidity, trades, arbitrage and options analytics in one process: one
+// ccapi session subscribes the union of the enabled modules' streams, and
+// a MarketDataBus decodes each message once and fans it out.
+int main(int argc, char **argv) {
+  using namespace ccapi;
+
+  std::string cfgPath = RovoConfig::resolveConfigPathFromArgs(argc, argv);
+  SimpleConfig cfg;
+  if (!cfg.loadFromFile(cfgPath)) {
+    std::cerr << "Missing config file: " << cfgPath << std::endl;
+    return 1;
+  }
+
+  // A replay must not drop events or reports, so it always applies
+  // backpressure
+  EventLogOptions log_options;
+  try {
+    log_options = EventLogOptions::fromArgs(argc, argv);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << e.what() << std::endl;
+    std::cerr << "Usage: analytics_host [--config PATH] [--record=LOG | --replay=LOG "
+                 "[--replay-speed=X]]"
+              << std::endl;
+    return 1;
+  }
+  auto output_options = OutputSink::Options::fromConfig(cfg);
+  if (log_options.replaying()) output_options.block_when_full = true;
+  try {
+    RuntimeTuning::instance().configure(RuntimeOptions::fromConfig(cfg));
+    OutputSink::instance().configure(output_options);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  LatencyMonitor::instance().configure(LatencyMonitor::Options::fromConfig(cfg));
+
+  MarketDataBus bus;
+  std::vector<std::unique_ptr<MarketDataModule>> modules;
+  // Declared after the modules so it stops before they go away
+  ConfigWatcher watcher(cfgPath, ConfigWatcher::Options::fromConfig(cfg));
+  try {
+    for (const auto &name : cfg.getStringList(
+             "host_modules", {"liquidity", "trades", "arbitrage", "options"})) {
+      modules.push_back(makeAnalyticsModule(name, cfg, log_options.replaying()));
+      modules.back()->watchConfig(watcher);
+      bus.add(*modules.back());
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  if (modules.empty()) {
+    std::cerr << "host_modules enables no modules" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Starting analytics host with " << modules.size()
+            << " modules over " << bus.streamCount() << " streams" << std::endl;
+  for (size_t i = 0; i < bus.streamCount(); ++i) {
+    std::cout << "  " << bus.stream(i).key() << " -> " << bus.subscriberCount(i)
+              << (bus.subscriberCount(i) == 1 ? " module" : " modules")
+              << std::endl;
+  }
+
+  auto finish = [&] {
+    watcher.stop();
+    bus.stop();
+    LatencyMonitor::instance().report();
+    OutputSink::instance().flush();
+    for (auto &module : modules) module->printSummary(std::cout);
+    const auto &stats = bus.stats();
+    std::cout << "Bus: " << stats.messages << " messages, " << stats.events
+              << " events, " << stats.unrouted << " unrouted" << std::endl;
+  };
+
+  bus.start();
+  watcher.start();
+  if (log_options.replaying()) {
+    bool replayed = replayEventLog(log_options, bus);
+    finish();
+    return replayed ? 0 : 1;
+  }
+
+  SessionOptions sessionOptions;
+  SessionConfigs sessionConfigs;
+  SessionRecording recording(log_options, bus);
+  Session session(sessionOptions, sessionConfigs, recording.handler());
+
+  auto subscriptions = bus.subscriptions();
+  try {
+    session.subscribe(subscriptions);
+    std::cout << "Listening for market data... (Press Ctrl+C to exit)"
+              << std::endl;
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  finish();
+  return 0;
+}
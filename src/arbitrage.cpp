@@ -1,222 +1,23 @@
+#include "allocation_counter_operators.h"
+#include "arbitrage_monitor.h"
 #include "ccapi_cpp/ccapi_session.h"
+#include "event_log.h"
+#include "live_config.h"
+#include "output_sink.h"
+#include "runtime_tuning.h"
 #include "simple_config.h"
+#include <algorithm>
 #include <chrono>
-#include <ctime>
-#include <iomanip>
 #include <iostream>
 #include <limits>
 #include <map>
+#include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 namespace ccapi {
 
-class ArbitrageMonitor {
-private:
-  struct ExchangeData {
-    double bid = 0.0;
-    double ask = 0.0;
-    double bid_volume = 0.0;
-    double ask_volume = 0.0;
-    std::chrono::system_clock::time_point last_update;
-    bool has_data = false;
-  };
-
-  ExchangeData binance_data;
-  ExchangeData bybit_data;
-
-  // Configuration (loaded from config.txt if present)
-  double min_price_diff = 1.0;   // Minimum $1 difference
-  double profit_threshold = 0.5; // Minimum $0.5 profit threshold
-
-public:
-  void setConfig(double minDiff, double profitThres) {
-    this->min_price_diff = minDiff;
-    this->profit_threshold = profitThres;
-  }
-  void printHeader() {
-    std::cout << std::left;
-    std::cout << std::setw(12) << "Time" << " | ";
-    std::cout << std::setw(11) << "Bin_Bid" << " | ";
-    std::cout << std::setw(11) << "Bin_Ask" << " | ";
-    std::cout << std::setw(10) << "Bin_BVol" << " | ";
-    std::cout << std::setw(10) << "Bin_AVol" << " | ";
-    std::cout << std::setw(11) << "Byb_Bid" << " | ";
-    std::cout << std::setw(11) << "Byb_Ask" << " | ";
-    std::cout << std::setw(10) << "Byb_BVol" << " | ";
-    std::cout << std::setw(10) << "Byb_AVol" << " | ";
-    std::cout << std::setw(9) << "Bid_Diff" << " | ";
-    std::cout << std::setw(9) << "Ask_Diff" << " | ";
-    std::cout << std::setw(8) << "Bid_%" << " | ";
-    std::cout << std::setw(8) << "Ask_%" << " | ";
-    std::cout << std::setw(18) << "Best_Direction" << " | ";
-    std::cout << std::setw(12) << "Profit_$" << " | ";
-    std::cout << std::setw(8) << "Lat_ms";
-    std::cout << std::endl;
-
-    // Print separator line with proper length
-    std::cout << std::string(12, '-') << "-+-";
-    std::cout << std::string(11, '-') << "-+-";
-    std::cout << std::string(11, '-') << "-+-";
-    std::cout << std::string(10, '-') << "-+-";
-    std::cout << std::string(10, '-') << "-+-";
-    std::cout << std::string(11, '-') << "-+-";
-    std::cout << std::string(11, '-') << "-+-";
-    std::cout << std::string(10, '-') << "-+-";
-    std::cout << std::string(10, '-') << "-+-";
-    std::cout << std::string(9, '-') << "-+-";
-    std::cout << std::string(9, '-') << "-+-";
-    std::cout << std::string(8, '-') << "-+-";
-    std::cout << std::string(8, '-') << "-+-";
-    std::cout << std::string(18, '-') << "-+-";
-    std::cout << std::string(12, '-') << "-+-";
-    std::cout << std::string(8, '-') << std::endl;
-  }
-
-  std::string getCurrentTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                  now.time_since_epoch()) %
-              1000;
-
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%H:%M:%S");
-    ss << "." << std::setfill('0') << std::setw(3) << ms.count();
-    return ss.str();
-  }
-
-  void calculateAndPrint() {
-    if (!binance_data.has_data || !bybit_data.has_data) {
-      return; // Wait for both exchanges to have data
-    }
-
-    // Calculate differences
-    double bid_diff_dollar = binance_data.bid - bybit_data.bid;
-    double ask_diff_dollar = binance_data.ask - bybit_data.ask;
-
-    double bid_diff_percent = (bid_diff_dollar / bybit_data.bid) * 100;
-    double ask_diff_percent = (ask_diff_dollar / bybit_data.ask) * 100;
-
-    // Check for arbitrage opportunities
-    bool bid_arbitrage = std::abs(bid_diff_dollar) >= min_price_diff;
-    bool ask_arbitrage = std::abs(ask_diff_dollar) >= min_price_diff;
-
-    // Determine best direction and potential profit
-    std::string best_direction = "None";
-    double potential_profit = 0.0;
-
-    // Cross-exchange arbitrage: buy low, sell high
-    double arb1 = binance_data.ask - bybit_data.bid; // Buy Bybit, Sell Binance
-    double arb2 = bybit_data.ask - binance_data.bid; // Buy Binance, Sell Bybit
-
-    if (arb1 > profit_threshold && arb1 > arb2) {
-      best_direction = "Buy_Bybit";
-      potential_profit = arb1;
-    } else if (arb2 > profit_threshold) {
-      best_direction = "Buy_Binance";
-      potential_profit = arb2;
-    }
-
-    // Calculate latency (time since last update)
-    auto now = std::chrono::system_clock::now();
-    auto binance_latency =
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - binance_data.last_update)
-            .count();
-    auto bybit_latency = std::chrono::duration_cast<std::chrono::milliseconds>(
-                             now - bybit_data.last_update)
-                             .count();
-    auto max_latency = std::max(binance_latency, bybit_latency);
-
-    // Print the data row with consistent formatting
-    std::cout << std::left << std::fixed;
-    std::cout << std::setw(12) << std::setprecision(0) << getCurrentTimestamp()
-              << " | ";
-    std::cout << std::setw(11) << std::setprecision(2) << binance_data.bid
-              << " | ";
-    std::cout << std::setw(11) << std::setprecision(2) << binance_data.ask
-              << " | ";
-    std::cout << std::setw(10) << std::setprecision(3)
-              << binance_data.bid_volume << " | ";
-    std::cout << std::setw(10) << std::setprecision(3)
-              << binance_data.ask_volume << " | ";
-    std::cout << std::setw(11) << std::setprecision(2) << bybit_data.bid
-              << " | ";
-    std::cout << std::setw(11) << std::setprecision(2) << bybit_data.ask
-              << " | ";
-    std::cout << std::setw(10) << std::setprecision(3) << bybit_data.bid_volume
-              << " | ";
-    std::cout << std::setw(10) << std::setprecision(3) << bybit_data.ask_volume
-              << " | ";
-    std::cout << std::setw(9) << std::setprecision(2) << bid_diff_dollar
-              << " | ";
-    std::cout << std::setw(9) << std::setprecision(2) << ask_diff_dollar
-              << " | ";
-    std::cout << std::setw(8) << std::setprecision(3) << bid_diff_percent
-              << " | ";
-    std::cout << std::setw(8) << std::setprecision(3) << ask_diff_percent
-              << " | ";
-    std::cout << std::setw(18) << best_direction << " | ";
-    std::cout << std::setw(12) << std::setprecision(2) << potential_profit
-              << " | ";
-    std::cout << std::setw(8) << std::setprecision(0) << max_latency;
-    std::cout << std::endl;
-  }
-
-  void updateBinanceData(const Message &message) {
-    bool updated = false;
-    for (const auto &element : message.getElementList()) {
-      if (element.has("BID_PRICE")) {
-        binance_data.bid = std::stod(element.getValue("BID_PRICE"));
-        if (element.has("BID_SIZE")) {
-          binance_data.bid_volume = std::stod(element.getValue("BID_SIZE"));
-        }
-        updated = true;
-      }
-      if (element.has("ASK_PRICE")) {
-        binance_data.ask = std::stod(element.getValue("ASK_PRICE"));
-        if (element.has("ASK_SIZE")) {
-          binance_data.ask_volume = std::stod(element.getValue("ASK_SIZE"));
-        }
-        updated = true;
-      }
-    }
-
-    if (updated) {
-      binance_data.last_update = std::chrono::system_clock::now();
-      binance_data.has_data = true;
-      calculateAndPrint();
-    }
-  }
-
-  void updateBybitData(const Message &message) {
-    bool updated = false;
-    for (const auto &element : message.getElementList()) {
-      if (element.has("BID_PRICE")) {
-        bybit_data.bid = std::stod(element.getValue("BID_PRICE"));
-        if (element.has("BID_SIZE")) {
-          bybit_data.bid_volume = std::stod(element.getValue("BID_SIZE"));
-        }
-        updated = true;
-      }
-      if (element.has("ASK_PRICE")) {
-        bybit_data.ask = std::stod(element.getValue("ASK_PRICE"));
-        if (element.has("ASK_SIZE")) {
-          bybit_data.ask_volume = std::stod(element.getValue("ASK_SIZE"));
-        }
-        updated = true;
-      }
-    }
-
-    if (updated) {
-      bybit_data.last_update = std::chrono::system_clock::now();
-      bybit_data.has_data = true;
-      calculateAndPrint();
-    }
-  }
-};
-
 class MyEventHandler : public EventHandler {
 private:
   ArbitrageMonitor &monitor;
@@ -225,19 +26,12 @@ public:
   MyEventHandler(ArbitrageMonitor &mon) : monitor(mon) {}
 
   void processEvent(const Event &event, Session *session) override {
+    RuntimeTuning::instance().pinCallbackThread();
     if (event.getType() == Event::Type::SUBSCRIPTION_DATA) {
-      for (const auto &message : event.getMessageList()) {
-        std::string exchange = message.getCorrelationIdList().at(0);
-
-        if (exchange == "binance") {
-          monitor.updateBinanceData(message);
-        } else if (exchange == "bybit") {
-          monitor.updateBybitData(message);
-        }
-      }
+      monitor.onMessages(event.getMessageList());
     } else if (event.getType() == Event::Type::SUBSCRIPTION_STATUS) {
-      std::cout << "Subscription Status: " << event.toPrettyString()
-                << std::endl;
+      OutputLine() << "Subscription Status: " << event.toPrettyString()
+                   << "\n";
     }
   }
 };
@@ -248,20 +42,6 @@ Logger *Logger::logger = nullptr; // This line is needed.
 
 int main(int argc, char** argv) {
   using namespace ccapi;
-  std::cout << "BTC/USDT Arbitrage Monitor - Real-time Data Stream"
-            << std::endl;
-  std::cout << "Monitoring Binance vs Bybit for arbitrage opportunities..."
-            << std::endl;
-  std::cout << std::endl;
-
-  ArbitrageMonitor monitor;
-  monitor.printHeader();
-
-  // Initialize CCAPI Session
-  SessionOptions sessionOptions;
-  SessionConfigs sessionConfigs;
-  MyEventHandler eventHandler(monitor);
-  Session session(sessionOptions, sessionConfigs, &eventHandler);
 
   // Load config (required)
   SimpleConfig cfg;
@@ -270,20 +50,101 @@ int main(int argc, char** argv) {
     std::cerr << "Missing config.txt" << std::endl;
     return 1;
   }
-  double cfg_min_price_diff = cfg.requireDouble("arb_min_price_diff");
-  double cfg_profit_threshold = cfg.requireDouble("arb_profit_threshold");
-  std::string symbol = cfg.requireString("arb_symbol");
-  monitor.setConfig(cfg_min_price_diff, cfg_profit_threshold);
+  auto cfg_thresholds = ArbitrageThresholds::fromConfig(cfg);
+  auto venues = cfg.getStringList("arb_venues", {"binance", "bybit"});
+  auto symbols = cfg.getStringList("arb_symbols");
+  if (symbols.empty()) symbols.push_back(cfg.requireString("arb_symbol"));
+  if (venues.size() < 2) {
+    std::cerr << "arb_venues needs at least two venues" << std::endl;
+    return 1;
+  }
+
+  // Table rows go through the asynchronous sink; a replay never drops them
+  EventLogOptions log_options;
+  try {
+    log_options = EventLogOptions::fromArgs(argc, argv);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << e.what() << std::endl;
+    std::cerr << "Usage: arbitrage [--config PATH] [--record=LOG | --replay=LOG "
+                 "[--replay-speed=X]]"
+              << std::endl;
+    return 1;
+  }
+  auto output_options = OutputSink::Options::fromConfig(cfg);
+  if (log_options.replaying()) output_options.block_when_full = true;
+  try {
+    RuntimeTuning::instance().configure(RuntimeOptions::fromConfig(cfg));
+    OutputSink::instance().configure(output_options);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  LatencyMonitor::instance().configure(LatencyMonitor::Options::fromConfig(cfg));
+
+  std::cout << "Arbitrage Monitor - Real-time Data Stream" << std::endl;
+  std::cout << "Monitoring " << venues.size() << " venues x " << symbols.size()
+            << " symbols for arbitrage opportunities..." << std::endl;
+  std::cout << std::endl;
+
+  // Thresholds follow config file edits (config_reload=1) without
+  // dropping the books
+  LiveValue<ArbitrageThresholds> live_thresholds(cfg_thresholds);
+  ConfigWatcher watcher(cfgPath, ConfigWatcher::Options::fromConfig(cfg));
+  watcher.onReload([&live_thresholds](const SimpleConfig &reloaded) {
+    live_thresholds.publish(ArbitrageThresholds::fromConfig(reloaded));
+  });
+
+  ArbitrageMonitor monitor(venues, symbols);
+  monitor.setConfig(cfg_thresholds.min_price_diff, cfg_thresholds.profit_threshold);
+  monitor.setLiveThresholds(&live_thresholds);
+  // Taker fee per venue as a fraction of notional: arb_taker_fee_<venue>,
+  // falling back to arb_taker_fee
+  double default_fee = cfg.getDouble("arb_taker_fee", 0.0);
+  for (size_t v = 0; v < venues.size(); ++v) {
+    monitor.setTakerFee(v, cfg.getDouble("arb_taker_fee_" + venues[v], default_fee));
+  }
+  // Book levels kept per venue for sizing
+  int depth_levels = std::min(cfg.getInt("arb_depth_levels", 5),
+                              static_cast<int>(ArbitrageMatrix::Book::CAPACITY));
+  std::string shm_name = cfg.getString("arb_shm_name", "");
+  if (!shm_name.empty()) {
+    try {
+      monitor.setSharedMemory(shm_name);
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+  }
+  monitor.printHeader();
+  watcher.start();
 
-  // Subscribe to Binance BTC/USDT (or symbol from config)
-  Subscription subscriptionBinance("binance", symbol, "MARKET_DEPTH", "",
-                                   "binance");
-  session.subscribe(subscriptionBinance);
+  MyEventHandler eventHandler(monitor);
+  if (log_options.replaying()) {
+    if (!replayEventLog(log_options, eventHandler)) return 1;
+    LatencyMonitor::instance().report();
+    OutputSink::instance().flush();
+    return 0;
+  }
 
-  // Subscribe to Bybit BTC/USDT (or symbol from config)
-  Subscription subscriptionBybit("bybit", symbol, "MARKET_DEPTH", "",
-                                 "bybit");
-  session.subscribe(subscriptionBybit);
+  // Initialize CCAPI Session
+  SessionOptions sessionOptions;
+  SessionConfigs sessionConfigs;
+  SessionRecording recording(log_options, eventHandler);
+  Session session(sessionOptions, sessionConfigs, recording.handler());
+
+  // One depth subscription per venue and symbol, tagged with its matrix
+  // slot
+  std::string depth_options;
+  if (depth_levels > 1) depth_options = "MARKET_DEPTH_MAX=" + std::to_string(depth_levels);
+  std::vector<Subscription> subscriptions;
+  for (size_t s = 0; s < monitor.symbolCount(); ++s) {
+    for (size_t v = 0; v < monitor.venueCount(); ++v) {
+      subscriptions.emplace_back(monitor.venueName(v), monitor.symbolName(s),
+                                 "MARKET_DEPTH", depth_options,
+                                 monitor.correlationId(v, s));
+    }
+  }
+  session.subscribe(subscriptions);
 
   std::cout << "Connecting to exchanges..." << std::endl;
   std::cout << "Press Ctrl+C to stop..." << std::endl;
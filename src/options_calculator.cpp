@@ -1,10 +1,17 @@
+#include "allocation_counter_operators.h"
 #include "ccapi_cpp/ccapi_session.h"
+#include "event_log.h"
+#include "latency_monitor.h"
+#include "options_handler.h"
+#include "output_sink.h"
+#include "runtime_tuning.h"
 #include "simple_config.h"
-#include <cmath>
+#include <chrono>
 #include <fstream>
-#include <iomanip>
+#include <iostream>
 #include <map>
-#include <sstream>
+#include <string>
+#include <thread>
 
 namespace ccapi { Logger* Logger::logger = nullptr; }
 
@@ -28,242 +35,6 @@ std::map<std::string, std::string> loadEnv() {
   return env;
 }
 
-// Mathematical functions for Black-Scholes
-class BlackScholesCalculator {
-private:
-  // Cumulative standard normal distribution
-  static double normalCDF(double x) {
-    return 0.5 * (1.0 + std::erf(x / std::sqrt(2.0)));
-  }
-
-  // Standard normal probability density function
-  static double normalPDF(double x) {
-    return (1.0 / std::sqrt(2.0 * M_PI)) * std::exp(-0.5 * x * x);
-  }
-
-  // Calculate d1 parameter
-  static double calculateD1(double S, double K, double T, double r,
-                            double sigma) {
-    return (std::log(S / K) + (r + 0.5 * sigma * sigma) * T) /
-           (sigma * std::sqrt(T));
-  }
-
-  // Calculate d2 parameter
-  static double calculateD2(double d1, double sigma, double T) {
-    return d1 - sigma * std::sqrt(T);
-  }
-
-public:
-  struct OptionData {
-    double spot_price;     // Current price of underlying
-    double strike_price;   // Strike price
-    double time_to_expiry; // Time to expiration in years
-    double risk_free_rate; // Risk-free interest rate
-    double volatility;     // Implied volatility
-    bool is_call;          // true for call, false for put
-
-    // Market data
-    double option_price;
-    double volume;
-    double open_interest;
-  };
-
-  struct Greeks {
-    double delta;
-    double gamma;
-    double theta;
-    double vega;
-    double rho;
-    double intrinsic_value;
-    double extrinsic_value;
-    double implied_volatility;
-  };
-
-  static Greeks calculateGreeks(const OptionData &data) {
-    Greeks greeks;
-
-    double S = data.spot_price;
-    double K = data.strike_price;
-    double T = data.time_to_expiry;
-    double r = data.risk_free_rate;
-    double sigma = data.volatility;
-
-    double d1 = calculateD1(S, K, T, r, sigma);
-    double d2 = calculateD2(d1, sigma, T);
-
-    double Nd1 = normalCDF(d1);
-    double Nd2 = normalCDF(d2);
-    double nd1 = normalPDF(d1);
-
-    if (data.is_call) {
-      // Call option Greeks
-      greeks.delta = Nd1;
-      greeks.gamma = nd1 / (S * sigma * std::sqrt(T));
-      greeks.theta = -(S * nd1 * sigma) / (2 * std::sqrt(T)) -
-                     r * K * std::exp(-r * T) * Nd2;
-      greeks.vega = S * nd1 * std::sqrt(T);
-      greeks.rho = K * T * std::exp(-r * T) * Nd2;
-
-      greeks.intrinsic_value = std::max(0.0, S - K);
-    } else {
-      // Put option Greeks
-      greeks.delta = Nd1 - 1.0;
-      greeks.gamma = nd1 / (S * sigma * std::sqrt(T));
-      greeks.theta = -(S * nd1 * sigma) / (2 * std::sqrt(T)) +
-                     r * K * std::exp(-r * T) * normalCDF(-d2);
-      greeks.vega = S * nd1 * std::sqrt(T);
-      greeks.rho = -K * T * std::exp(-r * T) * normalCDF(-d2);
-
-      greeks.intrinsic_value = std::max(0.0, K - S);
-    }
-
-    // Convert theta to per day (divide by 365)
-    greeks.theta /= 365.0;
-
-    // Convert vega to per 1% change in volatility (divide by 100)
-    greeks.vega /= 100.0;
-
-    // Convert rho to per 1% change in interest rate (divide by 100)
-    greeks.rho /= 100.0;
-
-    greeks.extrinsic_value = data.option_price - greeks.intrinsic_value;
-    greeks.implied_volatility = data.volatility;
-
-    return greeks;
-  }
-
-  static void printGreeks(const std::string &symbol, const OptionData &data,
-                          const Greeks &greeks) {
-    std::cout << "\n" << std::string(60, '=') << std::endl;
-    std::cout << "OPTIONS ANALYSIS FOR: " << symbol << std::endl;
-    std::cout << std::string(60, '=') << std::endl;
-
-    std::cout << std::fixed << std::setprecision(4);
-
-    std::cout << "\nMARKET DATA:" << std::endl;
-    std::cout << "  Spot Price:        $" << data.spot_price << std::endl;
-    std::cout << "  Strike Price:      $" << data.strike_price << std::endl;
-    std::cout << "  Option Price:      $" << data.option_price << std::endl;
-    std::cout << "  Time to Expiry:    " << data.time_to_expiry << " years"
-              << std::endl;
-    std::cout << "  Volume:            " << data.volume << std::endl;
-    std::cout << "  Open Interest:     " << data.open_interest << std::endl;
-
-    std::cout << "\nOPTION VALUES:" << std::endl;
-    std::cout << "  Intrinsic Value:   $" << greeks.intrinsic_value
-              << std::endl;
-    std::cout << "  Extrinsic Value:   $" << greeks.extrinsic_value
-              << std::endl;
-    std::cout << "  Implied Volatility: " << (greeks.implied_volatility * 100)
-              << "%" << std::endl;
-
-    std::cout << "\nTHE GREEKS:" << std::endl;
-    std::cout << "  Delta (Δ):         " << greeks.delta << std::endl;
-    std::cout << "  Gamma (Γ):         " << greeks.gamma << std::endl;
-    std::cout << "  Theta (Θ):         $" << greeks.theta << " per day"
-              << std::endl;
-    std::cout << "  Vega (ν):          $" << greeks.vega << " per 1% IV"
-              << std::endl;
-    std::cout << "  Rho (ρ):           $" << greeks.rho << " per 1% rate"
-              << std::endl;
-
-    std::cout << "\nGREEKS INTERPRETATION:" << std::endl;
-    std::cout << "  Delta: Option price changes by $" << std::abs(greeks.delta)
-              << " for each $1 move in underlying" << std::endl;
-    std::cout << "  Gamma: Delta changes by " << greeks.gamma
-              << " for each $1 move in underlying" << std::endl;
-    std::cout << "  Theta: Option loses $" << std::abs(greeks.theta)
-              << " in value each day (time decay)" << std::endl;
-    std::cout << "  Vega: Option price changes by $" << std::abs(greeks.vega)
-              << " for each 1% change in volatility" << std::endl;
-  }
-};
-
-namespace ccapi {
-
-class OptionsEventHandler : public EventHandler {
-private:
-  std::map<std::string, std::string> env_vars;
-  double risk_free_rate_ = 0.0;
-  double days_to_expiry_ = 0.0;
-
-public:
-  explicit OptionsEventHandler(double risk_free_rate, double default_days_to_expiry)
-      : risk_free_rate_(risk_free_rate), days_to_expiry_(default_days_to_expiry) {
-    env_vars = loadEnv();
-  }
-
-  void processEvent(const Event &event, Session *session) override {
-    if (event.getType() == Event::Type::SUBSCRIPTION_DATA) {
-      for (const auto &message : event.getMessageList()) {
-        processOptionData(message);
-      }
-    }
-  }
-
-private:
-  void processOptionData(const Message &message) {
-    std::cout << "\n" << std::string(50, '-') << std::endl;
-    std::cout << "Received market data for: BTCUSDT" << std::endl;
-
-    // Extract price data
-    double current_price = 0.0;
-    for (const auto &element : message.getElementList()) {
-      const std::map<std::string_view, std::string> &elementNameValueMap =
-          element.getNameValueMap();
-      for (const auto &pair : elementNameValueMap) {
-        if (pair.first == "LAST_PRICE" || pair.first == "BID_PRICE_0") {
-          current_price = std::stod(pair.second);
-          break;
-        }
-      }
-      if (current_price > 0)
-        break;
-    }
-
-    if (current_price > 0) {
-      // Example: Calculate Greeks for a BTC option
-      // In practice, you'd get this data from Binance options API
-      calculateExampleGreeks("BTCUSDT", current_price);
-    }
-  }
-
-  void calculateExampleGreeks(const std::string &instrument,
-                              double spot_price) {
-    // Example option data - in practice, get this from Binance options API
-    BlackScholesCalculator::OptionData option_data;
-    option_data.spot_price = spot_price;
-    option_data.strike_price = spot_price * 1.05; // 5% OTM call
-    option_data.time_to_expiry = days_to_expiry_ / 365.0;    // days from config
-    option_data.risk_free_rate = risk_free_rate_;               // risk-free from config
-    option_data.volatility =
-        0.80;                   // 80% implied volatility (typical for crypto)
-    option_data.is_call = true; // Call option
-    option_data.option_price = spot_price * 0.02; // Example option price
-    option_data.volume = 1500;                    // Example volume
-    option_data.open_interest = 5000;             // Example open interest
-
-    BlackScholesCalculator::Greeks greeks =
-        BlackScholesCalculator::calculateGreeks(option_data);
-    BlackScholesCalculator::printGreeks(instrument + " Call Option",
-                                        option_data, greeks);
-
-    // Also calculate for a put option
-    option_data.is_call = false;
-    option_data.strike_price = spot_price * 0.95;  // 5% OTM put
-    option_data.option_price = spot_price * 0.015; // Example put price
-    option_data.time_to_expiry = days_to_expiry_ / 365.0; // days from config
-    option_data.risk_free_rate = risk_free_rate_;            // risk-free from config
-
-    BlackScholesCalculator::Greeks put_greeks =
-        BlackScholesCalculator::calculateGreeks(option_data);
-    BlackScholesCalculator::printGreeks(instrument + " Put Option", option_data,
-                                        put_greeks);
-  }
-};
-
-} // namespace ccapi
-
 int main(int argc, char** argv) {
   using namespace ccapi;
 
@@ -279,6 +50,28 @@ int main(int argc, char** argv) {
     std::cerr << "Missing config.txt" << std::endl;
     return 1;
   }
+  // Greeks and chain reports go through the asynchronous sink; a replay
+  // never drops them
+  EventLogOptions log_options;
+  try {
+    log_options = EventLogOptions::fromArgs(argc, argv);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << e.what() << std::endl;
+    std::cerr << "Usage: options_calculator [--config PATH] [--record=LOG | --replay=LOG "
+                 "[--replay-speed=X]]"
+              << std::endl;
+    return 1;
+  }
+  auto output_options = OutputSink::Options::fromConfig(cfg);
+  if (log_options.replaying()) output_options.block_when_full = true;
+  try {
+    RuntimeTuning::instance().configure(RuntimeOptions::fromConfig(cfg));
+    OutputSink::instance().configure(output_options);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  LatencyMonitor::instance().configure(LatencyMonitor::Options::fromConfig(cfg));
   double cfg_r = cfg.requireDouble("risk_free_rate");
   double cfg_days = cfg.requireDouble("default_days_to_expiry");
 
@@ -300,8 +93,27 @@ int main(int argc, char** argv) {
   }
 
   OptionsEventHandler eventHandler(cfg_r, cfg_days);
+  eventHandler.configureChain(
+      cfg.getDoubleList("opt_chain_expiries_days", {7, 30, 90}),
+      cfg.getInt("opt_chain_strikes_per_side", 0),
+      cfg.getDouble("opt_chain_strike_step", 0.01),
+      cfg.getDouble("opt_chain_volatility", 0.80),
+      cfg.getDouble("opt_cdf_tolerance", 1e-7));
+  eventHandler.configureThrottle(cfg.getLong("opt_reprice_interval_ms", 1000),
+                                 cfg.getDouble("opt_reprice_move", 0.001),
+                                 cfg.getInt("opt_taylor_updates", 1) != 0);
+
+  // Replay a recorded session instead of connecting
+  if (log_options.replaying()) {
+    if (!replayEventLog(log_options, eventHandler)) return 1;
+    LatencyMonitor::instance().report();
+    OutputSink::instance().flush();
+    std::cout << "\nProgram completed." << std::endl;
+    return 0;
+  }
 
-  Session session(sessionOptions, sessionConfigs, &eventHandler);
+  SessionRecording recording(log_options, eventHandler);
+  Session session(sessionOptions, sessionConfigs, recording.handler());
 
   // Subscribe to BTC spot price for options calculations
   Subscription subscription("binance", "BTCUSDT", "TRADE");
@@ -0,0 +1,371 @@
+#include "arbitrage_monitor.h"
+#include "ccapi_cpp/ccapi_session.h"
+#include "event_log.h"
+#include "market_data_parser.h"
+#include "parameter_sweep.h"
+#include "simple_config.h"
+#include "tick_store.h"
+#include "trade_monitor.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ccapi {
+Logger *Logger::logger = nullptr; // This line is needed.
+} // namespace ccapi
+
+// Sweeps the trades detector and arbitrage thresholds over a recording:
+//
+//   parameter_sweep --config config.txt --replay=btc.evlog > sweep.csv
+//   parameter_sweep --config config.txt --replay-ticks=ticks [--from --to]
+//
+// The recording is decoded once. Trades feed one TradeMonitor per point of
+// the sweep_* grid. The arbitrage matrix does not depend on the
+// thresholds, so depth updates are applied once and each threshold pair
+// filters the resulting best-cross stream. As in the live monitor, the
+// depth messages of one ccapi event are applied together and each quote
+// they updated is checked for a cross once. Each grid prints as a CSV table
+// with its summary statistics, one row per parameter set.
+
+using ::ccapi::ArbitrageMonitor;
+using ::ccapi::ArbitrageThresholds;
+using ::ccapi::Message;
+using ::ccapi::TradeMonitor;
+
+namespace {
+
+// Best cross of a quote after the depth updates of one event
+struct Crossing {
+  double spread;
+  double profit;
+  double quantity;
+};
+
+struct TradeStats {
+  uint64_t trades = 0;
+  uint64_t price = 0;
+  uint64_t size = 0;
+  uint64_t volatility = 0;
+  uint64_t any = 0;
+};
+
+struct TradeRun {
+  TradeMonitor monitor;
+  TradeStats stats;
+
+  TradeRun(size_t window, const TradeMonitor::Params &params)
+      : monitor("", window, params) {}
+};
+
+struct ArbitrageStats {
+  uint64_t crossings = 0;
+  uint64_t signals = 0;
+  double profit = 0.0;
+  double max_profit = 0.0;
+  double quantity = 0.0;
+};
+
+struct ArbitrageRun {
+  ArbitrageThresholds thresholds;
+  ArbitrageStats stats;
+};
+
+// Axis values from key, or the single value def when it is absent
+std::vector<double> axisValues(const SimpleConfig &cfg, const std::string &key,
+                               double def) {
+  auto entries = cfg.getStringList(key);
+  if (entries.empty()) return {def};
+  return ParameterGrid::parseValues(entries);
+}
+
+void printHeader(const ParameterGrid &grid, const char *columns) {
+  for (size_t a = 0; a < grid.axisCount(); ++a) std::cout << grid.axisName(a) << ",";
+  std::cout << columns << "\n";
+}
+
+void printPoint(const ParameterGrid &grid, size_t point) {
+  std::cout << std::defaultfloat << std::setprecision(10);
+  for (size_t a = 0; a < grid.axisCount(); ++a) std::cout << grid.value(point, a) << ",";
+}
+
+// Detector params of a point of the trade grid
+TradeMonitor::Params tradeParams(const ParameterGrid &grid, size_t point) {
+  TradeMonitor::Params params;
+  params.lambda = grid.value(point, 0);
+  params.trade_size_multiplier = grid.value(point, 1);
+  params.price_deviation_multiplier = grid.value(point, 2);
+  params.volatility_threshold = grid.value(point, 3);
+  return params;
+}
+
+void printUsage() {
+  std::cerr << "Usage: parameter_sweep [--config PATH] (--replay=LOG | "
+               "--replay-ticks=DIR [--from=YYYYMMDD] [--to=YYYYMMDD])"
+            << std::endl;
+}
+
+double rate(uint64_t count, uint64_t total) {
+  return total > 0 ? static_cast<double>(count) / static_cast<double>(total) : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string cfgPath = RovoConfig::resolveConfigPathFromArgs(argc, argv);
+  SimpleConfig cfg;
+  if (!cfg.loadFromFile(cfgPath)) {
+    std::cerr << "Missing config file: " << cfgPath << std::endl;
+    return 1;
+  }
+  EventLogOptions log_options;
+  TickStoreOptions tick_options;
+  bool valid_args = true;
+  try {
+    log_options = EventLogOptions::fromArgs(argc, argv);
+    tick_options = TickStoreOptions::fromArgs(argc, argv);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << e.what() << std::endl;
+    valid_args = false;
+  }
+  if (!valid_args || (!log_options.replaying() && !tick_options.replaying())) {
+    printUsage();
+    return 1;
+  }
+
+  // Detector base settings, as trades and arbitrage would run them
+  long window = cfg.getLong("trades_window_size", 50);
+  if (window < 2 || window > static_cast<long>(TradeMonitor::MAX_AVERAGE_WINDOW_SIZE)) {
+    std::cerr << "trades_window_size must be between 2 and "
+              << TradeMonitor::MAX_AVERAGE_WINDOW_SIZE << std::endl;
+    return 1;
+  }
+  TradeMonitor::Params base;
+  try {
+    base = TradeMonitor::Params::fromConfig(cfg);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  auto venues = cfg.getStringList("arb_venues", {"binance", "bybit"});
+  auto symbols = cfg.getStringList("arb_symbols");
+  if (symbols.empty()) symbols.push_back(cfg.getString("arb_symbol", "BTCUSDT"));
+  ArbitrageThresholds arb_base;
+  arb_base.min_price_diff = cfg.getDouble("arb_min_price_diff", arb_base.min_price_diff);
+  arb_base.profit_threshold =
+      cfg.getDouble("arb_profit_threshold", arb_base.profit_threshold);
+
+  ParameterGrid trade_grid;
+  ParameterGrid arb_grid;
+  try {
+    trade_grid.addAxis("ewma_lambda", axisValues(cfg, "sweep_ewma_lambda", base.lambda));
+    trade_grid.addAxis("size_multiplier",
+                       axisValues(cfg, "sweep_size_multiplier",
+                                  base.trade_size_multiplier));
+    trade_grid.addAxis("price_deviation_multiplier",
+                       axisValues(cfg, "sweep_price_deviation_multiplier",
+                                  base.price_deviation_multiplier));
+    trade_grid.addAxis("volatility_threshold",
+                       axisValues(cfg, "sweep_volatility_threshold",
+                                  base.volatility_threshold));
+    arb_grid.addAxis("min_price_diff", axisValues(cfg, "sweep_min_price_diff",
+                                                  arb_base.min_price_diff));
+    arb_grid.addAxis("profit_threshold",
+                     axisValues(cfg, "sweep_profit_threshold",
+                                arb_base.profit_threshold));
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  // Every detector point must pass the checks the trades monitor applies
+  // to its config
+  for (size_t i = 0; i < trade_grid.size(); ++i) {
+    try {
+      tradeParams(trade_grid, i).validate();
+    } catch (const std::invalid_argument &e) {
+      std::cerr << "Invalid sweep_* grid point";
+      for (size_t a = 0; a < trade_grid.axisCount(); ++a) {
+        std::cerr << " " << trade_grid.axisName(a) << "=" << trade_grid.value(i, a);
+      }
+      std::cerr << ": " << e.what() << std::endl;
+      printUsage();
+      return 1;
+    }
+  }
+
+  // Decode once
+  auto batch_events = static_cast<size_t>(
+      std::max(1L, cfg.getLong("sweep_batch_events", 4096)));
+  EventBatches<TradeEvent> trades(batch_events);
+  EventBatches<Crossing> crossings(batch_events);
+  uint64_t depth_updates = 0;
+  auto decode_start = std::chrono::steady_clock::now();
+  try {
+    if (tick_options.replaying()) {
+      std::string stream =
+          cfg.getString("sweep_tick_stream", cfg.getString("trades_symbol", "BTCUSDT"));
+      TickStore(tick_options.replay_dir, stream)
+          .replay(
+              [&trades](int64_t, double price, double quantity, TradeSide side) {
+                trades.push({price, quantity, side});
+              },
+              [](int64_t, bool, const double *, const double *, size_t,
+                 const double *, const double *, size_t) {},
+              tick_options.from_ns, tick_options.to_ns);
+    } else {
+      // Trades of sweep_trades_id (correlation id), or of every
+      // subscription when unset, as the single-instrument trades monitor
+      // routes them; depth through the arbitrage monitor's routing
+      std::string trades_id = cfg.getString("sweep_trades_id", "");
+      ArbitrageMonitor arbitrage(venues, symbols);
+      double default_fee = cfg.getDouble("arb_taker_fee", 0.0);
+      for (size_t v = 0; v < venues.size(); ++v) {
+        arbitrage.setTakerFee(v, cfg.getDouble("arb_taker_fee_" + venues[v], default_fee));
+      }
+      EventReplayer replayer(log_options.replay_path);
+      ccapi::Event event;
+      while (replayer.next(event)) {
+        if (event.getType() != ccapi::Event::Type::SUBSCRIPTION_DATA) continue;
+        for (const auto &message : event.getMessageList()) {
+          if (message.getType() == Message::Type::MARKET_DATA_EVENTS_TRADE) {
+            const auto &ids = message.getCorrelationIdList();
+            if (!trades_id.empty() &&
+                std::find(ids.begin(), ids.end(), trades_id) == ids.end()) {
+              continue;
+            }
+            // One trade per element, as the trades monitor decodes them
+            for (const auto &element : message.getElementList()) {
+              const auto &fields = element.getNameValueMap();
+              auto price = fields.find("LAST_PRICE");
+              auto size = fields.find("LAST_SIZE");
+              TradeEvent trade{0.0, 0.0, TradeSide::UNKNOWN};
+              if (price == fields.end() || size == fields.end() ||
+                  !parseDouble(price->second, trade.price) ||
+                  !parseDouble(size->second, trade.amount)) {
+                continue;
+              }
+              auto maker = fields.find("IS_BUYER_MAKER");
+              if (maker != fields.end()) {
+                trade.side = maker->second == "1" ? TradeSide::SELL : TradeSide::BUY;
+              }
+              trades.push(trade);
+            }
+          } else if (message.getType() ==
+                     Message::Type::MARKET_DATA_EVENTS_MARKET_DEPTH) {
+            size_t venue, symbol;
+            if (venues.size() >= 2 &&
+                arbitrage.stageMessage(message, venue, symbol)) {
+              ++depth_updates;
+            }
+          }
+        }
+        arbitrage.evaluateStaged(
+            [&crossings](size_t, size_t,
+                         const ArbitrageMatrix::Opportunity &best) {
+              if (best.valid) {
+                crossings.push(
+                    {best.spread, best.sizing.profit, best.sizing.quantity});
+              }
+            });
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  double decode_seconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - decode_start)
+                              .count();
+
+  WorkStealingPool pool(static_cast<size_t>(std::max(0L, cfg.getLong("sweep_threads", 0))));
+  auto group_size = static_cast<size_t>(std::max(1L, cfg.getLong("sweep_group_size", 16)));
+  std::cerr << "Decoded " << trades.size() << " trades and " << depth_updates
+            << " depth updates in " << decode_seconds << "s; sweeping "
+            << trade_grid.size() << " detector and " << arb_grid.size()
+            << " threshold sets on " << pool.threads() << " threads" << std::endl;
+
+  auto sweep_start = std::chrono::steady_clock::now();
+  std::vector<TradeStats> trade_results(trade_grid.size());
+  std::vector<ArbitrageStats> arb_results(arb_grid.size());
+  try {
+    if (trades.size() > 0) {
+      runSweep(
+          pool, trades, trade_results.size(), group_size,
+          [&](size_t i) {
+            return std::make_unique<TradeRun>(static_cast<size_t>(window),
+                                              tradeParams(trade_grid, i));
+          },
+          [](TradeRun &run, const TradeEvent &trade) {
+            auto anomalies = run.monitor.analyze(trade.price, trade.amount);
+            ++run.stats.trades;
+            run.stats.price += anomalies.price;
+            run.stats.size += anomalies.size;
+            run.stats.volatility += anomalies.volatility;
+            run.stats.any += anomalies.any();
+          },
+          [&](size_t i, TradeRun &run) { trade_results[i] = run.stats; });
+    }
+    if (crossings.size() > 0) {
+      runSweep(
+          pool, crossings, arb_results.size(), group_size,
+          [&](size_t i) {
+            auto run = std::make_unique<ArbitrageRun>();
+            run->thresholds.min_price_diff = arb_grid.value(i, 0);
+            run->thresholds.profit_threshold = arb_grid.value(i, 1);
+            return run;
+          },
+          [](ArbitrageRun &run, const Crossing &crossing) {
+            ++run.stats.crossings;
+            if (!run.thresholds.accepts(crossing.spread, crossing.profit)) return;
+            ++run.stats.signals;
+            run.stats.profit += crossing.profit;
+            run.stats.max_profit = std::max(run.stats.max_profit, crossing.profit);
+            run.stats.quantity += crossing.quantity;
+          },
+          [&](size_t i, ArbitrageRun &run) { arb_results[i] = run.stats; });
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  std::cerr << "Swept in "
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             sweep_start)
+                   .count()
+            << "s" << std::endl;
+
+  if (trades.size() > 0) {
+    std::cout << "# trades detector sweep\n";
+    printHeader(trade_grid, "trades,price_anomalies,size_anomalies,"
+                            "volatility_anomalies,anomaly_rate");
+    for (size_t i = 0; i < trade_results.size(); ++i) {
+      const TradeStats &run = trade_results[i];
+      printPoint(trade_grid, i);
+      std::cout << run.trades << "," << run.price << "," << run.size << ","
+                << run.volatility << "," << std::fixed << std::setprecision(6)
+                << rate(run.any, run.trades) << "\n";
+    }
+  }
+  if (crossings.size() > 0) {
+    if (trades.size() > 0) std::cout << "\n";
+    std::cout << "# arbitrage threshold sweep\n";
+    printHeader(arb_grid, "crossings,signals,signal_rate,total_profit,"
+                          "mean_profit,max_profit,total_quantity");
+    for (size_t i = 0; i < arb_results.size(); ++i) {
+      const ArbitrageStats &run = arb_results[i];
+      printPoint(arb_grid, i);
+      std::cout << run.crossings << "," << run.signals << "," << std::fixed
+                << std::setprecision(6) << rate(run.signals, run.crossings) << ","
+                << run.profit << ","
+                << (run.signals > 0 ? run.profit / run.signals : 0.0) << ","
+                << run.max_profit << "," << run.quantity << "\n";
+    }
+  }
+  std::cout << std::flush;
+  return 0;
+}